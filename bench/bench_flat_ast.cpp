@@ -0,0 +1,120 @@
+#include "../src/flat_ast.h"
+#include "../src/lexer.h"
+#include "../src/parser.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Memory per node and traversal speed of the pointer tree against FlatAst.
+// usage: bench_flat_ast [statements]
+
+static std::string makeProgram(int statements) {
+    int variables = statements / 4;
+    std::string src;
+    src.reserve(statements * 32);
+    for (int i = 0; i < variables; ++i) {
+        src += "int vx" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+    }
+    for (int i = 0; i < variables * 2; ++i) {
+        std::string a = "vx" + std::to_string((i * 7) % variables);
+        std::string b = "vx" + std::to_string((i * 13) % variables);
+        src += "vx" + std::to_string(i % variables) + " = " + a + " * " + b + " - " + std::to_string(i % 100) + ";\n";
+    }
+    for (int i = 0; i < variables; ++i) {
+        src += "print(vx" + std::to_string(i) + ");\n";
+    }
+    return src;
+}
+
+template <typename F>
+static double seconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The same question asked of both forms: how many nodes, and what do the
+// integer literals add up to.
+struct Tally {
+    size_t nodes = 0;
+    long long sum = 0;
+};
+
+static void tally(const ASTNode* node, Tally& t) {
+    if (!node) return;
+    ++t.nodes;
+    switch (node->kind) {
+        case NodeKind::IntLiteral: t.sum += static_cast<const IntLiteral*>(node)->value; break;
+        case NodeKind::VarDecl: tally(static_cast<const VarDeclNode*>(node)->value.get(), t); break;
+        case NodeKind::Assign: tally(static_cast<const AssignNode*>(node)->value.get(), t); break;
+        case NodeKind::Print: tally(static_cast<const PrintNode*>(node)->expr.get(), t); break;
+        case NodeKind::BinaryOp: {
+            auto* binary = static_cast<const BinaryOpNode*>(node);
+            tally(binary->left.get(), t);
+            tally(binary->right.get(), t);
+            break;
+        }
+        default: break;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int statements = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    std::string source = makeProgram(statements);
+
+    Lexer lexer(source);
+    Parser parser(lexer);
+    auto ast = parser.parseProgram();
+
+    std::unique_ptr<FlatAst> flat;
+    double flatten = seconds([&] { flat = std::make_unique<FlatAst>(*ast); });
+
+    // The program has no blocks or arrays, so the arena plus the top-level
+    // vector is all the memory the tree uses.
+    size_t treeBytes = ast->arena.bytesAllocated() + ast->statements.capacity() * sizeof(void*);
+
+    const int rounds = 5;
+    Tally tree, walked, swept;
+    double treeTime = seconds([&] {
+        for (int r = 0; r < rounds; ++r) {
+            tree = {};
+            for (const auto& stmt : ast->statements) tally(stmt.get(), tree);
+        }
+    });
+    double walkTime = seconds([&] {
+        for (int r = 0; r < rounds; ++r) {
+            walked = {};
+            for (NodeRef stmt : flat->statements()) {
+                flat->walk(stmt, [&](NodeRef ref) {
+                    ++walked.nodes;
+                    if (ref.kind() == NodeKind::IntLiteral) walked.sum += flat->get<flat::IntLiteral>(ref).value;
+                });
+            }
+        }
+    });
+    double sweepTime = seconds([&] {
+        for (int r = 0; r < rounds; ++r) {
+            swept = {};
+            for (NodeRef ref : flat->order()) {
+                ++swept.nodes;
+                if (ref.kind() == NodeKind::IntLiteral) swept.sum += flat->get<flat::IntLiteral>(ref).value;
+            }
+        }
+    });
+    if (tree.nodes != walked.nodes || tree.nodes != swept.nodes || tree.sum != walked.sum || tree.sum != swept.sum) {
+        std::cerr << "tree and flat AST disagree\n";
+        return 1;
+    }
+
+    double nodes = double(tree.nodes);
+    std::cout << "[" << ast->statements.size() << " statements, " << tree.nodes << " nodes]\n"
+              << "tree:        " << treeBytes / nodes << " bytes/node\n"
+              << "flat:        " << flat->bytesUsed() / nodes << " bytes/node\n"
+              << "flatten:     " << flatten * 1e3 << " ms\n"
+              << "tree walk:   " << nodes * rounds / treeTime / 1e6 << "M nodes/sec\n"
+              << "flat walk:   " << nodes * rounds / walkTime / 1e6 << "M nodes/sec\n"
+              << "flat sweep:  " << nodes * rounds / sweepTime / 1e6 << "M nodes/sec\n";
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "../src/lexer.h"
+#include "cascade_lexer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+
+// Lexer throughput on a generated, identifier-heavy program.
+// usage: bench_lexer [statements]
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static std::string makeCorpus(int statements) {
+    static const char* names[] = {"alpha", "betaCoefficient", "count", "runningTotal", "idx", "intermediateValue", "tmp", "accumulator"};
+    std::string src;
+    src.reserve(statements * 48);
+    for (int i = 0; i < statements; ++i) {
+        std::string name = std::string(names[i % 8]) + "x" + std::to_string(i);
+        switch (i % 4) {
+            case 0: src += "int " + name + " = " + std::to_string(i) + ";\n"; break;
+            case 1: src += "if (" + name + " < max(arr)) { print(" + name + "); }\n"; break;
+            case 2: src += "for (int i = 0; i < length(arr); i++) { total += " + name + "; }\n"; break;
+            default: src += "string " + name + " = concat(\"generated prefix text\", \"def\");\n"; break;
+        }
+    }
+    return src;
+}
+
+// Generated-code style: every statement carries a doc comment, blocks are
+// indented, and long string literals are common.
+static std::string makeCommentCorpus(int statements) {
+    std::string src;
+    src.reserve(statements * 160);
+    for (int i = 0; i < statements; ++i) {
+        std::string name = "generatedValue" + std::to_string(i);
+        if (i % 2 == 0) {
+            src += "        // " + name + ": produced by the table generator, do not edit by hand\n";
+        } else {
+            src += "        /* " + name + " spans several lines in the template\n"
+                   "           and keeps its original layout in the output file */\n";
+        }
+        src += "        string " + name + " = \"a fairly long literal used as a lookup key in the table\";\n";
+    }
+    return src;
+}
+
+static void run(const char* name, const std::string& source) {
+    size_t tokens = 0;
+    size_t allocationsBefore = allocations;
+    auto start = std::chrono::steady_clock::now();
+    Lexer lexer(source);
+    while (lexer.nextToken().type != Token::Eof) {
+        ++tokens;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    size_t lexAllocations = allocations - allocationsBefore;
+
+    auto batchStart = std::chrono::steady_clock::now();
+    Lexer batchLexer(source);
+    TokenBuffer buffer = batchLexer.tokenize();
+    std::chrono::duration<double> batchElapsed = std::chrono::steady_clock::now() - batchStart;
+
+    auto parallelStart = std::chrono::steady_clock::now();
+    Lexer parallelLexer(source);
+    TokenBuffer parallelBuffer = parallelLexer.tokenizeParallel();
+    std::chrono::duration<double> parallelElapsed = std::chrono::steady_clock::now() - parallelStart;
+
+    std::cout << "[" << name << "]\n"
+              << "bytes:      " << source.size() << "\n"
+              << "tokens:     " << tokens << "\n"
+              << "seconds:    " << elapsed.count() << "\n"
+              << "MB/sec:     " << source.size() / elapsed.count() / 1e6 << "\n"
+              << "tokens/sec: " << static_cast<size_t>(tokens / elapsed.count()) << "\n"
+              << "allocs/tok: " << double(lexAllocations) / tokens << "\n"
+              << "tokenize(): " << static_cast<size_t>(buffer.size() / batchElapsed.count()) << " tokens/sec\n"
+              << "parallel:   " << static_cast<size_t>(parallelBuffer.size() / parallelElapsed.count()) << " tokens/sec ("
+              << std::thread::hardware_concurrency() << " threads)\n";
+}
+
+// Best of several passes, so both lexers are measured with a warm cache.
+template <typename L>
+static double tokensPerSecond(const std::string& source) {
+    double best = 0;
+    for (int pass = 0; pass < 5; ++pass) {
+        size_t tokens = 0;
+        auto start = std::chrono::steady_clock::now();
+        L lexer(source);
+        while (lexer.nextToken().type != Token::Eof) {
+            ++tokens;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::max(best, tokens / elapsed.count());
+    }
+    return best;
+}
+
+static void compare(const char* name, const std::string& source) {
+    double cascade = tokensPerSecond<CascadeLexer>(source);
+    double table = tokensPerSecond<Lexer>(source);
+    std::cout << "[" << name << ": cascade vs table]\n"
+              << "cascade:    " << static_cast<size_t>(cascade) << " tokens/sec\n"
+              << "table:      " << static_cast<size_t>(table) << " tokens/sec\n"
+              << "speedup:    " << table / cascade << "x\n";
+}
+
+int main(int argc, char* argv[]) {
+    int statements = argc > 1 ? std::atoi(argv[1]) : 200000;
+    run("mixed", makeCorpus(statements));
+    run("comments", makeCommentCorpus(statements));
+    compare("mixed", makeCorpus(statements));
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "../src/semantic.h"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Semantic analysis time per node as programs grow. Linear analysis keeps
+// ns/node flat within each shape; any re-walking of subtrees shows up as
+// growth. The trees are built directly so sizes are not limited by the
+// parser's recursion.
+// usage: bench_semantic [max size]
+
+struct Shape {
+    const char* name;
+    std::function<NodePtr<ASTNode>(AstArena&, int, size_t&)> build;  // counts the nodes it makes
+};
+
+// print([0, 1, ..., n-1])
+static NodePtr<ASTNode> wideArray(AstArena& arena, int n, size_t& nodes) {
+    std::vector<NodePtr<ASTNode>> elements;
+    for (int i = 0; i < n; ++i) elements.push_back(arena.make<IntLiteral>(i));
+    nodes += n + 2;
+    return arena.make<PrintNode>(arena.make<ArrayLiteralNode>(std::move(elements)));
+}
+
+// print(true ? (true ? ... [0] ... : [0]) : [0]) nested n deep; each level
+// types both arms, so re-inferring a branch would be exponential
+static NodePtr<ASTNode> nestedTernary(AstArena& arena, int n, size_t& nodes) {
+    auto leaf = [&] {
+        std::vector<NodePtr<ASTNode>> elements;
+        elements.push_back(arena.make<IntLiteral>(0));
+        nodes += 2;
+        return arena.make<ArrayLiteralNode>(std::move(elements));
+    };
+    NodePtr<ASTNode> inner = leaf();
+    for (int depth = 0; depth < n; ++depth) {
+        inner = arena.make<TernaryExprNode>(arena.make<BoolLiteral>(true), std::move(inner), leaf());
+        nodes += 2;
+    }
+    nodes += 1;
+    return arena.make<PrintNode>(std::move(inner));
+}
+
+// print(((0 + 1) + 2) + ... + n)
+static NodePtr<ASTNode> deepExpression(AstArena& arena, int n, size_t& nodes) {
+    NodePtr<ASTNode> expr = arena.make<IntLiteral>(0);
+    for (int i = 1; i <= n; ++i) {
+        expr = arena.make<BinaryOpNode>(BinaryOp::ADD, std::move(expr), arena.make<IntLiteral>(i));
+    }
+    nodes += 2 * size_t(n) + 2;
+    return arena.make<PrintNode>(std::move(expr));
+}
+
+static void run(const Shape& shape, int size) {
+    auto program = std::make_unique<ProgramNode>();
+    size_t nodes = 0;
+    program->statements.push_back(shape.build(program->arena, size, nodes));
+
+    auto start = std::chrono::steady_clock::now();
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(program.get());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << shape.name << " " << size << ": " << nodes << " nodes, " << seconds * 1e3 << " ms, "
+              << seconds * 1e9 / double(nodes) << " ns/node\n";
+}
+
+int main(int argc, char* argv[]) {
+    int maxSize = argc > 1 ? std::atoi(argv[1]) : 16384;
+    const Shape shapes[] = {
+        {"wide array", wideArray},
+        {"nested ternary", nestedTernary},
+        {"deep expression", deepExpression},
+    };
+    for (const Shape& shape : shapes) {
+        for (int size = 16; size <= maxSize; size *= 4) run(shape, size);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "../src/codegen.h"
+#include "../src/lexer.h"
+#include "../src/optimizer.h"
+#include "../src/parser.h"
+#include "../src/semantic.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Per-phase cost of the pipeline on programs with many variables; one small
+// loop per ten variables gives the optimizer something to unroll and clone.
+// usage: bench_symbols [variables...]
+
+static std::string makeProgram(int variables) {
+    std::string src;
+    src.reserve(variables * 90);
+    for (int i = 0; i < variables; ++i) {
+        src += "int accumulatorx" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+    }
+    for (int i = 0; i < variables; ++i) {
+        std::string a = "accumulatorx" + std::to_string((i * 7) % variables);
+        std::string b = "accumulatorx" + std::to_string((i * 13) % variables);
+        src += "accumulatorx" + std::to_string(i) + " = " + a + " * " + b + ";\n";
+    }
+    for (int i = 0; i < variables; i += 10) {
+        std::string counter = "loopx" + std::to_string(i);
+        src += "for (int " + counter + " = 0; " + counter + " < 4; " + counter + "++) { print(accumulatorx" +
+               std::to_string(i) + " * " + counter + "); }\n";
+    }
+    src += "print(accumulatorx0);\n";
+    return src;
+}
+
+template <typename F>
+static double seconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void run(int variables) {
+    std::string source = makeProgram(variables);
+    std::unique_ptr<ProgramNode> ast;
+
+    double parse = seconds([&] {
+        Lexer lexer(source);
+        Parser parser(lexer);
+        ast = parser.parseProgram();
+    });
+    double semantic = seconds([&] {
+        SemanticAnalyzer analyzer;
+        analyzer.analyze(ast.get());
+    });
+    double optimize = seconds([&] {
+        Optimizer optimizer;
+        optimizer.optimize(*ast);
+    });
+    double codegen = seconds([&] {
+        CodeGen generator;
+        generator.generate(*ast);
+    });
+
+    std::cout << "[" << variables << " variables]\n"
+              << "parse:      " << parse * 1e3 << " ms\n"
+              << "semantic:   " << semantic * 1e3 << " ms\n"
+              << "optimize:   " << optimize * 1e3 << " ms\n"
+              << "codegen:    " << codegen * 1e3 << " ms\n"
+              << "symbols:    " << globalInterner().size() << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i) run(std::atoi(argv[i]));
+    } else {
+        for (int variables : {1000, 10000, 50000}) run(variables);
+    }
+    return 0;
+}
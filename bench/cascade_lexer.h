@@ -0,0 +1,315 @@
+#pragma once
+#include "../src/keywords.h"
+#include "../src/lexer.h"
+#include "../src/scan.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <string_view>
+
+// The if-cascade lexer that the table-driven Lexer replaced, kept so
+// bench_lexer can compare the two. Whitespace, comments and strings are
+// handled exactly as in Lexer.
+class CascadeLexer {
+public:
+    CascadeLexer(std::string_view source) : source(source) {}
+
+    Token nextToken() {
+        do {
+            const char* begin = source.data();
+            pos = scan::skipWhitespace(begin + pos, begin + source.size()) - begin;
+        } while (skipComments());
+        tokenStart = pos;
+        Token token = lexToken();
+        token.offset = uint32_t(token.lexeme.empty() ? tokenStart : token.lexeme.data() - source.data());
+        return token;
+    }
+
+private:
+    std::string_view source;
+    size_t pos = 0;
+    size_t tokenStart = 0;
+
+    bool skipComments() {
+        if (pos + 1 >= source.size() || source[pos] != '/') return false;
+        const char* begin = source.data();
+        const char* end = begin + source.size();
+        if (source[pos + 1] == '/') {
+            const char* newline = scan::find(begin + pos + 2, end, '\n');
+            pos = newline == end ? source.size() : newline - begin + 1;
+            return true;
+        }
+        if (source[pos + 1] == '*') {
+            const char* p = begin + pos + 2;
+            while ((p = scan::find(p, end - 1, '*')) < end - 1) {
+                if (p[1] == '/') {
+                    pos = p - begin + 2;
+                    return true;
+                }
+                ++p;
+            }
+            throw std::runtime_error("Unterminated multi-line comment");
+        }
+        return false;
+    }
+
+    std::string_view slice(size_t start) const {
+        return std::string_view(source.data() + start, pos - start);
+    }
+
+    char peek() const {
+        return pos < source.size() ? source[pos] : '\0';
+    }
+
+    Token lexToken() {
+        if (pos >= source.size()) return {Token::Eof, ""};
+
+        char c = source[pos];
+
+        if (std::isalpha(c) || c == '_') {
+            size_t start = pos; ///////////////////////////////
+            pos++;
+            if(c == '_' || std::isdigit(source[pos])) throw std::runtime_error("Parser-Error: Names can not begin with numbers.");
+            while (pos < source.size() && (std::isalnum(source[pos]) || source[pos] == '_')) {
+                pos++;
+            }
+            std::string_view word(source.data() + start, pos - start);
+            if (const keywords::Keyword* kw = keywords::lookupKeyword(word)) {
+                if (!kw->keepLexeme) return {kw->type, ""};
+                if (kw->type == Token::BoolLiteral) return {kw->type, word};
+                return {kw->type, word};
+            }
+
+            //          add other keywords to the keyword table above          //
+
+            return {Token::Ident, word};
+        }
+
+        if (c == '-' || c == '+' || std::isdigit(c)) {
+            bool hasDot = false;
+            bool isSigned = (c == '-' || c == '+');
+            size_t start = pos;
+
+            // Handle sign
+            if (isSigned) {
+                pos++;
+
+                if (peek() == '(') {
+                    pos++;
+                    return {Token::negLeftParen, slice(start)};
+                }
+                // Check for -= or +=
+                if (peek() == '=') {
+                    pos++;
+                    return {c == '-' ? Token::MinusEqual : Token::PlusEqual, slice(start)};
+                }
+
+                if (c == '-' && peek() == '-') {
+                    pos++;
+                    return {Token::MinusMinus, slice(start)};
+                }
+
+                if (c == '+' && peek() == '+') {
+                    pos++;
+                    return {Token::PlusPlus, slice(start)};
+                }
+
+                if (c == '-' && peek() == '>') {
+                    pos++;
+                    return {Token::Arrow, slice(start)};
+                }
+
+                if (pos >= source.size() || !std::isdigit(source[pos])) {
+                    return {c == '-' ? Token::Minus : Token::Plus, slice(start)};
+                }
+            }
+
+            // Collect digits and optional dot
+            while (pos < source.size() && (std::isdigit(source[pos]) || source[pos] == '.')) {
+                if (source[pos] == '.') hasDot = true;
+                pos++;
+            }
+
+            // Determine token type
+            std::string_view lexeme = slice(start);
+            if (hasDot) {
+                return {Token::FloatLiteral, lexeme};
+            } else if (isSigned) {
+                return {Token::SignedIntLiteral, lexeme};
+            } else {
+                return {Token::IntLiteral, lexeme};
+            }
+        }
+
+        if (c == '=') {
+            pos++;
+            if (peek() == '=') {
+                pos++;
+                return {Token::EqualEqual, ""};
+            }
+            return {Token::Equal, ""};
+        }
+
+        if (c == '[') {
+            pos++;
+            return {Token::LeftBracket, ""};
+        }
+
+        if (c == '%') {
+            pos++;
+            if (peek() == '=') {
+                pos++;
+                return {Token::ModuloEqual, ""};
+            }
+            return {Token::Modulo, ""};
+        }
+
+        if (c == ']') {
+            pos++;
+            return {Token::RightBracket, ""};
+        }
+
+        if (c == '<') {
+            pos++;
+            if (peek() == '=') {
+                pos++;
+                return {Token::LessEqual, ""};
+            }
+            return {Token::Less, ""};
+        }
+
+        if (c == '>') {
+            pos++;
+            if (peek() == '=') {
+                pos++;
+                return {Token::GreaterEqual, ""};
+            }
+            return {Token::Greater, ""};
+        }
+
+        if (c == '!') {
+            pos++;
+            if (peek() == '=') {
+                pos++;
+                return {Token::NotEqual, ""};
+            }
+            // not defined yet. in case of use will return error
+        }
+
+        if (c == '&') {
+            pos++;
+            if (peek() == '&') {
+                pos++;
+                return {Token::And, ""};
+            }
+            // not defined yet. in case of use will return error
+        }
+
+        if (c == '^') {
+            pos++;
+            return {Token::Xor, "^"};
+        }
+
+        if (c == '|') {
+            pos++;
+            if (peek() == '|') {
+                pos++;
+                return {Token::Or, ""};
+            }
+            // not defined yet. in case of use will return error
+        }
+
+        if (c == ',') {
+            pos++;
+            return {Token::Comma, ""};
+        }
+
+        if (c == '.') {
+            pos++;
+            return {Token::Dot, ""};
+        }
+
+        if (c == '(') {
+            pos++;
+            return {Token::LeftParen, ""};
+        }
+
+        if (c == ')') {
+            pos++;
+            return {Token::RightParen, ""};
+        }
+
+        if (c == '{') {
+            pos++;
+            return {Token::LeftBrace, ""};
+        }
+
+        if (c == '}') {
+            pos++;
+            return {Token::RightBrace, ""};
+        }
+
+        if (c == ';') {
+            pos++;
+            return {Token::Semicolon, ""};
+        }
+
+        if (c == '"') {
+            pos++;
+            size_t start = pos;
+            const char* begin = source.data();
+            pos = scan::find(begin + pos, begin + source.size(), '"') - begin;
+
+            if (pos >= source.size()) return {Token::Error, slice(start)}; // unterminated string
+            std::string_view value = slice(start);
+            pos++;
+            return {Token::StrLiteral, value};
+        }
+
+        if (c == ':') {
+            pos++;
+            return {Token::Colon, ""};
+        }
+
+        if (c == '_') {
+            pos++;
+            return {Token::Underscore, ""};
+        }
+
+        if (c == '?') {
+            pos++;
+            return {Token::Question, ""};
+        }
+        // std::cout << "reached here ...\n";
+        if (c == '+') {
+            pos++;
+            if (peek() == '=') {
+                pos++;
+                return {Token::PlusEqual, ""};
+            }
+            return {Token::Plus, ""};
+        }
+
+        if (c == '*') {
+            pos++;
+            if (peek() == '=') {
+                pos++;
+                return {Token::StarEqual, ""};
+            }
+            return {Token::Star, ""};
+        }
+
+        if (c == '/') {
+            pos++;
+            if (peek() == '=') {
+                pos++;
+                return {Token::SlashEqual, ""};
+            }
+            return {Token::Slash, ""};
+        }
+        //        add other operators or anything needed like these           //
+
+        pos++;
+        return {Token::Error, slice(pos - 1)}; // unexpected character
+    }
+};
@@ -0,0 +1,35 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+constexpr size_t blockSize = 64 * 1024;
+}
+
+AstArena::~AstArena() {
+    // reverse creation order, like a stack of unique_ptrs would
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+}
+
+void* AstArena::allocate(size_t size, size_t align) {
+    auto aligned = [align](std::byte* p) {
+        return reinterpret_cast<std::byte*>((reinterpret_cast<uintptr_t>(p) + align - 1) & ~(uintptr_t(align) - 1));
+    };
+    std::byte* start = cursor ? aligned(cursor) : nullptr;
+    if (!start || start + size > limit) {
+        size_t bytes = std::max(blockSize, size + align);
+        blocks.emplace_back(new std::byte[bytes]); // left uninitialized
+        cursor = blocks.back().get();
+        limit = cursor + bytes;
+        start = aligned(cursor);
+    }
+    cursor = start + size;
+    used += size;
+    return start;
+}
+
+size_t AstArena::bytesAllocated() const {
+    return used;
+}
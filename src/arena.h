@@ -0,0 +1,90 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Handle to an arena-allocated node. It has unique_ptr's interface and move
+// semantics so ownership still reads the same in the tree, but it never
+// frees anything: the AstArena owns the storage.
+template <typename T>
+class NodePtr {
+public:
+    NodePtr() = default;
+    NodePtr(std::nullptr_t) {}
+    explicit NodePtr(T* ptr) : ptr(ptr) {}
+    NodePtr(NodePtr&& other) noexcept : ptr(other.release()) {}
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    NodePtr(NodePtr<U>&& other) noexcept : ptr(other.release()) {}
+    NodePtr(const NodePtr&) = delete;
+
+    NodePtr& operator=(NodePtr&& other) noexcept {
+        ptr = other.release();
+        return *this;
+    }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    NodePtr& operator=(NodePtr<U>&& other) noexcept {
+        ptr = other.release();
+        return *this;
+    }
+    NodePtr& operator=(std::nullptr_t) {
+        ptr = nullptr;
+        return *this;
+    }
+    NodePtr& operator=(const NodePtr&) = delete;
+
+    T* get() const { return ptr; }
+    T* operator->() const { return ptr; }
+    T& operator*() const { return *ptr; }
+    explicit operator bool() const { return ptr != nullptr; }
+    T* release() { return std::exchange(ptr, nullptr); }
+
+    friend bool operator==(const NodePtr& p, std::nullptr_t) { return p.ptr == nullptr; }
+    friend bool operator!=(const NodePtr& p, std::nullptr_t) { return p.ptr != nullptr; }
+
+private:
+    T* ptr = nullptr;
+};
+
+// Bump-pointer storage for the nodes of one program. Nodes are never freed
+// one by one; the whole arena is released at once. Only nodes that own heap
+// memory themselves (a std::vector or std::string member) have their
+// destructor run at that point; the rest are trivially destructible.
+class AstArena {
+public:
+    AstArena() = default;
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+    ~AstArena();
+
+    template <typename T, typename... Args>
+    NodePtr<T> make(Args&&... args) {
+        T* node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destructors.push_back({node, [](void* p) { static_cast<T*>(p)->~T(); }});
+        }
+        return NodePtr<T>(node);
+    }
+
+    size_t bytesAllocated() const;
+
+private:
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    void* allocate(size_t size, size_t align);
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte* cursor = nullptr;
+    std::byte* limit = nullptr;
+    size_t used = 0;
+    std::vector<Destructor> destructors;
+};
+
+#endif
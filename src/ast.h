@@ -1,223 +1,409 @@
 #ifndef AST_H
 #define AST_H
 
+#include "arena.h"
+#include "interner.h"
+#include <cstdint>
 #include <memory>
-#include <vector>
 #include <string>
+#include <type_traits>
+#include <vector>
 
-enum class VarType { INT, STRING, BOOL, FLOAT, CHAR, NEUTRAL, ARRAY, ERROR };
-enum class BinaryOp { ADD, SUBTRACT, MULTIPLY, DIVIDE, EQUAL, ABS, POW,
+enum class VarType : uint8_t { INT, STRING, BOOL, FLOAT, CHAR, NEUTRAL, ARRAY, ERROR };
+enum class BinaryOp : uint8_t { ADD, SUBTRACT, MULTIPLY, DIVIDE, EQUAL, ABS, POW,
      NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, AND, OR , XOR, MODULO, 
      INDEX, MULTIPLY_ARRAY, ADD_ARRAY, SUBTRACT_ARRAY, DIVIDE_ARRAY, CONCAT, METHOD_CALL };
-enum class LoopType { For, Foreach };
-enum class UnaryOp { LENGTH, MIN, MAX, INCREMENT ,DECREMENT, NEGATE };
+enum class LoopType : uint8_t { For, Foreach };
+enum class UnaryOp : uint8_t { LENGTH, MIN, MAX, INCREMENT ,DECREMENT, NEGATE };
 // enum class LogicalOp { EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+// One tag per concrete node class; phases switch on it instead of probing
+// with dynamic_cast.
+enum class NodeKind : uint8_t {
+    Program, VarDecl, MultiVarDecl, Assign, VarRef, IntLiteral, StrLiteral,
+    BoolLiteral, FloatLiteral, CharLiteral, BinaryOp, CompoundAssign, Block,
+    IfElse, Print, Loop, Concat, ArrayLiteral, UnaryOp, TryCatch, Ternary,
+    MatchCase, Match
+};
+
+constexpr uint32_t UnknownLength = UINT32_MAX;
+
+// Static type of a value. For arrays it also carries the element type and,
+// when the analyzer can prove it, the length: array<int>[4].
+struct ValueType {
+    VarType kind = VarType::NEUTRAL;
+    VarType element = VarType::NEUTRAL;  // ARRAY only
+    uint32_t length = UnknownLength;     // ARRAY only
+
+    ValueType() = default;
+    ValueType(VarType kind) : kind(kind) {}
+    static ValueType array(VarType element, uint32_t length = UnknownLength) {
+        ValueType type(VarType::ARRAY);
+        type.element = element;
+        type.length = length;
+        return type;
+    }
+    bool isArray() const { return kind == VarType::ARRAY; }
+    bool hasLength() const { return length != UnknownLength; }
+};
+
+// Dense index of a declared variable, assigned by SemanticAnalyzer. Every
+// declaration gets its own slot, so CodeGen can keep per-variable state in
+// plain vectors.
+using SlotId = uint32_t;
+constexpr SlotId NoSlot = UINT32_MAX;
+
+// Nodes are created in the program's AstArena and never deleted through an
+// ASTNode*, so the destructor is protected and non-virtual; that keeps most
+// node types trivially destructible. Each subclass passes its Kind up.
 class ASTNode {
 public:
-    virtual ~ASTNode() = default;
+    const NodeKind kind;
+    // Resolved by SemanticAnalyzer on every expression (literals know their
+    // own) and on declarations, where it is the declared variable's type;
+    // CodeGen reads it instead of re-deriving types.
+    ValueType valueType;
+
+protected:
+    explicit ASTNode(NodeKind kind, VarType valueType = VarType::NEUTRAL) : kind(kind), valueType(valueType) {}
+    ~ASTNode() = default;
 };
 
+// Checked downcast by tag: the node as a T, or null if it is something else.
+template <typename T>
+T* node_cast(ASTNode* node) {
+    return node && node->kind == std::remove_const_t<T>::Kind ? static_cast<T*>(node) : nullptr;
+}
+template <typename T>
+const T* node_cast(const ASTNode* node) {
+    return node && node->kind == std::remove_const_t<T>::Kind ? static_cast<const T*>(node) : nullptr;
+}
+
 class ProgramNode : public ASTNode {
 public:
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    static constexpr NodeKind Kind = NodeKind::Program;
+    ProgramNode() : ASTNode(Kind) {}
+    AstArena arena;  // declared first so it outlives the statements
+    std::vector<NodePtr<ASTNode>> statements;
+    uint32_t slotCount = 0;  // variable slots handed out by SemanticAnalyzer
 };
 
 class VarDeclNode : public ASTNode {
     public:
-    VarDeclNode(VarType type, std::string name, std::unique_ptr<ASTNode> value)
-        : type(type), name(std::move(name)), value(std::move(value)) {}
+        static constexpr NodeKind Kind = NodeKind::VarDecl;
+    VarDeclNode(VarType type, SymbolId symbol, NodePtr<ASTNode> value)
+        : ASTNode(Kind), type(type), symbol(symbol), value(std::move(value)) {}
     
     VarType type;
-    std::string name;
-    std::unique_ptr<ASTNode> value;
+    VarType elementType = VarType::NEUTRAL;  // written as array<T>, else NEUTRAL
+    SymbolId symbol;
+    NodePtr<ASTNode> value;
+    SlotId slot = NoSlot;
+    // Set by SemanticAnalyzer when every value stored in the variable is a
+    // fresh heap buffer that no other variable ever points at, so CodeGen
+    // may free it on reassignment and at scope exit.
+    bool ownsBuffer = false;
 };
 
 class MultiVarDeclNode : public ASTNode {
     public:
-        MultiVarDeclNode(std::vector<std::unique_ptr<VarDeclNode>> declarations)
-            : declarations(std::move(declarations)) {}
+        static constexpr NodeKind Kind = NodeKind::MultiVarDecl;
+        MultiVarDeclNode(std::vector<NodePtr<VarDeclNode>> declarations)
+            : ASTNode(Kind), declarations(std::move(declarations)) {}
         
-        std::vector<std::unique_ptr<VarDeclNode>> declarations;
+        std::vector<NodePtr<VarDeclNode>> declarations;
     };
 
 class AssignNode : public ASTNode {
 public:
-    AssignNode(std::string name, std::unique_ptr<ASTNode> value)
-        : name(std::move(name)), value(std::move(value)) {}
+    static constexpr NodeKind Kind = NodeKind::Assign;
+    AssignNode(SymbolId symbol, NodePtr<ASTNode> value)
+        : ASTNode(Kind), symbol(symbol), value(std::move(value)) {}
     
-    std::string name;
-    std::unique_ptr<ASTNode> value;
+    SymbolId symbol;
+    NodePtr<ASTNode> value;
+    SlotId slot = NoSlot;  // of the variable assigned to
 };
 
 class VarRefNode : public ASTNode {
     public:
-        VarRefNode(std::string name) : name(std::move(name)) {}
-        std::string name;
+        static constexpr NodeKind Kind = NodeKind::VarRef;
+        VarRefNode(SymbolId symbol) : ASTNode(Kind), symbol(symbol) {}
+        SymbolId symbol;
+        SlotId slot = NoSlot;  // of the declaration it resolves to
 };
     
 class IntLiteral : public ASTNode {
 public:
-    IntLiteral(int value) : value(value) {}
+    static constexpr NodeKind Kind = NodeKind::IntLiteral;
+    IntLiteral(int value) : ASTNode(Kind, VarType::INT), value(value) {}
     int value;
 };
 
 class StrLiteral : public ASTNode {
 public:
-    StrLiteral(std::string value) : value(std::move(value)) {}
+    static constexpr NodeKind Kind = NodeKind::StrLiteral;
+    StrLiteral(std::string value) : ASTNode(Kind, VarType::STRING), value(std::move(value)) {}
     std::string value;
 };
 
 class BoolLiteral : public ASTNode {
     public:
-        BoolLiteral(bool value) : value(value) {}
+        static constexpr NodeKind Kind = NodeKind::BoolLiteral;
+        BoolLiteral(bool value) : ASTNode(Kind, VarType::BOOL), value(value) {}
         bool value;
 };
 
 class FloatLiteral : public ASTNode {
     public:
-        FloatLiteral(float value) : value(value) {}
+        static constexpr NodeKind Kind = NodeKind::FloatLiteral;
+        FloatLiteral(float value) : ASTNode(Kind, VarType::FLOAT), value(value) {}
         float value;
 };
 
 class CharLiteral : public ASTNode {
     public:
-        CharLiteral(char value) : value(value) {}
+        static constexpr NodeKind Kind = NodeKind::CharLiteral;
+        CharLiteral(char value) : ASTNode(Kind, VarType::CHAR), value(value) {}
         char value;
 };
 
 class BinaryOpNode : public ASTNode {
     public:
-        BinaryOpNode(BinaryOp op, std::unique_ptr<ASTNode> left, std::unique_ptr<ASTNode> right)
-            : op(op), left(std::move(left)), right(std::move(right)) {}
+        static constexpr NodeKind Kind = NodeKind::BinaryOp;
+        BinaryOpNode(BinaryOp op, NodePtr<ASTNode> left, NodePtr<ASTNode> right)
+            : ASTNode(Kind), op(op), left(std::move(left)), right(std::move(right)) {}
     
         BinaryOp op;
-        std::unique_ptr<ASTNode> left;
-        std::unique_ptr<ASTNode> right;
+        NodePtr<ASTNode> left;
+        NodePtr<ASTNode> right;
 };
 
 class CompoundAssignNode : public ASTNode {
     public:
-        CompoundAssignNode(std::string name, BinaryOp op, std::unique_ptr<ASTNode> value)
-            : name(std::move(name)), op(op), value(std::move(value)) {}
+        static constexpr NodeKind Kind = NodeKind::CompoundAssign;
+        CompoundAssignNode(SymbolId symbol, BinaryOp op, NodePtr<ASTNode> value)
+            : ASTNode(Kind), symbol(symbol), op(op), value(std::move(value)) {}
     
-        std::string name;
+        SymbolId symbol;
         BinaryOp op;
-        std::unique_ptr<ASTNode> value;
+        NodePtr<ASTNode> value;
+        SlotId slot = NoSlot;
 };
 class BlockNode : public ASTNode {
     public:
-        std::vector<std::unique_ptr<ASTNode>> statements;
+        static constexpr NodeKind Kind = NodeKind::Block;
+        std::vector<NodePtr<ASTNode>> statements;
     
-        BlockNode() = default;
+        BlockNode() : ASTNode(Kind) {}
 };    
 class IfElseNode : public ASTNode {
     public:
+        static constexpr NodeKind Kind = NodeKind::IfElse;
         // Unified constructor for all if variants
-        IfElseNode(std::unique_ptr<ASTNode> condition,
-                   std::unique_ptr<ASTNode> then_block,
-                   std::unique_ptr<ASTNode> else_block = nullptr)
-            : condition(std::move(condition)),
+        IfElseNode(NodePtr<ASTNode> condition,
+                   NodePtr<ASTNode> then_block,
+                   NodePtr<ASTNode> else_block = nullptr)
+            : ASTNode(Kind), condition(std::move(condition)),
               then_block(std::move(then_block)),
               else_block(std::move(else_block)) {}
     
         // Accessors
         bool hasElseBlock() const { return else_block != nullptr; }
         bool isElseIf() const {
-            return hasElseBlock() && dynamic_cast<IfElseNode*>(else_block.get());
+            return hasElseBlock() && else_block->kind == NodeKind::IfElse;
         }
     
-        std::unique_ptr<ASTNode> condition;
-        std::unique_ptr<ASTNode> then_block;
-        std::unique_ptr<ASTNode> else_block;  // Can be BlockNode or another IfElseNode
+        NodePtr<ASTNode> condition;
+        NodePtr<ASTNode> then_block;
+        NodePtr<ASTNode> else_block;  // Can be BlockNode or another IfElseNode
     };
 
 class PrintNode : public ASTNode {
     public:
-        std::unique_ptr<ASTNode> expr;  // Expression to print (literal, var, or operation)
-        PrintNode(std::unique_ptr<ASTNode> expr) : expr(std::move(expr)) {}
+        static constexpr NodeKind Kind = NodeKind::Print;
+        NodePtr<ASTNode> expr;  // Expression to print (literal, var, or operation)
+        PrintNode(NodePtr<ASTNode> expr) : ASTNode(Kind), expr(std::move(expr)) {}
 };
 
 class LoopNode : public ASTNode {
     public:
+        static constexpr NodeKind Kind = NodeKind::Loop;
         LoopType type;
         // For 'for' loop
-        std::unique_ptr<ASTNode> init;      // Optional: VarDeclNode or AssignNode
-        std::unique_ptr<ASTNode> condition; // Optional: Expression
-        std::unique_ptr<ASTNode> update;    // Optional: Expression
+        NodePtr<ASTNode> init;      // Optional: VarDeclNode or AssignNode
+        NodePtr<ASTNode> condition; // Optional: Expression
+        NodePtr<ASTNode> update;    // Optional: Expression
         // For 'foreach' loop
-        std::string varName;                // Optional: Loop variable (e.g., x)
-        std::unique_ptr<ASTNode> collection; // Optional: Collection expression (e.g., nums, multiply(arr, arr))
+        SymbolId varSymbol = NoSymbol;      // Optional: Loop variable (e.g., x)
+        SlotId varSlot = NoSlot;
+        NodePtr<ASTNode> collection; // Optional: Collection expression (e.g., nums, multiply(arr, arr))
         // Common
-        std::unique_ptr<ASTNode> body;      // Required: BlockNode
+        NodePtr<ASTNode> body;      // Required: BlockNode
     
         // Constructor for 'for'
-        LoopNode(std::unique_ptr<ASTNode> init, std::unique_ptr<ASTNode> condition,
-                 std::unique_ptr<ASTNode> update, std::unique_ptr<ASTNode> body)
-            : type(LoopType::For), init(std::move(init)), condition(std::move(condition)),
+        LoopNode(NodePtr<ASTNode> init, NodePtr<ASTNode> condition,
+                 NodePtr<ASTNode> update, NodePtr<ASTNode> body)
+            : ASTNode(Kind), type(LoopType::For), init(std::move(init)), condition(std::move(condition)),
               update(std::move(update)), body(std::move(body)) {}
     
         // Constructor for 'foreach'
-        LoopNode(std::string varName, std::unique_ptr<ASTNode> collection, std::unique_ptr<ASTNode> body)
-            : type(LoopType::Foreach), varName(std::move(varName)), 
+        LoopNode(SymbolId varSymbol, NodePtr<ASTNode> collection, NodePtr<ASTNode> body)
+            : ASTNode(Kind), type(LoopType::Foreach), varSymbol(varSymbol), 
               collection(std::move(collection)), body(std::move(body)) {}
     };
 
 struct ConcatNode : ASTNode {
-    std::unique_ptr<ASTNode> left;
-    std::unique_ptr<ASTNode> right;
-    ConcatNode(std::unique_ptr<ASTNode> l, std::unique_ptr<ASTNode> r)
-        : left(std::move(l)), right(std::move(r)) {}
+    static constexpr NodeKind Kind = NodeKind::Concat;
+    NodePtr<ASTNode> left;
+    NodePtr<ASTNode> right;
+    ConcatNode(NodePtr<ASTNode> l, NodePtr<ASTNode> r)
+        : ASTNode(Kind), left(std::move(l)), right(std::move(r)) {}
 };
 
 class ArrayLiteralNode : public ASTNode {
     public:
-        std::vector<std::unique_ptr<ASTNode>> elements;
-        ArrayLiteralNode(std::vector<std::unique_ptr<ASTNode>> elements)
-            : elements(std::move(elements)) {}
+        static constexpr NodeKind Kind = NodeKind::ArrayLiteral;
+        std::vector<NodePtr<ASTNode>> elements;
+        ArrayLiteralNode(std::vector<NodePtr<ASTNode>> elements)
+            : ASTNode(Kind), elements(std::move(elements)) {}
 };
 
 class UnaryOpNode : public ASTNode { // NEW (assuming it wasn't present)
     public:
+        static constexpr NodeKind Kind = NodeKind::UnaryOp;
         UnaryOp op;
-        std::unique_ptr<ASTNode> operand;
-        UnaryOpNode(UnaryOp op, std::unique_ptr<ASTNode> operand)
-            : op(op), operand(std::move(operand)) {}
+        NodePtr<ASTNode> operand;
+        UnaryOpNode(UnaryOp op, NodePtr<ASTNode> operand)
+            : ASTNode(Kind), op(op), operand(std::move(operand)) {}
 };
 
 class TryCatchNode : public ASTNode {
     public:
-        std::unique_ptr<BlockNode> tryBlock;
-        std::unique_ptr<BlockNode> catchBlock;
-        std::string errorVar; // e in catch (Error e)
-        TryCatchNode(std::unique_ptr<BlockNode> tryBlock, 
-                     std::unique_ptr<BlockNode> catchBlock,
-                     std::string errorVar)
-            : tryBlock(std::move(tryBlock)), catchBlock(std::move(catchBlock)), 
-              errorVar(std::move(errorVar)) {}
+        static constexpr NodeKind Kind = NodeKind::TryCatch;
+        NodePtr<BlockNode> tryBlock;
+        NodePtr<BlockNode> catchBlock;
+        SymbolId errorSymbol; // e in catch (Error e)
+        SlotId errorSlot = NoSlot;
+        TryCatchNode(NodePtr<BlockNode> tryBlock, 
+                     NodePtr<BlockNode> catchBlock,
+                     SymbolId errorSymbol)
+            : ASTNode(Kind), tryBlock(std::move(tryBlock)), catchBlock(std::move(catchBlock)), 
+              errorSymbol(errorSymbol) {}
     };
 
 struct TernaryExprNode : ASTNode {
-    std::unique_ptr<ASTNode> condition;    // e.g., z > 5
-    std::unique_ptr<ASTNode> trueBranch;   // e.g., y
-    std::unique_ptr<ASTNode> falseBranch;  // e.g., w
-    TernaryExprNode(std::unique_ptr<ASTNode> cond, std::unique_ptr<ASTNode> trueB, std::unique_ptr<ASTNode> falseB)
-        : condition(std::move(cond)), trueBranch(std::move(trueB)), falseBranch(std::move(falseB)) {}
+    static constexpr NodeKind Kind = NodeKind::Ternary;
+    NodePtr<ASTNode> condition;    // e.g., z > 5
+    NodePtr<ASTNode> trueBranch;   // e.g., y
+    NodePtr<ASTNode> falseBranch;  // e.g., w
+    TernaryExprNode(NodePtr<ASTNode> cond, NodePtr<ASTNode> trueB, NodePtr<ASTNode> falseB)
+        : ASTNode(Kind), condition(std::move(cond)), trueBranch(std::move(trueB)), falseBranch(std::move(falseB)) {}
 };
 
 // Match case node (e.g., 0 -> stmt or _ -> stmt)
 struct MatchCaseNode : ASTNode {
-    std::unique_ptr<ASTNode> value; // Case value (e.g., 0, 1, or nullptr for _)
-    std::unique_ptr<ASTNode> body;  // Body (StatementNode or BlockNode)
-    MatchCaseNode(std::unique_ptr<ASTNode> val, std::unique_ptr<ASTNode> b)
-        : value(std::move(val)), body(std::move(b)) {}
+    static constexpr NodeKind Kind = NodeKind::MatchCase;
+    NodePtr<ASTNode> value; // Case value (e.g., 0, 1, or nullptr for _)
+    NodePtr<ASTNode> body;  // Body (StatementNode or BlockNode)
+    MatchCaseNode(NodePtr<ASTNode> val, NodePtr<ASTNode> b)
+        : ASTNode(Kind), value(std::move(val)), body(std::move(b)) {}
 };
 
 // Match statement node (e.g., match x { 0 -> stmt, _ -> stmt })
 struct MatchNode : ASTNode {
-    std::unique_ptr<ASTNode> expression; // Match expression (e.g., x)
-    std::vector<std::unique_ptr<MatchCaseNode>> cases; // List of cases
-    MatchNode(std::unique_ptr<ASTNode> expr, std::vector<std::unique_ptr<MatchCaseNode>> c)
-        : expression(std::move(expr)), cases(std::move(c)) {}
+    static constexpr NodeKind Kind = NodeKind::Match;
+    NodePtr<ASTNode> expression; // Match expression (e.g., x)
+    std::vector<NodePtr<MatchCaseNode>> cases; // List of cases
+    MatchNode(NodePtr<ASTNode> expr, std::vector<NodePtr<MatchCaseNode>> c)
+        : ASTNode(Kind), expression(std::move(expr)), cases(std::move(c)) {}
 };
 
+// Calls f(child) for each non-null child of node, in evaluation order. The
+// child is passed as the NodePtr that holds it, so a pass can swap one out
+// in place; most are NodePtr<ASTNode>, but blocks of a try, match cases and
+// the parts of a multi-declaration keep their concrete type.
+template <typename F>
+void forEachChild(ASTNode& node, F&& f) {
+    auto visit = [&](auto& child) {
+        if (child) f(child);
+    };
+    switch (node.kind) {
+        case NodeKind::VarDecl: visit(static_cast<VarDeclNode&>(node).value); break;
+        case NodeKind::MultiVarDecl:
+            for (auto& decl : static_cast<MultiVarDeclNode&>(node).declarations) visit(decl);
+            break;
+        case NodeKind::Assign: visit(static_cast<AssignNode&>(node).value); break;
+        case NodeKind::CompoundAssign: visit(static_cast<CompoundAssignNode&>(node).value); break;
+        case NodeKind::BinaryOp: {
+            auto& binary = static_cast<BinaryOpNode&>(node);
+            visit(binary.left);
+            visit(binary.right);
+            break;
+        }
+        case NodeKind::UnaryOp: visit(static_cast<UnaryOpNode&>(node).operand); break;
+        case NodeKind::Concat: {
+            auto& concat = static_cast<ConcatNode&>(node);
+            visit(concat.left);
+            visit(concat.right);
+            break;
+        }
+        case NodeKind::Ternary: {
+            auto& ternary = static_cast<TernaryExprNode&>(node);
+            visit(ternary.condition);
+            visit(ternary.trueBranch);
+            visit(ternary.falseBranch);
+            break;
+        }
+        case NodeKind::ArrayLiteral:
+            for (auto& elem : static_cast<ArrayLiteralNode&>(node).elements) visit(elem);
+            break;
+        case NodeKind::Block:
+            for (auto& stmt : static_cast<BlockNode&>(node).statements) visit(stmt);
+            break;
+        case NodeKind::IfElse: {
+            auto& ifElse = static_cast<IfElseNode&>(node);
+            visit(ifElse.condition);
+            visit(ifElse.then_block);
+            visit(ifElse.else_block);
+            break;
+        }
+        case NodeKind::Print: visit(static_cast<PrintNode&>(node).expr); break;
+        case NodeKind::Loop: {
+            auto& loop = static_cast<LoopNode&>(node);
+            visit(loop.init);
+            visit(loop.collection);
+            visit(loop.condition);
+            visit(loop.body);
+            visit(loop.update);
+            break;
+        }
+        case NodeKind::TryCatch: {
+            auto& tryCatch = static_cast<TryCatchNode&>(node);
+            visit(tryCatch.tryBlock);
+            visit(tryCatch.catchBlock);
+            break;
+        }
+        case NodeKind::MatchCase: {
+            auto& matchCase = static_cast<MatchCaseNode&>(node);
+            visit(matchCase.value);
+            visit(matchCase.body);
+            break;
+        }
+        case NodeKind::Match: {
+            auto& match = static_cast<MatchNode&>(node);
+            visit(match.expression);
+            for (auto& caseNode : match.cases) visit(caseNode);
+            break;
+        }
+        default: break;  // leaves
+    }
+}
+
+// The arena skips destructors for these; keep them free of owning members.
+static_assert(std::is_trivially_destructible_v<IntLiteral> &&
+              std::is_trivially_destructible_v<VarRefNode> &&
+              std::is_trivially_destructible_v<BinaryOpNode> &&
+              std::is_trivially_destructible_v<AssignNode>,
+              "expression nodes should not need a destructor");
+
 #endif
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "codegen.h"
+#include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/MathExtras.h>
 #include <stdexcept>
 
 using namespace llvm;
@@ -7,8 +9,7 @@ using namespace llvm;
 CodeGen::CodeGen() :
     context(std::make_unique<LLVMContext>()),
     module(std::make_unique<Module>("main", *context)),
-    builder(std::make_unique<IRBuilder<>>(*context)),
-    arraySizes() {
+    builder(std::make_unique<IRBuilder<>>(*context)) {
 
     // Create main function
     FunctionType* mainType = FunctionType::get(Type::getInt32Ty(*context), false);
@@ -26,6 +27,9 @@ CodeGen::CodeGen() :
     // malloc: i8* (i32)
     FunctionType* mallocType = FunctionType::get(int8PtrTy, {int32Ty}, false);
     Function::Create(mallocType, Function::ExternalLinkage, "malloc", module.get());
+    // free: void (i8*)
+    FunctionType* freeType = FunctionType::get(Type::getVoidTy(*context), {int8PtrTy}, false);
+    Function::Create(freeType, Function::ExternalLinkage, "free", module.get());
     // memcpy: i8* (i8*, i8*, i32)
     FunctionType* memcpyType = FunctionType::get(int8PtrTy, {int8PtrTy, int8PtrTy, int32Ty}, false);
     Function::Create(memcpyType, Function::ExternalLinkage, "memcpy", module.get());
@@ -36,9 +40,11 @@ CodeGen::CodeGen() :
     // Create entry block
     BasicBlock* entry = BasicBlock::Create(*context, "entry", mainFunc);
     builder->SetInsertPoint(entry);
+    pushScope(); // globals; never popped
 }
 
 void CodeGen::generate(ProgramNode& ast) {
+    variables.assign(ast.slotCount, Variable());
     for (auto& stmt : ast.statements) {
         generateStatement(stmt.get());
     }
@@ -56,91 +62,203 @@ void CodeGen::generate(ProgramNode& ast) {
 }
 
 void CodeGen::generateStatement(ASTNode* node) {
-    if (auto multiVarDecl = dynamic_cast<MultiVarDeclNode*>(node)) {
-        // Handle multiple variable declarations
-        for (auto& decl : multiVarDecl->declarations) {
-            generateVarDecl(decl.get());
-        }
-    } else if (auto varDecl = dynamic_cast<VarDeclNode*>(node)) {
-        generateVarDecl(varDecl);
-    } else if (auto assign = dynamic_cast<AssignNode*>(node)) {
-        generateAssign(assign);
-    } else if (auto compound = dynamic_cast<CompoundAssignNode*>(node)) { // new
-        generateCompoundAssign(compound);
-    } else if (auto ifElseNode = dynamic_cast<IfElseNode*>(node)) {
-        // Handle if-else statement
-        generateIfElse(ifElseNode); // Call the updated generateIfElse
-    } else if (auto print = dynamic_cast<PrintNode*>(node)) {  // New case
-        generatePrint(print);
-    } else if (auto loop = dynamic_cast<LoopNode*>(node)) {
-        generateLoop(loop);
-    } else if (auto block = dynamic_cast<BlockNode*>(node)) { // New case
-        generateBlock(block);
-    } else if (auto concat = dynamic_cast<ConcatNode*>(node)) {
-        generateValue(concat, nullptr);
-    } else if (auto tryCatch = dynamic_cast<TryCatchNode*>(node)) { // NEW: Handle TryCatchNode
-        generateTryCatch(tryCatch);
-    } else if (auto unaryOp = dynamic_cast<UnaryOpNode*>(node)) {
-        generateValue(unaryOp, nullptr); // Handle x++, x--, arr[i]++, arr[i]--
-    } else if (auto match = dynamic_cast<MatchNode*>(node)) {
-        generateMatch(match);
-    } else {
-        throw std::runtime_error("Unknown statement type");
+    switch (node->kind) {
+        case NodeKind::MultiVarDecl:
+            // Handle multiple variable declarations
+            for (auto& decl : static_cast<MultiVarDeclNode*>(node)->declarations) {
+                generateVarDecl(decl.get());
+            }
+            break;
+        case NodeKind::VarDecl:
+            generateVarDecl(static_cast<VarDeclNode*>(node));
+            break;
+        case NodeKind::Assign:
+            generateAssign(static_cast<AssignNode*>(node));
+            break;
+        case NodeKind::CompoundAssign:
+            generateCompoundAssign(static_cast<CompoundAssignNode*>(node));
+            break;
+        case NodeKind::IfElse:
+            generateIfElse(static_cast<IfElseNode*>(node));
+            break;
+        case NodeKind::Print:
+            generatePrint(static_cast<PrintNode*>(node));
+            break;
+        case NodeKind::Loop:
+            generateLoop(static_cast<LoopNode*>(node));
+            break;
+        case NodeKind::Block:
+            generateBlock(static_cast<BlockNode*>(node));
+            break;
+        case NodeKind::Concat:
+            generateValue(node, nullptr);
+            break;
+        case NodeKind::TryCatch:
+            generateTryCatch(static_cast<TryCatchNode*>(node));
+            break;
+        case NodeKind::UnaryOp:
+            generateValue(node, nullptr); // Handle x++, x--, arr[i]++, arr[i]--
+            break;
+        case NodeKind::Match:
+            generateMatch(static_cast<MatchNode*>(node));
+            break;
+        default:
+            throw std::runtime_error("Unknown statement type");
     }
 }
 
-void CodeGen::generateVarDecl(VarDeclNode* node) {
-    // if (symbols.find(node->name) != symbols.end()) {
-    //     throw std::runtime_error("Redeclaration of variable: " + node->name);
-    // }
-    
-    // Create the appropriate type based on variable type
-    Type* type;
-    switch (node->type) {
-        case VarType::INT: type = Type::getInt32Ty(*context); break;
-        case VarType::BOOL: type = Type::getInt1Ty(*context); break;
-        case VarType::FLOAT: type = Type::getFloatTy(*context); break;
-        case VarType::CHAR: type = Type::getInt8Ty(*context); break;
-        case VarType::STRING: type = PointerType::get(Type::getInt8Ty(*context), 0); break;
-        case VarType::ARRAY: type = PointerType::get(Type::getInt32Ty(*context), 0); break; //////
-        case VarType::ERROR: type = PointerType::get(Type::getInt8Ty(*context), 0); break; // NEW: Error as i8*
+Type* CodeGen::llvmType(const ValueType& type) {
+    switch (type.kind) {
+        case VarType::INT: return Type::getInt32Ty(*context);
+        case VarType::BOOL: return Type::getInt1Ty(*context);
+        case VarType::FLOAT: return Type::getFloatTy(*context);
+        case VarType::CHAR: return Type::getInt8Ty(*context);
+        case VarType::STRING: return PointerType::get(Type::getInt8Ty(*context), 0);
+        case VarType::ARRAY: return PointerType::get(llvmType(type.element), 0);
+        case VarType::ERROR: return PointerType::get(Type::getInt8Ty(*context), 0); // Error as i8*
         default: throw std::runtime_error("Unknown variable type");
     }
-    
-    AllocaInst* alloca = builder->CreateAlloca(type, nullptr, node->name);
-    symbols[node->name] = alloca;
-    
-    if (node->value) { // CHANGED: initializer -> value
-        Value* val = generateValue(node->value.get(), type);
-        builder->CreateStore(val, alloca);
-        if (node->type == VarType::ARRAY && dynamic_cast<ArrayLiteralNode*>(node->value.get())) {
-            auto* arrLit = dynamic_cast<ArrayLiteralNode*>(node->value.get());
-            arraySizes[node->name] = arrLit->elements.size();
+}
+
+// Allocas go in the entry block, so a declaration inside a loop reuses one
+// stack slot instead of growing the frame on every iteration.
+AllocaInst* CodeGen::createEntryAlloca(Type* type, const std::string& name) {
+    BasicBlock& entry = builder->GetInsertBlock()->getParent()->getEntryBlock();
+    IRBuilder<> entryBuilder(&entry, entry.begin());
+    return entryBuilder.CreateAlloca(type, nullptr, name);
+}
+
+CodeGen::Variable& CodeGen::declareVariable(SlotId slot, SymbolId symbol, Type* type) {
+    if (slot >= variables.size()) {
+        throw std::runtime_error("Variable " + symbolName(symbol) + " has no slot; run SemanticAnalyzer first");
+    }
+    Variable& var = variables[slot];
+    if (var.live) {
+        // The optimizer copied this declaration into the same scope (an
+        // unrolled loop body); the earlier copy's value is dead here.
+        if (var.ownsBuffer) {
+            freeBuffer(builder->CreateLoad(var.alloca->getAllocatedType(), var.alloca));
         }
+        return var;
     }
+    if (!var.alloca) {
+        var.alloca = createEntryAlloca(type, symbolName(symbol));
+    }
+    builder->CreateLifetimeStart(var.alloca);
+    var.live = true;
+    scopeSlots.push_back(slot);
+    return var;
+}
 
+CodeGen::Variable& CodeGen::lookupVariable(SlotId slot, SymbolId symbol) {
+    if (slot >= variables.size() || !variables[slot].live) {
+        throw std::runtime_error("Undeclared variable: " + symbolName(symbol));
+    }
+    return variables[slot];
 }
 
-void CodeGen::generateAssign(AssignNode* node) {
-    auto it = symbols.find(node->name);
-    if (it == symbols.end()) {
-        throw std::runtime_error("Assignment to undeclared variable: " + node->name);
+void CodeGen::pushScope() {
+    scopeStarts.push_back(scopeSlots.size());
+}
+
+// Ends the innermost scope: frees the heap buffers its variables own and
+// marks their stack slots dead so LLVM can reuse them.
+void CodeGen::popScope() {
+    bool reachable = !builder->GetInsertBlock()->getTerminator();
+    for (size_t i = scopeSlots.size(); i > scopeStarts.back(); --i) {
+        Variable& var = variables[scopeSlots[i - 1]];
+        if (reachable) {
+            if (var.ownsBuffer) {
+                freeBuffer(builder->CreateLoad(var.alloca->getAllocatedType(), var.alloca));
+            }
+            builder->CreateLifetimeEnd(var.alloca);
+        }
+        var.live = false;
     }
-    
-    AllocaInst* alloca = it->second;
+    scopeSlots.resize(scopeStarts.back());
+    scopeStarts.pop_back();
+}
+
+void CodeGen::discardScopes(size_t depth) {
+    while (scopeStarts.size() > depth) {
+        for (size_t i = scopeStarts.back(); i < scopeSlots.size(); ++i) {
+            variables[scopeSlots[i]].live = false;
+        }
+        scopeSlots.resize(scopeStarts.back());
+        scopeStarts.pop_back();
+    }
+}
+
+void CodeGen::freeBuffer(Value* buffer) {
+    Type* int8PtrTy = PointerType::get(Type::getInt8Ty(*context), 0);
+    builder->CreateCall(module->getFunction("free"), {builder->CreateBitCast(buffer, int8PtrTy)});
+}
+
+// A variable that owns its buffer frees whatever it holds, so a string
+// literal stored there (a concat ConstantFolder folded) gets a heap copy.
+Value* CodeGen::ownedString(ASTNode* value, Value* generated) {
+    auto* strLit = node_cast<StrLiteral>(value);
+    if (!strLit) {
+        return generated;
+    }
+    Value* size = ConstantInt::get(Type::getInt32Ty(*context), strLit->value.size() + 1);
+    Value* copy = builder->CreateCall(module->getFunction("malloc"), size, "owned_str");
+    builder->CreateCall(module->getFunction("memcpy"), {copy, generated, size});
+    return copy;
+}
+
+void CodeGen::generateVarDecl(VarDeclNode* node) {
+    Type* type = llvmType(node->valueType);
+    bool runtimeLength = node->valueType.isArray() && !node->valueType.hasLength();
+    // The initializer sees the enclosing scope's binding of a shadowed name.
+    Value* val = nullptr;
+    Value* length = ConstantInt::get(Type::getInt32Ty(*context), 0); // `array a;` holds nothing yet
+    if (node->value && runtimeLength) {
+        ArrayValue array = generateArray(node->value.get(), type);
+        val = array.data;
+        length = array.length;
+    } else if (node->value) {
+        val = generateValue(node->value.get(), type);
+    }
+
+    Variable& var = declareVariable(node->slot, node->symbol, type);
+    var.ownsBuffer = node->ownsBuffer;
+    if (runtimeLength) {
+        if (!var.length) {
+            var.length = createEntryAlloca(Type::getInt32Ty(*context), symbolName(node->symbol) + ".length");
+        }
+        builder->CreateStore(length, var.length);
+    }
+    if (val && var.ownsBuffer) {
+        val = ownedString(node->value.get(), val);
+    }
+    if (val) {
+        builder->CreateStore(val, var.alloca);
+    }
+}
+
+void CodeGen::generateAssign(AssignNode* node) {
+    Variable var = lookupVariable(node->slot, node->symbol);
+    AllocaInst* alloca = var.alloca;
     Type* expectedType = alloca->getAllocatedType();
-    Value* val = generateValue(node->value.get(), expectedType);
-    
+    Value* val = nullptr;
+    if (var.length) {
+        ArrayValue array = generateArray(node->value.get(), expectedType);
+        val = array.data;
+        builder->CreateStore(array.length, var.length);
+    } else {
+        val = generateValue(node->value.get(), expectedType);
+    }
+
+    if (var.ownsBuffer) {
+        val = ownedString(node->value.get(), val);
+        freeBuffer(builder->CreateLoad(expectedType, alloca)); // nothing else points at it
+    }
     builder->CreateStore(val, alloca);
 }
 
 void CodeGen::generateCompoundAssign(CompoundAssignNode* node) {
-    auto it = symbols.find(node->name);
-    if (it == symbols.end()) {
-        throw std::runtime_error("Compound assignment to undeclared variable: " + node->name);
-    }
-
-    AllocaInst* alloca = it->second;
+    AllocaInst* alloca = lookupVariable(node->slot, node->symbol).alloca;
     Type* type = alloca->getAllocatedType();
 
     // Load current value
@@ -150,6 +268,10 @@ void CodeGen::generateCompoundAssign(CompoundAssignNode* node) {
     Value* rhs = generateValue(node->value.get(), type);
 
     // Perform the operation
+    if (Value* shifted = type->isFloatTy() ? nullptr : generatePowerOfTwoOp(node->op, current, rhs)) {
+        builder->CreateStore(shifted, alloca);
+        return;
+    }
     Value* result = nullptr;
     switch (node->op) {
         case BinaryOp::ADD:
@@ -190,7 +312,7 @@ void CodeGen::generateIfElse(IfElseNode* node) {
     builder->CreateCondBr(conditionValue, thenBlock, elseBlock ? elseBlock : afterIfElseBlock);
 
     builder->SetInsertPoint(thenBlock);
-    if (auto* block = dynamic_cast<BlockNode*>(node->then_block.get())) {
+    if (auto* block = node_cast<BlockNode>(node->then_block.get())) {
         generateBlock(block);
     } else {
         throw std::runtime_error("Expected BlockNode for then_block in IfElseNode");
@@ -202,9 +324,9 @@ void CodeGen::generateIfElse(IfElseNode* node) {
     if (elseBlock) {
         builder->SetInsertPoint(elseBlock);
         if (node->isElseIf()) {
-            generateIfElse(dynamic_cast<IfElseNode*>(node->else_block.get()));
+            generateIfElse(node_cast<IfElseNode>(node->else_block.get()));
             // Ensure the recursive call's block ends properly; rely on its after_if_else
-        } else if (auto* block = dynamic_cast<BlockNode*>(node->else_block.get())) {
+        } else if (auto* block = node_cast<BlockNode>(node->else_block.get())) {
             generateBlock(block);
             if (!builder->GetInsertBlock()->getTerminator()) {
                 builder->CreateBr(afterIfElseBlock);
@@ -222,147 +344,42 @@ void CodeGen::generateIfElse(IfElseNode* node) {
 }
 
 void CodeGen::generatePrint(PrintNode* node) {
-    Value* value = nullptr;
-    Type* valueType = nullptr;
-
-    if (auto* arrLit = dynamic_cast<ArrayLiteralNode*>(node->expr.get())) {
-        // CHANGED: Updated to support all variable types
-        Type* elemType = Type::getInt32Ty(*context); // Default
-        if (!arrLit->elements.empty()) {
-            ASTNode* firstElem = arrLit->elements[0].get();
-            if (dynamic_cast<IntLiteral*>(firstElem)) {
-                elemType = Type::getInt32Ty(*context);
-            } else if (dynamic_cast<FloatLiteral*>(firstElem)) {
-                elemType = Type::getFloatTy(*context);
-            } else if (dynamic_cast<BoolLiteral*>(firstElem)) {
-                elemType = Type::getInt1Ty(*context);
-            } else if (dynamic_cast<CharLiteral*>(firstElem)) {
-                elemType = Type::getInt8Ty(*context);
-            } else if (dynamic_cast<StrLiteral*>(firstElem)) {
-                elemType = PointerType::get(Type::getInt8Ty(*context), 0);
-            } else if (dynamic_cast<VarRefNode*>(firstElem)) {
-                auto it = symbols.find(dynamic_cast<VarRefNode*>(firstElem)->name);
-                if (it != symbols.end()) {
-                    Type* varType = it->second->getAllocatedType();
-                    // NEW: Use getContainedType for LLVM compatibility
-                    if (varType->isPointerTy()) {
-                        elemType = dyn_cast<PointerType>(varType)->getContainedType(0);
-                    } else {
-                        elemType = varType;
-                    }
-                }
-            }
-        }
-        std::vector<Value*> elements;
-        for (const auto& elem : arrLit->elements) {
-            // CHANGED: Use inferred elemType instead of int32
-            elements.push_back(generateValue(elem.get(), elemType));
-        }
-        // NEW: Inline printArray logic
-        Type* int32Ty = Type::getInt32Ty(*context);
-        Constant* openBracket = ConstantDataArray::getString(*context, "[", true);
-        GlobalVariable* openGV = new GlobalVariable(
-            *module, openBracket->getType(), true, GlobalValue::PrivateLinkage, openBracket, ".arr_open");
-        Value* openPtr = builder->CreateGEP(
-            openBracket->getType(), openGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-        builder->CreateCall(module->getFunction("printf"), {openPtr});
-        for (size_t i = 0; i < elements.size(); ++i) {
-            std::string formatStr = elemType == Type::getInt32Ty(*context) ? "%d" :
-                                   elemType == Type::getFloatTy(*context) ? "%g" :
-                                   elemType == Type::getInt1Ty(*context) ? "%d" :
-                                   elemType == Type::getInt8Ty(*context) ? "%c" :
-                                   "%s";
-            if (i < elements.size() - 1) formatStr += ", ";
-            Constant* formatConst = ConstantDataArray::getString(*context, formatStr, true);
-            GlobalVariable* formatGV = new GlobalVariable(
-                *module, formatConst->getType(), true, GlobalValue::PrivateLinkage, formatConst, ".arr_elem");
-            Value* formatPtr = builder->CreateGEP(
-                formatConst->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-            Value* printVal = elements[i];
-            if (elemType == Type::getFloatTy(*context)) {
-                printVal = builder->CreateFPExt(printVal, Type::getDoubleTy(*context));
-            } else if (elemType == Type::getInt1Ty(*context) || elemType == Type::getInt8Ty(*context)) {
-                printVal = builder->CreateZExt(printVal, int32Ty);
+    ASTNode* expr = node->expr.get();
+    Type* int32Ty = Type::getInt32Ty(*context);
+
+    if (expr->valueType.isArray()) {
+        Type* elemType = llvmType(expr->valueType.element);
+        if (auto* arrLit = node_cast<ArrayLiteralNode>(expr)) {
+            std::vector<Value*> elements;
+            for (const auto& elem : arrLit->elements) {
+                elements.push_back(generateValue(elem.get(), elemType));
             }
-            builder->CreateCall(module->getFunction("printf"), {formatPtr, printVal});
-        }
-        Constant* closeBracket = ConstantDataArray::getString(*context, "]\n", true);
-        GlobalVariable* closeGV = new GlobalVariable(
-            *module, closeBracket->getType(), true, GlobalValue::PrivateLinkage, closeBracket, ".arr_close");
-        Value* closePtr = builder->CreateGEP(
-            closeBracket->getType(), closeGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-        builder->CreateCall(module->getFunction("printf"), {closePtr});
-        return;
-    } else if (auto* varRef = dynamic_cast<VarRefNode*>(node->expr.get())) {
-        auto it = symbols.find(varRef->name);
-        if (it == symbols.end()) {
-            throw std::runtime_error("Undefined variable: " + varRef->name);
-        }
-        valueType = it->second->getAllocatedType();
-        value = builder->CreateLoad(valueType, it->second);
-        if (valueType == PointerType::get(Type::getInt8Ty(*context), 0)) { // String variable
-            // Already loaded correctly
-        } else if (valueType->isPointerTy()) { // CHANGED: Updated to support all array types
-            auto sizeIt = arraySizes.find(varRef->name);
-            uint64_t size = sizeIt != arraySizes.end() ? sizeIt->second : 5;
-            // NEW: Inline printArrayVar logic with dynamic element type
-            Type* elemType = dyn_cast<PointerType>(valueType)->getContainedType(0);
-            Type* int32Ty = Type::getInt32Ty(*context);
             Constant* openBracket = ConstantDataArray::getString(*context, "[", true);
             GlobalVariable* openGV = new GlobalVariable(
                 *module, openBracket->getType(), true, GlobalValue::PrivateLinkage, openBracket, ".arr_open");
             Value* openPtr = builder->CreateGEP(
                 openBracket->getType(), openGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
             builder->CreateCall(module->getFunction("printf"), {openPtr});
-            Function* func = builder->GetInsertBlock()->getParent();
-            BasicBlock* loopStart = BasicBlock::Create(*context, "arr_print_loop", func);
-            BasicBlock* loopBody = BasicBlock::Create(*context, "arr_print_body", func);
-            BasicBlock* loopEnd = BasicBlock::Create(*context, "arr_print_end", func);
-            AllocaInst* index = builder->CreateAlloca(int32Ty, nullptr, "print_idx");
-            builder->CreateStore(ConstantInt::get(int32Ty, 0), index);
-            builder->CreateBr(loopStart);
-            builder->SetInsertPoint(loopStart);
-            Value* idx = builder->CreateLoad(int32Ty, index);
-            Value* cond = builder->CreateICmpSLT(idx, ConstantInt::get(int32Ty, size));
-            builder->CreateCondBr(cond, loopBody, loopEnd);
-            builder->SetInsertPoint(loopBody);
-            Value* elemPtr = builder->CreateGEP(elemType, value, idx);
-            Value* elem = builder->CreateLoad(elemType, elemPtr);
-            std::string formatStr = elemType == Type::getInt32Ty(*context) ? "%d" :
-                                   elemType == Type::getFloatTy(*context) ? "%g" :
-                                   elemType == Type::getInt1Ty(*context) ? "%d" :
-                                   elemType == Type::getInt8Ty(*context) ? "%c" :
-                                   "%s";
-            Constant* formatConst = ConstantDataArray::getString(*context, formatStr, true);
-            GlobalVariable* formatGV = new GlobalVariable(
-                *module, formatConst->getType(), true, GlobalValue::PrivateLinkage, formatConst, ".arr_elem");
-            Value* formatPtr = builder->CreateGEP(
-                formatConst->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-            Value* printVal = elem;
-            if (elemType == Type::getFloatTy(*context)) {
-                printVal = builder->CreateFPExt(printVal, Type::getDoubleTy(*context));
-            } else if (elemType == Type::getInt1Ty(*context) || elemType == Type::getInt8Ty(*context)) {
-                printVal = builder->CreateZExt(printVal, int32Ty);
+            for (size_t i = 0; i < elements.size(); ++i) {
+                std::string formatStr = elemType == Type::getInt32Ty(*context) ? "%d" :
+                                       elemType == Type::getFloatTy(*context) ? "%g" :
+                                       elemType == Type::getInt1Ty(*context) ? "%d" :
+                                       elemType == Type::getInt8Ty(*context) ? "%c" :
+                                       "%s";
+                if (i < elements.size() - 1) formatStr += ", ";
+                Constant* formatConst = ConstantDataArray::getString(*context, formatStr, true);
+                GlobalVariable* formatGV = new GlobalVariable(
+                    *module, formatConst->getType(), true, GlobalValue::PrivateLinkage, formatConst, ".arr_elem");
+                Value* formatPtr = builder->CreateGEP(
+                    formatConst->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
+                Value* printVal = elements[i];
+                if (elemType == Type::getFloatTy(*context)) {
+                    printVal = builder->CreateFPExt(printVal, Type::getDoubleTy(*context));
+                } else if (elemType == Type::getInt1Ty(*context) || elemType == Type::getInt8Ty(*context)) {
+                    printVal = builder->CreateZExt(printVal, int32Ty);
+                }
+                builder->CreateCall(module->getFunction("printf"), {formatPtr, printVal});
             }
-            builder->CreateCall(module->getFunction("printf"), {formatPtr, printVal});
-            Value* isNotLast = builder->CreateICmpSLT(
-                idx, ConstantInt::get(int32Ty, size - 1));
-            BasicBlock* commaBB = BasicBlock::Create(*context, "print_comma", func);
-            BasicBlock* afterCommaBB = BasicBlock::Create(*context, "after_comma", func);
-            builder->CreateCondBr(isNotLast, commaBB, afterCommaBB);
-            builder->SetInsertPoint(commaBB);
-            Constant* commaStr = ConstantDataArray::getString(*context, ", ", true);
-            GlobalVariable* commaGV = new GlobalVariable(
-                *module, commaStr->getType(), true, GlobalValue::PrivateLinkage, commaStr, ".comma");
-            Value* commaPtr = builder->CreateGEP(
-                commaStr->getType(), commaGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-            builder->CreateCall(module->getFunction("printf"), {commaPtr});
-            builder->CreateBr(afterCommaBB);
-            builder->SetInsertPoint(afterCommaBB);
-            Value* nextIdx = builder->CreateAdd(idx, ConstantInt::get(int32Ty, 1));
-            builder->CreateStore(nextIdx, index);
-            builder->CreateBr(loopStart);
-            builder->SetInsertPoint(loopEnd);
             Constant* closeBracket = ConstantDataArray::getString(*context, "]\n", true);
             GlobalVariable* closeGV = new GlobalVariable(
                 *module, closeBracket->getType(), true, GlobalValue::PrivateLinkage, closeBracket, ".arr_close");
@@ -371,98 +388,64 @@ void CodeGen::generatePrint(PrintNode* node) {
             builder->CreateCall(module->getFunction("printf"), {closePtr});
             return;
         }
-    } else if (auto* intLit = dynamic_cast<IntLiteral*>(node->expr.get())) {
-        value = generateValue(node->expr.get(), Type::getInt32Ty(*context));
-        valueType = Type::getInt32Ty(*context);
-    } else if (auto* floatLit = dynamic_cast<FloatLiteral*>(node->expr.get())) {
-        value = generateValue(node->expr.get(), Type::getFloatTy(*context));
-        valueType = Type::getFloatTy(*context);
-    } else if (auto* boolLit = dynamic_cast<BoolLiteral*>(node->expr.get())) {
-        value = generateValue(node->expr.get(), Type::getInt1Ty(*context));
-        valueType = Type::getInt1Ty(*context);
-    } else if (auto* charLit = dynamic_cast<CharLiteral*>(node->expr.get())) {
-        value = generateValue(node->expr.get(), Type::getInt8Ty(*context));
-        valueType = Type::getInt8Ty(*context);
-    } else if (auto* strLit = dynamic_cast<StrLiteral*>(node->expr.get())) {
-        value = generateValue(node->expr.get(), PointerType::get(Type::getInt8Ty(*context), 0));
-        valueType = PointerType::get(Type::getInt8Ty(*context), 0);
-    } else if (auto* concat = dynamic_cast<ConcatNode*>(node->expr.get())) {
-        value = generateValue(node->expr.get(), PointerType::get(Type::getInt8Ty(*context), 0));
-        valueType = PointerType::get(Type::getInt8Ty(*context), 0);
-    } else if (auto* binOp = dynamic_cast<BinaryOpNode*>(node->expr.get())) {
-        if (binOp->op == BinaryOp::EQUAL || binOp->op == BinaryOp::LESS_EQUAL ||
-            binOp->op == BinaryOp::NOT_EQUAL || binOp->op == BinaryOp::GREATER ||
-            binOp->op == BinaryOp::GREATER_EQUAL || binOp->op == BinaryOp::LESS ||
-            binOp->op == BinaryOp::AND || binOp->op == BinaryOp::OR) {
-            value = generateValue(node->expr.get(), Type::getInt1Ty(*context));
-            valueType = Type::getInt1Ty(*context);
-        } else if (binOp->op == BinaryOp::INDEX) {
-            value = generateValue(node->expr.get(), Type::getInt32Ty(*context));
-            valueType = Type::getInt32Ty(*context);
-        } else if (binOp->op == BinaryOp::MULTIPLY_ARRAY || binOp->op == BinaryOp::ADD_ARRAY ||
-                   binOp->op == BinaryOp::SUBTRACT_ARRAY || binOp->op == BinaryOp::DIVIDE_ARRAY) {
-            value = generateValue(node->expr.get(), PointerType::get(Type::getInt32Ty(*context), 0));
-            valueType = PointerType::get(Type::getInt32Ty(*context), 0);
-            auto* varRef = dynamic_cast<VarRefNode*>(binOp->left.get());
-            uint64_t size = 5;
-            if (varRef) {
-                auto sizeIt = arraySizes.find(varRef->name);
-                if (sizeIt != arraySizes.end()) size = sizeIt->second;
-            }
-            printArrayVar(value, size);
-            return;
-        } else {
-            value = generateValue(node->expr.get(), Type::getInt32Ty(*context));
-            valueType = Type::getInt32Ty(*context);
-        }
-    } else if (auto* unaryOp = dynamic_cast<UnaryOpNode*>(node->expr.get())) {
-        value = generateValue(node->expr.get(), Type::getInt32Ty(*context));
-        valueType = Type::getInt32Ty(*context);
-    } else {
-        throw std::runtime_error("Unsupported type in print()");
+        ArrayValue array = generateArray(expr, PointerType::get(elemType, 0));
+        printArrayVar(array.data, array.length, elemType);
+        return;
     }
 
-    Type* int32Ty = Type::getInt32Ty(*context);
-    if (valueType == Type::getInt32Ty(*context)) {
-        Constant* formatStr = ConstantDataArray::getString(*context, "%d\n", true);
-        GlobalVariable* formatGV = new GlobalVariable(
-            *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".int_fmt");
-        Value* formatPtr = builder->CreateGEP(
-            formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-        builder->CreateCall(module->getFunction("printf"), {formatPtr, value});
-    } else if (valueType == Type::getFloatTy(*context)) {
-        Constant* formatStr = ConstantDataArray::getString(*context, "%g\n", true);
-        GlobalVariable* formatGV = new GlobalVariable(
-            *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".float_fmt");
-        Value* formatPtr = builder->CreateGEP(
-            formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-        Value* extValue = builder->CreateFPExt(value, Type::getDoubleTy(*context)); // printf expects double
-        builder->CreateCall(module->getFunction("printf"), {formatPtr, extValue});
-    } else if (valueType == Type::getInt1Ty(*context)) {
-        Constant* formatStr = ConstantDataArray::getString(*context, "%d\n", true);
-        GlobalVariable* formatGV = new GlobalVariable(
-            *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".bool_fmt");
-        Value* formatPtr = builder->CreateGEP(
-            formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-        Value* extValue = builder->CreateZExt(value, int32Ty);
-        builder->CreateCall(module->getFunction("printf"), {formatPtr, extValue});
-    } else if (valueType == Type::getInt8Ty(*context)) {
-        Constant* formatStr = ConstantDataArray::getString(*context, "%c\n", true);
-        GlobalVariable* formatGV = new GlobalVariable(
-            *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".char_fmt");
-        Value* formatPtr = builder->CreateGEP(
-            formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-        Value* extValue = builder->CreateZExt(value, int32Ty); // printf expects int for %c
-        builder->CreateCall(module->getFunction("printf"), {formatPtr, extValue});
-    } else if (valueType == PointerType::get(Type::getInt8Ty(*context), 0)) {
-        Constant* formatStr = ConstantDataArray::getString(*context, "%s\n", true);
-        GlobalVariable* formatGV = new GlobalVariable(
-            *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".str_fmt");
-        Value* formatPtr = builder->CreateGEP(
-            formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
-        builder->CreateCall(module->getFunction("printf"), {formatPtr, value});
-    } else {
-        throw std::runtime_error("Unsupported type in print()");
+    Value* value = generateValue(expr, llvmType(expr->valueType));
+    switch (expr->valueType.kind) {
+        case VarType::INT: {
+            Constant* formatStr = ConstantDataArray::getString(*context, "%d\n", true);
+            GlobalVariable* formatGV = new GlobalVariable(
+                *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".int_fmt");
+            Value* formatPtr = builder->CreateGEP(
+                formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
+            builder->CreateCall(module->getFunction("printf"), {formatPtr, value});
+            break;
+        }
+        case VarType::FLOAT: {
+            Constant* formatStr = ConstantDataArray::getString(*context, "%g\n", true);
+            GlobalVariable* formatGV = new GlobalVariable(
+                *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".float_fmt");
+            Value* formatPtr = builder->CreateGEP(
+                formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
+            Value* extValue = builder->CreateFPExt(value, Type::getDoubleTy(*context)); // printf expects double
+            builder->CreateCall(module->getFunction("printf"), {formatPtr, extValue});
+            break;
+        }
+        case VarType::BOOL: {
+            Constant* formatStr = ConstantDataArray::getString(*context, "%d\n", true);
+            GlobalVariable* formatGV = new GlobalVariable(
+                *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".bool_fmt");
+            Value* formatPtr = builder->CreateGEP(
+                formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
+            Value* extValue = builder->CreateZExt(value, int32Ty);
+            builder->CreateCall(module->getFunction("printf"), {formatPtr, extValue});
+            break;
+        }
+        case VarType::CHAR: {
+            Constant* formatStr = ConstantDataArray::getString(*context, "%c\n", true);
+            GlobalVariable* formatGV = new GlobalVariable(
+                *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".char_fmt");
+            Value* formatPtr = builder->CreateGEP(
+                formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
+            Value* extValue = builder->CreateZExt(value, int32Ty); // printf expects int for %c
+            builder->CreateCall(module->getFunction("printf"), {formatPtr, extValue});
+            break;
+        }
+        case VarType::STRING:
+        case VarType::ERROR: {
+            Constant* formatStr = ConstantDataArray::getString(*context, "%s\n", true);
+            GlobalVariable* formatGV = new GlobalVariable(
+                *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".str_fmt");
+            Value* formatPtr = builder->CreateGEP(
+                formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
+            builder->CreateCall(module->getFunction("printf"), {formatPtr, value});
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported type in print()");
     }
 }
 
@@ -470,16 +453,20 @@ void CodeGen::generateBlock(BlockNode* blockNode) {
     if (!blockNode) {
         throw std::runtime_error("Null BlockNode");
     }
+    pushScope();
     for (const auto& statement : blockNode->statements) {
         if (!statement) {
             continue;
         }
+        size_t depth = scopeStarts.size();
         try {
             generateStatement(statement.get());
         } catch (const std::exception& e) {
+            discardScopes(depth); // any the failed statement left open
             continue;
         }
     }
+    popScope();
 }
 
 void CodeGen::generateLoop(LoopNode* node) {
@@ -489,6 +476,7 @@ void CodeGen::generateLoop(LoopNode* node) {
     BasicBlock* loopEnd = BasicBlock::Create(*context, "loop_end", func);
 
     if (node->type == LoopType::For) {
+        pushScope(); // the loop variable's
         if (node->init) generateStatement(node->init.get());
         builder->CreateBr(loopStart);
 
@@ -503,115 +491,132 @@ void CodeGen::generateLoop(LoopNode* node) {
         builder->CreateBr(loopStart);
 
         builder->SetInsertPoint(loopEnd);
+        popScope();
     } else { // Foreach
-        // Generate collection value
-        Value* arrayVal = generateValue(node->collection.get(), PointerType::get(Type::getInt32Ty(*context), 0));
-        if (!arrayVal->getType()->isPointerTy()) {
-            throw std::runtime_error("Foreach collection must be an array pointer");
-        }
-
-        // Determine array size
-        uint64_t arraySize = 0;
-        if (auto* varRef = dynamic_cast<VarRefNode*>(node->collection.get())) {
-            auto sizeIt = arraySizes.find(varRef->name);
-            if (sizeIt == arraySizes.end()) {
-                throw std::runtime_error("Array size not found for: " + varRef->name);
-            }
-            arraySize = sizeIt->second;
-        } else if (auto* arrLit = dynamic_cast<ArrayLiteralNode*>(node->collection.get())) {
-            arraySize = arrLit->elements.size();
-        } else if (auto* binOp = dynamic_cast<BinaryOpNode*>(node->collection.get())) {
-            if (binOp->op == BinaryOp::MULTIPLY_ARRAY || binOp->op == BinaryOp::ADD_ARRAY ||
-                binOp->op == BinaryOp::SUBTRACT_ARRAY || binOp->op == BinaryOp::DIVIDE_ARRAY) {
-                if (auto* varRef = dynamic_cast<VarRefNode*>(binOp->left.get())) {
-                    auto sizeIt = arraySizes.find(varRef->name);
-                    if (sizeIt == arraySizes.end()) {
-                        throw std::runtime_error("Array size not found for operation");
-                    }
-                    arraySize = sizeIt->second;
-                } else {
-                    throw std::runtime_error("Array operation must use named array");
-                }
-            } else {
-                throw std::runtime_error("Invalid array operation in foreach");
-            }
-        } else {
-            throw std::runtime_error("Foreach collection must be an array variable, literal, or operation");
-        }
+        // The trip count is a constant where the analyzer proved the length.
+        const ValueType& collType = node->collection->valueType;
+        Type* int32Ty = Type::getInt32Ty(*context);
+        Type* elemType = llvmType(collType.element);
+        ArrayValue array = generateArray(node->collection.get(), PointerType::get(elemType, 0));
 
-        AllocaInst* index = builder->CreateAlloca(Type::getInt32Ty(*context), nullptr, "foreach_idx");
-        builder->CreateStore(ConstantInt::get(Type::getInt32Ty(*context), 0), index);
-        AllocaInst* var = builder->CreateAlloca(Type::getInt32Ty(*context), nullptr, node->varName);
-        symbols[node->varName] = var;
+        AllocaInst* index = createEntryAlloca(int32Ty, "foreach_idx");
+        builder->CreateStore(ConstantInt::get(int32Ty, 0), index);
+        pushScope();
+        AllocaInst* var = declareVariable(node->varSlot, node->varSymbol, elemType).alloca;
 
         builder->CreateBr(loopStart);
         builder->SetInsertPoint(loopStart);
-        Value* idx = builder->CreateLoad(Type::getInt32Ty(*context), index);
-        Value* cond = builder->CreateICmpSLT(idx, ConstantInt::get(Type::getInt32Ty(*context), arraySize));
+        Value* idx = builder->CreateLoad(int32Ty, index);
+        Value* cond = builder->CreateICmpSLT(idx, array.length);
         builder->CreateCondBr(cond, loopBody, loopEnd);
 
         builder->SetInsertPoint(loopBody);
-        Value* elementPtr = builder->CreateGEP(Type::getInt32Ty(*context), arrayVal, idx);
-        Value* element = builder->CreateLoad(Type::getInt32Ty(*context), elementPtr);
+        Value* elementPtr = builder->CreateGEP(elemType, array.data, idx);
+        Value* element = builder->CreateLoad(elemType, elementPtr);
         builder->CreateStore(element, var);
-        if (auto* block = dynamic_cast<BlockNode*>(node->body.get())) {
+        if (auto* block = node_cast<BlockNode>(node->body.get())) {
             generateBlock(block);
         } else {
             throw std::runtime_error("Foreach body must be a BlockNode");
         }
-        Value* nextIdx = builder->CreateAdd(idx, ConstantInt::get(Type::getInt32Ty(*context), 1));
+        Value* nextIdx = builder->CreateAdd(idx, ConstantInt::get(int32Ty, 1));
         builder->CreateStore(nextIdx, index);
         builder->CreateBr(loopStart);
 
         builder->SetInsertPoint(loopEnd);
-        symbols.erase(node->varName);
+        popScope();
     }
 }
 
+// Integer pow by squaring: O(log exp) multiplies, wrapping like repeated
+// multiplication would. A negative exponent gives 1.
 llvm::Value* CodeGen::generatePow(llvm::Value* base, llvm::Value* exp) {
     if (!base->getType()->isIntegerTy(32) || !exp->getType()->isIntegerTy(32)) {
         throw std::runtime_error("pow arguments must be integers");
     }
-    // Initialize result = 1
-    llvm::Value* result = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), 1);
-
-    // Create basic blocks
-    llvm::Function* func = builder->GetInsertBlock()->getParent();
-    llvm::BasicBlock* entryBB = builder->GetInsertBlock();
-    llvm::BasicBlock* loopBB = llvm::BasicBlock::Create(*context, "pow_loop", func);
-    llvm::BasicBlock* bodyBB = llvm::BasicBlock::Create(*context, "pow_body", func);
-    llvm::BasicBlock* endBB = llvm::BasicBlock::Create(*context, "pow_end", func);
-
-    // Check if exp >= 0
-    llvm::Value* zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), 0);
-    llvm::Value* isNonNeg = builder->CreateICmpSGE(exp, zero, "is_nonneg");
-    builder->CreateCondBr(isNonNeg, loopBB, endBB);
-
-    // Loop block
+    Type* int32Ty = Type::getInt32Ty(*context);
+    Value* one = ConstantInt::get(int32Ty, 1);
+    Value* zero = ConstantInt::get(int32Ty, 0);
+
+    Function* func = builder->GetInsertBlock()->getParent();
+    BasicBlock* entryBB = builder->GetInsertBlock();
+    BasicBlock* loopBB = BasicBlock::Create(*context, "pow_loop", func);
+    BasicBlock* endBB = BasicBlock::Create(*context, "pow_end", func);
+    builder->CreateCondBr(builder->CreateICmpSGT(exp, zero, "exp_positive"), loopBB, endBB);
+
+    // Each iteration consumes the lowest bit of the exponent: the result
+    // takes the current power of the base when it is set, and the power
+    // squares for the next bit.
     builder->SetInsertPoint(loopBB);
-    llvm::PHINode* phi_result = builder->CreatePHI(llvm::Type::getInt32Ty(*context), 2, "result");
-    llvm::PHINode* phi_exp = builder->CreatePHI(llvm::Type::getInt32Ty(*context), 2, "exp");
-    phi_result->addIncoming(result, entryBB); // From entry
-    phi_exp->addIncoming(exp, entryBB);      // From entry
-
-    // Loop condition: exp > 0
-    llvm::Value* cond = builder->CreateICmpSGT(phi_exp, zero, "exp_positive");
-    builder->CreateCondBr(cond, bodyBB, endBB);
-
-    // Body: result *= base, exp--
-    builder->SetInsertPoint(bodyBB);
-    llvm::Value* new_result = builder->CreateMul(phi_result, base, "pow_mult");
-    llvm::Value* new_exp = builder->CreateSub(phi_exp, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), 1), "exp_decr");
-    phi_result->addIncoming(new_result, bodyBB); // Loop back
-    phi_exp->addIncoming(new_exp, bodyBB);      // Loop back
-    builder->CreateBr(loopBB);
-
-    // End block
+    PHINode* result = builder->CreatePHI(int32Ty, 2, "result");
+    PHINode* power = builder->CreatePHI(int32Ty, 2, "power");
+    PHINode* bits = builder->CreatePHI(int32Ty, 2, "bits");
+    result->addIncoming(one, entryBB);
+    power->addIncoming(base, entryBB);
+    bits->addIncoming(exp, entryBB);
+    Value* odd = builder->CreateICmpNE(builder->CreateAnd(bits, one), zero, "odd");
+    Value* nextResult = builder->CreateSelect(odd, builder->CreateMul(result, power, "pow_mult"), result);
+    Value* nextPower = builder->CreateMul(power, power, "pow_square");
+    Value* nextBits = builder->CreateLShr(bits, 1, "bits_shift");
+    result->addIncoming(nextResult, loopBB);
+    power->addIncoming(nextPower, loopBB);
+    bits->addIncoming(nextBits, loopBB);
+    builder->CreateCondBr(builder->CreateICmpNE(nextBits, zero, "bits_left"), loopBB, endBB);
+
     builder->SetInsertPoint(endBB);
-    llvm::PHINode* final_result = builder->CreatePHI(llvm::Type::getInt32Ty(*context), 2, "final_result");
-    final_result->addIncoming(result, entryBB);   // exp < 0
-    final_result->addIncoming(phi_result, loopBB); // exp <= 0
-    return final_result;
+    PHINode* finalResult = builder->CreatePHI(int32Ty, 2, "final_result");
+    finalResult->addIncoming(one, entryBB); // exp <= 0
+    finalResult->addIncoming(nextResult, loopBB);
+    return finalResult;
+}
+
+// pow with a constant exponent: the multiplies of generatePow, unrolled.
+llvm::Value* CodeGen::generatePowChain(llvm::Value* base, int32_t exp) {
+    if (exp <= 0) {
+        return ConstantInt::get(base->getType(), 1);
+    }
+    Value* result = base;
+    for (int bit = int(Log2_32(uint32_t(exp))) - 1; bit >= 0; --bit) {
+        result = builder->CreateMul(result, result, "pow_square");
+        if (exp & (1 << bit)) {
+            result = builder->CreateMul(result, base, "pow_mult");
+        }
+    }
+    return result;
+}
+
+// An int multiplied, divided or taken modulo by a constant power of two
+// 2^k, as shifts; null for other operands. Division rounds toward zero, so
+// a negative dividend is biased by 2^k - 1 before shifting right.
+llvm::Value* CodeGen::generatePowerOfTwoOp(BinaryOp op, llvm::Value* left, llvm::Value* right) {
+    if (op == BinaryOp::MULTIPLY && isa<ConstantInt>(left)) {
+        std::swap(left, right);
+    }
+    auto* constant = dyn_cast<ConstantInt>(right);
+    if (!constant || !left->getType()->isIntegerTy(32) || !constant->getValue().isPowerOf2() ||
+        constant->isNegative()) {
+        return nullptr;
+    }
+    unsigned k = constant->getValue().logBase2();
+    switch (op) {
+        case BinaryOp::MULTIPLY:
+            return builder->CreateShl(left, k);
+        case BinaryOp::DIVIDE:
+        case BinaryOp::MODULO: {
+            if (k == 0) {
+                return op == BinaryOp::DIVIDE ? left : ConstantInt::get(left->getType(), 0);
+            }
+            Value* bias = builder->CreateLShr(builder->CreateAShr(left, 31), 32 - k);
+            Value* biased = builder->CreateAdd(left, bias);
+            if (op == BinaryOp::DIVIDE) {
+                return builder->CreateAShr(biased, k);
+            }
+            Value* truncated = builder->CreateAnd(biased, ConstantInt::get(left->getType(), -(int64_t(1) << k)));
+            return builder->CreateSub(left, truncated);
+        }
+        default:
+            return nullptr;
+    }
 }
 
 void CodeGen::printArray(const std::vector<llvm::Value*>& elements) {
@@ -638,7 +643,7 @@ void CodeGen::printArray(const std::vector<llvm::Value*>& elements) {
     builder->CreateCall(module->getFunction("printf"), {closePtr});
 }
 
-void CodeGen::printArrayVar(llvm::Value* arrayPtr, uint64_t size) {
+void CodeGen::printArrayVar(llvm::Value* arrayPtr, llvm::Value* size, llvm::Type* elemType) {
     Type* int32Ty = Type::getInt32Ty(*context);
     Constant* openBracket = ConstantDataArray::getString(*context, "[", true);
     GlobalVariable* openGV = new GlobalVariable(
@@ -650,24 +655,34 @@ void CodeGen::printArrayVar(llvm::Value* arrayPtr, uint64_t size) {
     BasicBlock* loopStart = BasicBlock::Create(*context, "arr_print_loop", func);
     BasicBlock* loopBody = BasicBlock::Create(*context, "arr_print_body", func);
     BasicBlock* loopEnd = BasicBlock::Create(*context, "arr_print_end", func);
-    AllocaInst* index = builder->CreateAlloca(int32Ty, nullptr, "print_idx");
+    AllocaInst* index = createEntryAlloca(int32Ty, "print_idx");
     builder->CreateStore(ConstantInt::get(int32Ty, 0), index);
     builder->CreateBr(loopStart);
     builder->SetInsertPoint(loopStart);
     Value* idx = builder->CreateLoad(int32Ty, index);
-    Value* cond = builder->CreateICmpSLT(idx, ConstantInt::get(int32Ty, size));
+    Value* cond = builder->CreateICmpSLT(idx, size);
     builder->CreateCondBr(cond, loopBody, loopEnd);
     builder->SetInsertPoint(loopBody);
-    Value* elemPtr = builder->CreateGEP(Type::getInt32Ty(*context), arrayPtr, idx);
-    Value* elem = builder->CreateLoad(Type::getInt32Ty(*context), elemPtr);
-    Constant* formatStr = ConstantDataArray::getString(*context, "%d", true);
+    Value* elemPtr = builder->CreateGEP(elemType, arrayPtr, idx);
+    Value* elem = builder->CreateLoad(elemType, elemPtr);
+    std::string format = elemType == Type::getInt32Ty(*context) ? "%d" :
+                         elemType == Type::getFloatTy(*context) ? "%g" :
+                         elemType == Type::getInt1Ty(*context) ? "%d" :
+                         elemType == Type::getInt8Ty(*context) ? "%c" :
+                         "%s";
+    Constant* formatStr = ConstantDataArray::getString(*context, format, true);
     GlobalVariable* formatGV = new GlobalVariable(
         *module, formatStr->getType(), true, GlobalValue::PrivateLinkage, formatStr, ".arr_elem");
     Value* formatPtr = builder->CreateGEP(
         formatStr->getType(), formatGV, {ConstantInt::get(int32Ty, 0), ConstantInt::get(int32Ty, 0)});
+    if (elemType == Type::getFloatTy(*context)) {
+        elem = builder->CreateFPExt(elem, Type::getDoubleTy(*context));
+    } else if (elemType == Type::getInt1Ty(*context) || elemType == Type::getInt8Ty(*context)) {
+        elem = builder->CreateZExt(elem, int32Ty);
+    }
     builder->CreateCall(module->getFunction("printf"), {formatPtr, elem});
     Value* isNotLast = builder->CreateICmpSLT(
-        idx, ConstantInt::get(int32Ty, size - 1));
+        idx, builder->CreateSub(size, ConstantInt::get(int32Ty, 1)));
     BasicBlock* commaBB = BasicBlock::Create(*context, "print_comma", func);
     BasicBlock* afterCommaBB = BasicBlock::Create(*context, "after_comma", func);
     builder->CreateCondBr(isNotLast, commaBB, afterCommaBB);
@@ -711,12 +726,14 @@ void CodeGen::generateTryCatch(TryCatchNode* node) {
 
     builder->CreateBr(tryBlock);
     builder->SetInsertPoint(tryBlock);
-    if (auto* block = dynamic_cast<BlockNode*>(node->tryBlock.get())) {
+    if (auto* block = node_cast<BlockNode>(node->tryBlock.get())) {
+        pushScope();
         for (const auto& stmt : block->statements) {
             if (stmt) {
                 generateStatement(stmt.get());
             }
         }
+        popScope();
     } else {
         throw std::runtime_error("Expected BlockNode for try block");
     }
@@ -730,16 +747,16 @@ void CodeGen::generateTryCatch(TryCatchNode* node) {
     LandingPadInst* landingPad = builder->CreateLandingPad(landingPadType, 0, "landingpad");
     landingPad->addClause(ConstantPointerNull::get(int8PtrTy));
     Value* exceptionPtr = builder->CreateExtractValue(landingPad, 0, "exception");
-    if (!node->errorVar.empty()) {
-        AllocaInst* alloca = builder->CreateAlloca(int8PtrTy, nullptr, node->errorVar);
-        symbols[node->errorVar] = alloca;
+    pushScope();
+    if (node->errorSymbol != NoSymbol) {
+        AllocaInst* alloca = declareVariable(node->errorSlot, node->errorSymbol, int8PtrTy).alloca;
         builder->CreateStore(exceptionPtr, alloca);
     }
-    if (auto* block = dynamic_cast<BlockNode*>(node->catchBlock.get())) {
+    if (auto* block = node_cast<BlockNode>(node->catchBlock.get())) {
         for (const auto& stmt : block->statements) {
             if (stmt) {
-                if (auto* varDecl = dynamic_cast<VarDeclNode*>(stmt.get())) {
-                    if (varDecl->name == node->errorVar) {
+                if (auto* varDecl = node_cast<VarDeclNode>(stmt.get())) {
+                    if (varDecl->slot == node->errorSlot) {
                         continue;
                     }
                 }
@@ -749,6 +766,7 @@ void CodeGen::generateTryCatch(TryCatchNode* node) {
     } else {
         throw std::runtime_error("Expected BlockNode for catch block");
     }
+    popScope();
     if (!builder->GetInsertBlock()->getTerminator()) {
         builder->CreateBr(afterBlock);
     }
@@ -812,7 +830,7 @@ void CodeGen::generateMatch(MatchNode* node) {
     // Generate case bodies
     for (size_t i = 0; i < node->cases.size(); ++i) {
         builder->SetInsertPoint(caseBlocks[i]);
-        if (auto* block = dynamic_cast<BlockNode*>(node->cases[i]->body.get())) {
+        if (auto* block = node_cast<BlockNode>(node->cases[i]->body.get())) {
             generateBlock(block);
         } else {
             generateStatement(node->cases[i]->body.get());
@@ -835,397 +853,433 @@ void CodeGen::generateMatch(MatchNode* node) {
 //    return std::make_unique<UnaryOpNode>(UnaryOp::NEGATE, std::move(expr));
 //}
 llvm::Value* CodeGen::generateValue(ASTNode* node, llvm::Type* expectedType) {
-    if (auto ternaryExpr = dynamic_cast<TernaryExprNode*>(node)) {
-        // Generate code for the condition (e.g., z > 5)
-        llvm::Value* condValue = generateValue(ternaryExpr->condition.get(), Type::getInt1Ty(*context));
-        if (!condValue->getType()->isIntegerTy(1)) {
-            throw std::runtime_error("Ternary condition must evaluate to a boolean");
-        }
+    Type* int32Ty = Type::getInt32Ty(*context);
+    switch (node->kind) {
+        case NodeKind::Ternary: {
+            auto ternaryExpr = static_cast<TernaryExprNode*>(node);
+            // Generate code for the condition (e.g., z > 5)
+            llvm::Value* condValue = generateValue(ternaryExpr->condition.get(), Type::getInt1Ty(*context));
+            if (!condValue->getType()->isIntegerTy(1)) {
+                throw std::runtime_error("Ternary condition must evaluate to a boolean");
+            }
 
-        // Generate code for true and false branches
-        llvm::Value* trueValue = generateValue(ternaryExpr->trueBranch.get(), expectedType);
-        llvm::Value* falseValue = generateValue(ternaryExpr->falseBranch.get(), expectedType);
+            // Generate code for true and false branches
+            llvm::Value* trueValue = generateValue(ternaryExpr->trueBranch.get(), expectedType);
+            llvm::Value* falseValue = generateValue(ternaryExpr->falseBranch.get(), expectedType);
 
-        // Ensure true and false branches have the same type
-        if (trueValue->getType() != falseValue->getType()) {
-            throw std::runtime_error("Ternary branches must have the same type");
-        }
+            // Ensure true and false branches have the same type
+            if (trueValue->getType() != falseValue->getType()) {
+                throw std::runtime_error("Ternary branches must have the same type");
+            }
 
-        // If expectedType is provided and doesn't match, throw an error
-        if (expectedType && trueValue->getType() != expectedType) {
-            throw std::runtime_error("Ternary expression type does not match expected type");
-        }
+            // If expectedType is provided and doesn't match, throw an error
+            if (expectedType && trueValue->getType() != expectedType) {
+                throw std::runtime_error("Ternary expression type does not match expected type");
+            }
 
-        // Create select instruction
-        return builder->CreateSelect(condValue, trueValue, falseValue, "ternary_result");
-    }
-    else if (auto concat = dynamic_cast<ConcatNode*>(node)) {
-        if (!expectedType || !expectedType->isPointerTy()) {
-            throw std::runtime_error("Expected pointer type for string concatenation");
+            // Create select instruction
+            return builder->CreateSelect(condValue, trueValue, falseValue, "ternary_result");
         }
+        case NodeKind::Concat: {
+            auto concat = static_cast<ConcatNode*>(node);
+            if (!expectedType || !expectedType->isPointerTy()) {
+                throw std::runtime_error("Expected pointer type for string concatenation");
+            }
     
-        // Generate left and right operands
-        Value* left = generateValue(concat->left.get(), PointerType::get(Type::getInt8Ty(*context), 0));
-        Value* right = generateValue(concat->right.get(), PointerType::get(Type::getInt8Ty(*context), 0));
-    
-        // Check for null values
-        if (!left || !right) {
-            builder->CreateCall(module->getFunction("throwTypeError"), {});
-            return builder->CreateGlobalStringPtr(""); // Fallback
-        }
+            // Generate left and right operands
+            Value* left = generateValue(concat->left.get(), PointerType::get(Type::getInt8Ty(*context), 0));
+            Value* right = generateValue(concat->right.get(), PointerType::get(Type::getInt8Ty(*context), 0));
     
-        // Runtime type check: both operands must be i8*
-        Type* stringType = PointerType::get(Type::getInt8Ty(*context), 0);
-        if (left->getType() != stringType || right->getType() != stringType) {
-            builder->CreateCall(module->getFunction("throwTypeError"), {});
-            return builder->CreateGlobalStringPtr(""); // Fallback
-        }
+            Type* stringType = PointerType::get(Type::getInt8Ty(*context), 0);
     
-        // String concatenation logic
-        Function* func = builder->GetInsertBlock()->getParent();
-        BasicBlock* concatBlock = BasicBlock::Create(*context, "concat", func);
-        BasicBlock* afterBlock = BasicBlock::Create(*context, "after_concat", func);
+            // String concatenation logic
+            Function* func = builder->GetInsertBlock()->getParent();
+            BasicBlock* concatBlock = BasicBlock::Create(*context, "concat", func);
+            BasicBlock* afterBlock = BasicBlock::Create(*context, "after_concat", func);
     
-        builder->CreateBr(concatBlock);
-        builder->SetInsertPoint(concatBlock);
-        Value* leftLen = builder->CreateCall(module->getFunction("strlen"), left, "leftLen");
-        Value* rightLen = builder->CreateCall(module->getFunction("strlen"), right, "rightLen");
-        Value* totalLenNoNull = builder->CreateAdd(leftLen, rightLen, "totalLenNoNull");
-        Value* totalLen = builder->CreateAdd(totalLenNoNull, ConstantInt::get(Type::getInt32Ty(*context), 1), "totalLen");
-        Value* concatResult = builder->CreateCall(module->getFunction("malloc"), totalLen, "concatResult");
-        Value* leftMemLen = builder->CreateAdd(leftLen, ConstantInt::get(Type::getInt32Ty(*context), 1));
-        builder->CreateCall(module->getFunction("memcpy"), {concatResult, left, leftMemLen});
-        Value* destOffset = builder->CreateGEP(Type::getInt8Ty(*context), concatResult, leftLen, "destOffset");
-        Value* rightMemLen = builder->CreateAdd(rightLen, ConstantInt::get(Type::getInt32Ty(*context), 1));
-        builder->CreateCall(module->getFunction("memcpy"), {destOffset, right, rightMemLen});
-        builder->CreateBr(afterBlock);
+            builder->CreateBr(concatBlock);
+            builder->SetInsertPoint(concatBlock);
+            Value* leftLen = builder->CreateCall(module->getFunction("strlen"), left, "leftLen");
+            Value* rightLen = builder->CreateCall(module->getFunction("strlen"), right, "rightLen");
+            Value* totalLenNoNull = builder->CreateAdd(leftLen, rightLen, "totalLenNoNull");
+            Value* totalLen = builder->CreateAdd(totalLenNoNull, ConstantInt::get(Type::getInt32Ty(*context), 1), "totalLen");
+            Value* concatResult = builder->CreateCall(module->getFunction("malloc"), totalLen, "concatResult");
+            Value* leftMemLen = builder->CreateAdd(leftLen, ConstantInt::get(Type::getInt32Ty(*context), 1));
+            builder->CreateCall(module->getFunction("memcpy"), {concatResult, left, leftMemLen});
+            Value* destOffset = builder->CreateGEP(Type::getInt8Ty(*context), concatResult, leftLen, "destOffset");
+            Value* rightMemLen = builder->CreateAdd(rightLen, ConstantInt::get(Type::getInt32Ty(*context), 1));
+            builder->CreateCall(module->getFunction("memcpy"), {destOffset, right, rightMemLen});
+            builder->CreateBr(afterBlock);
     
-        builder->SetInsertPoint(afterBlock);
-        PHINode* result = builder->CreatePHI(stringType, 1, "concat_result");
-        result->addIncoming(concatResult, concatBlock);
-        return result;
-    }
-    else if (auto intLit = dynamic_cast<IntLiteral*>(node)) {
-        if (expectedType && expectedType->isIntegerTy()) {
+            builder->SetInsertPoint(afterBlock);
+            PHINode* result = builder->CreatePHI(stringType, 1, "concat_result");
+            result->addIncoming(concatResult, concatBlock);
+            return result;
+        }
+        case NodeKind::IntLiteral: {
+            auto intLit = static_cast<IntLiteral*>(node);
+            if (expectedType && expectedType->isIntegerTy()) {
+                return ConstantInt::get(Type::getInt32Ty(*context), intLit->value);
+            } else if (expectedType && expectedType->isFloatTy()) {
+                return ConstantFP::get(Type::getFloatTy(*context), static_cast<double>(intLit->value));
+            }
             return ConstantInt::get(Type::getInt32Ty(*context), intLit->value);
-        } else if (expectedType && expectedType->isFloatTy()) {
-            return ConstantFP::get(Type::getFloatTy(*context), static_cast<double>(intLit->value));
         }
-        return ConstantInt::get(Type::getInt32Ty(*context), intLit->value);
-    } else if (auto strLit = dynamic_cast<StrLiteral*>(node)) {
-        return builder->CreateGlobalStringPtr(strLit->value);
-    } else if (auto boolLit = dynamic_cast<BoolLiteral*>(node)) {
-        if (expectedType && !expectedType->isIntegerTy(1)) {
-            throw std::runtime_error("Expected boolean type");
+        case NodeKind::StrLiteral: {
+            auto strLit = static_cast<StrLiteral*>(node);
+            return builder->CreateGlobalStringPtr(strLit->value);
         }
-        return ConstantInt::get(Type::getInt1Ty(*context), boolLit->value);
-    } else if (auto charLit = dynamic_cast<CharLiteral*>(node)) {
-        if (expectedType && !expectedType->isIntegerTy(8)) {
-            throw std::runtime_error("Expected char (i8) type");
+        case NodeKind::BoolLiteral: {
+            auto boolLit = static_cast<BoolLiteral*>(node);
+            if (expectedType && !expectedType->isIntegerTy(1)) {
+                throw std::runtime_error("Expected boolean type");
+            }
+            return ConstantInt::get(Type::getInt1Ty(*context), boolLit->value);
+        }
+        case NodeKind::CharLiteral: {
+            auto charLit = static_cast<CharLiteral*>(node);
+            if (expectedType && !expectedType->isIntegerTy(8)) {
+                throw std::runtime_error("Expected char (i8) type");
+            }
+            return ConstantInt::get(Type::getInt8Ty(*context), charLit->value);
         }
-        return ConstantInt::get(Type::getInt8Ty(*context), charLit->value);
-    } else if (auto arrLit = dynamic_cast<ArrayLiteralNode*>(node)) {
-        if (!expectedType->isPointerTy()) {
-            throw std::runtime_error("Expected pointer type for array");
+        case NodeKind::ArrayLiteral: {
+            auto arrLit = static_cast<ArrayLiteralNode*>(node);
+            if (!expectedType->isPointerTy()) {
+                throw std::runtime_error("Expected pointer type for array");
+            }
+            Type* elemType = llvmType(arrLit->valueType.element);
+            size_t size = arrLit->elements.size();
+            // NEW: Allocate based on element type size
+            unsigned elemSize = elemType == Type::getFloatTy(*context) || elemType == Type::getInt32Ty(*context) ? 4 :
+                                elemType == Type::getInt1Ty(*context) ? 1 :
+                                elemType == Type::getInt8Ty(*context) ? 1 : 8; // i8* assumed 8 bytes
+            Value* sizeVal = ConstantInt::get(Type::getInt32Ty(*context), size * elemSize);
+            Value* mallocCall = builder->CreateCall(module->getFunction("malloc"), sizeVal);
+            Value* arrayPtr = builder->CreateBitCast(mallocCall, PointerType::get(elemType, 0));
+            for (size_t i = 0; i < size; ++i) {
+                Value* idx = ConstantInt::get(Type::getInt32Ty(*context), i);
+                Value* elemPtr = builder->CreateGEP(elemType, arrayPtr, idx);
+                Value* elemVal = generateValue(arrLit->elements[i].get(), elemType);
+                builder->CreateStore(elemVal, elemPtr);
+            }
+            if (arrayPtr->getType() != expectedType) {
+                arrayPtr = builder->CreateBitCast(arrayPtr, expectedType); // [] stored into array<float> etc.
+            }
+            return arrayPtr;
         }
-        // CHANGED: Dynamically infer element type
-        Type* elemType = Type::getInt32Ty(*context); // Default
-        if (!arrLit->elements.empty()) {
-            ASTNode* firstElem = arrLit->elements[0].get();
-            if (dynamic_cast<IntLiteral*>(firstElem)) {
-                elemType = Type::getInt32Ty(*context);
-            } else if (dynamic_cast<FloatLiteral*>(firstElem)) {
-                elemType = Type::getFloatTy(*context);
-            } else if (dynamic_cast<BoolLiteral*>(firstElem)) {
-                elemType = Type::getInt1Ty(*context);
-            } else if (dynamic_cast<CharLiteral*>(firstElem)) {
-                elemType = Type::getInt8Ty(*context);
-            } else if (dynamic_cast<StrLiteral*>(firstElem)) {
-                elemType = PointerType::get(Type::getInt8Ty(*context), 0);
-            } else if (dynamic_cast<VarRefNode*>(firstElem)) {
-                auto it = symbols.find(dynamic_cast<VarRefNode*>(firstElem)->name);
-                if (it != symbols.end()) {
-                    Type* varType = it->second->getAllocatedType();
-                    // NEW: Use getContainedType for LLVM compatibility
-                    if (varType->isPointerTy()) {
-                        elemType = dyn_cast<PointerType>(varType)->getContainedType(0);
+        case NodeKind::BinaryOp: {
+            auto binOp = static_cast<BinaryOpNode*>(node);
+            if (binOp->op == BinaryOp::METHOD_CALL) {
+                if (auto* strLit = node_cast<StrLiteral>(binOp->right.get())) {
+                    if (strLit->value == "toString") {
+                        if (!expectedType || !expectedType->isPointerTy()) {
+                            throw std::runtime_error("Expected pointer type for toString()");
+                        }
+                        Value* left = generateValue(binOp->left.get(), PointerType::get(Type::getInt8Ty(*context), 0));
+                        if (!left) {
+                            return builder->CreateGlobalStringPtr("exception");
+                        }
+                        return left; // Return the exception pointer as a string
+                    }
+                }
+                throw std::runtime_error("Unsupported method call");
+            }
+            if (binOp->op == BinaryOp::EQUAL || binOp->op == BinaryOp::LESS_EQUAL ||
+                binOp->op == BinaryOp::NOT_EQUAL || binOp->op == BinaryOp::GREATER ||
+                binOp->op == BinaryOp::GREATER_EQUAL || binOp->op == BinaryOp::LESS ||
+                binOp->op == BinaryOp::AND || binOp->op == BinaryOp::OR || binOp->op == BinaryOp::XOR) {
+                Value* left = generateValue(binOp->left.get(), binOp->op == BinaryOp::AND || binOp->op == BinaryOp::OR || binOp->op == BinaryOp::XOR ? Type::getInt1Ty(*context) : Type::getInt32Ty(*context));
+                Value* right = generateValue(binOp->right.get(), binOp->op == BinaryOp::AND || binOp->op == BinaryOp::OR || binOp->op == BinaryOp::XOR ? Type::getInt1Ty(*context) : Type::getInt32Ty(*context));
+                switch (binOp->op) {
+                    case BinaryOp::EQUAL: return builder->CreateICmpEQ(left, right);
+                    case BinaryOp::LESS_EQUAL: return builder->CreateICmpSLE(left, right);
+                    case BinaryOp::NOT_EQUAL: return builder->CreateICmpNE(left, right);
+                    case BinaryOp::GREATER: return builder->CreateICmpSGT(left, right);
+                    case BinaryOp::GREATER_EQUAL: return builder->CreateICmpSGE(left, right);
+                    case BinaryOp::LESS: return builder->CreateICmpSLT(left, right);
+                    case BinaryOp::AND: return builder->CreateAnd(left, right);
+                    case BinaryOp::OR: return builder->CreateOr(left, right);
+                    case BinaryOp::XOR: return builder->CreateXor(left, right);
+                
+                
+                    default: throw std::runtime_error("Unreachable");
+                }
+            } else if (binOp->op == BinaryOp::INDEX) {
+                Type* elemType = llvmType(binOp->valueType);
+                Value* arrayPtr = generateValue(binOp->left.get(), PointerType::get(elemType, 0));
+                Value* index = generateValue(binOp->right.get(), Type::getInt32Ty(*context));
+                Value* elemPtr = builder->CreateGEP(elemType, arrayPtr, index);
+                Value* elem = builder->CreateLoad(elemType, elemPtr);
+                if (expectedType && expectedType->isFloatTy() && elemType->isIntegerTy(32)) {
+                    return builder->CreateSIToFP(elem, expectedType);
+                }
+                return elem;
+            } else if (binOp->op == BinaryOp::MULTIPLY_ARRAY || binOp->op == BinaryOp::ADD_ARRAY ||
+                       binOp->op == BinaryOp::SUBTRACT_ARRAY || binOp->op == BinaryOp::DIVIDE_ARRAY) {
+                return generateArray(node, PointerType::get(llvmType(binOp->valueType.element), 0)).data;
+            } else if (binOp->op == BinaryOp::POW) {
+                // At the expression's own type like the arithmetic below:
+                // int pow by squaring, float pow through the LLVM intrinsics.
+                Type* type = llvmType(binOp->valueType);
+                Value* base = generateValue(binOp->left.get(), type);
+                Value* result = nullptr;
+                if (type->isFloatTy()) {
+                    if (binOp->right->valueType.kind == VarType::INT) {
+                        Value* exp = generateValue(binOp->right.get(), int32Ty);
+                        Function* powi = Intrinsic::getDeclaration(module.get(), Intrinsic::powi, {type, int32Ty});
+                        result = builder->CreateCall(powi, {base, exp});
                     } else {
-                        elemType = varType;
+                        Value* exp = generateValue(binOp->right.get(), type);
+                        Function* pow = Intrinsic::getDeclaration(module.get(), Intrinsic::pow, {type});
+                        result = builder->CreateCall(pow, {base, exp});
                     }
+                } else if (auto* exp = node_cast<IntLiteral>(binOp->right.get())) {
+                    result = generatePowChain(base, exp->value);
+                } else {
+                    result = generatePow(base, generateValue(binOp->right.get(), int32Ty));
+                }
+                if (expectedType && expectedType->isFloatTy() && !type->isFloatTy()) {
+                    return builder->CreateSIToFP(result, expectedType);
+                }
+                return result;
+            } else if (binOp->op == BinaryOp::ABS) {
+                Value* left = generateValue(binOp->left.get(), expectedType);
+                if (!left->getType()->isIntegerTy(32)) {
+                    throw std::runtime_error("abs argument must be an integer");
+                }
+                llvm::Value* zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), 0);
+                llvm::Value* isNeg = builder->CreateICmpSLT(left, zero, "is_neg");
+                llvm::Value* negExpr = builder->CreateSub(zero, left, "neg");
+                return builder->CreateSelect(isNeg, negExpr, left, "abs");
+            }
+            // Arithmetic happens at the expression's own type, so 7 / 2 is 3
+            // even where a float is expected; only the result is promoted.
+            Type* type = llvmType(binOp->valueType);
+            Value* left = generateValue(binOp->left.get(), type);
+            Value* right = generateValue(binOp->right.get(), type);
+            bool isFloat = type->isFloatTy();
+            Value* result = isFloat ? nullptr : generatePowerOfTwoOp(binOp->op, left, right);
+            if (!result) {
+                switch (binOp->op) {
+                    case BinaryOp::ADD:
+                        result = isFloat ? builder->CreateFAdd(left, right) : builder->CreateAdd(left, right);
+                        break;
+                    case BinaryOp::SUBTRACT:
+                        result = isFloat ? builder->CreateFSub(left, right) : builder->CreateSub(left, right);
+                        break;
+                    case BinaryOp::MULTIPLY:
+                        result = isFloat ? builder->CreateFMul(left, right) : builder->CreateMul(left, right);
+                        break;
+                    case BinaryOp::DIVIDE:
+                        result = isFloat ? builder->CreateFDiv(left, right) : builder->CreateSDiv(left, right);
+                        break;
+                    case BinaryOp::MODULO:
+                        result = isFloat ? builder->CreateFRem(left, right) : builder->CreateSRem(left, right);
+                        break;
+                    default:
+                        throw std::runtime_error("Unsupported binary operator");
                 }
             }
+            if (expectedType && expectedType->isFloatTy() && !isFloat) {
+                return builder->CreateSIToFP(result, expectedType);
+            }
+            return result;
         }
-        size_t size = arrLit->elements.size();
-        // NEW: Allocate based on element type size
-        unsigned elemSize = elemType == Type::getFloatTy(*context) || elemType == Type::getInt32Ty(*context) ? 4 :
-                            elemType == Type::getInt1Ty(*context) ? 1 :
-                            elemType == Type::getInt8Ty(*context) ? 1 : 8; // i8* assumed 8 bytes
-        Value* sizeVal = ConstantInt::get(Type::getInt32Ty(*context), size * elemSize);
-        Value* mallocCall = builder->CreateCall(module->getFunction("malloc"), sizeVal);
-        Value* arrayPtr = builder->CreateBitCast(mallocCall, PointerType::get(elemType, 0));
-        for (size_t i = 0; i < size; ++i) {
-            Value* idx = ConstantInt::get(Type::getInt32Ty(*context), i);
-            Value* elemPtr = builder->CreateGEP(elemType, arrayPtr, idx);
-            Value* elemVal = generateValue(arrLit->elements[i].get(), elemType);
-            builder->CreateStore(elemVal, elemPtr);
+        case NodeKind::VarRef: {
+            auto varRef = static_cast<VarRefNode*>(node);
+            AllocaInst* alloca = lookupVariable(varRef->slot, varRef->symbol).alloca;
+            Value* value = builder->CreateLoad(alloca->getAllocatedType(), alloca);
+            // The analyzer has already checked the types; only int-to-float
+            // promotion and array element views are left to convert.
+            if (expectedType && value->getType() != expectedType) {
+                if (expectedType->isFloatTy() && value->getType()->isIntegerTy(32)) {
+                    return builder->CreateSIToFP(value, expectedType);
+                }
+                if (expectedType->isPointerTy() && value->getType()->isPointerTy()) {
+                    return builder->CreateBitCast(value, expectedType);
+                }
+                throw std::runtime_error("Type mismatch: variable " + symbolName(varRef->symbol) + " has a different type");
+            }
+            return value;
         }
-        return arrayPtr;
-    } else if (auto binOp = dynamic_cast<BinaryOpNode*>(node)) {
-        if (binOp->op == BinaryOp::METHOD_CALL) {
-            if (auto* strLit = dynamic_cast<StrLiteral*>(binOp->right.get())) {
-                if (strLit->value == "toString") {
-                    if (!expectedType || !expectedType->isPointerTy()) {
-                        throw std::runtime_error("Expected pointer type for toString()");
+        case NodeKind::UnaryOp: {
+            auto unaryOp = static_cast<UnaryOpNode*>(node);
+            if (unaryOp->op == UnaryOp::INCREMENT || unaryOp->op == UnaryOp::DECREMENT) {
+                Value* ptr = nullptr;
+                if (auto* varRef = node_cast<VarRefNode>(unaryOp->operand.get())) {
+                    ptr = lookupVariable(varRef->slot, varRef->symbol).alloca;
+                } else if (auto* binOp = node_cast<BinaryOpNode>(unaryOp->operand.get())) {
+                    if (binOp->op != BinaryOp::INDEX) {
+                        throw std::runtime_error("Increment/decrement only supported on variables or array elements");
                     }
-                    Value* left = generateValue(binOp->left.get(), PointerType::get(Type::getInt8Ty(*context), 0));
-                    if (!left) {
-                        return builder->CreateGlobalStringPtr("exception");
-                    }
-                    return left; // Return the exception pointer as a string
+                    Type* elemType = llvmType(binOp->valueType);
+                    Value* arrayPtr = generateValue(binOp->left.get(), PointerType::get(elemType, 0));
+                    Value* index = generateValue(binOp->right.get(), Type::getInt32Ty(*context));
+                    ptr = builder->CreateGEP(elemType, arrayPtr, index);
+                } else {
+                    throw std::runtime_error("Increment/decrement only supported on variables or array elements");
+                }
+                Type* type = llvmType(unaryOp->operand->valueType);
+                Value* current = builder->CreateLoad(type, ptr);
+                Value* newVal = nullptr;
+                if (type->isFloatTy()) {
+                    Value* one = ConstantFP::get(type, 1.0);
+                    newVal = unaryOp->op == UnaryOp::INCREMENT ? builder->CreateFAdd(current, one)
+                                                              : builder->CreateFSub(current, one);
+                } else {
+                    Value* one = ConstantInt::get(type, 1);
+                    newVal = unaryOp->op == UnaryOp::INCREMENT ? builder->CreateAdd(current, one)
+                                                              : builder->CreateSub(current, one);
                 }
+                builder->CreateStore(newVal, ptr);
+                return current; // Return original value (postfix)
             }
-            throw std::runtime_error("Unsupported method call");
-        }
-        if (binOp->op == BinaryOp::EQUAL || binOp->op == BinaryOp::LESS_EQUAL ||
-            binOp->op == BinaryOp::NOT_EQUAL || binOp->op == BinaryOp::GREATER ||
-            binOp->op == BinaryOp::GREATER_EQUAL || binOp->op == BinaryOp::LESS ||
-            binOp->op == BinaryOp::AND || binOp->op == BinaryOp::OR || binOp->op == BinaryOp::XOR || binOp->op == BinaryOp::POW) {
-            Value* left = generateValue(binOp->left.get(), binOp->op == BinaryOp::AND || binOp->op == BinaryOp::OR || binOp->op == BinaryOp::XOR ? Type::getInt1Ty(*context) : Type::getInt32Ty(*context));
-            Value* right = generateValue(binOp->right.get(), binOp->op == BinaryOp::AND || binOp->op == BinaryOp::OR || binOp->op == BinaryOp::XOR ? Type::getInt1Ty(*context) : Type::getInt32Ty(*context));
-            switch (binOp->op) {
-                case BinaryOp::EQUAL: return builder->CreateICmpEQ(left, right);
-                case BinaryOp::LESS_EQUAL: return builder->CreateICmpSLE(left, right);
-                case BinaryOp::NOT_EQUAL: return builder->CreateICmpNE(left, right);
-                case BinaryOp::GREATER: return builder->CreateICmpSGT(left, right);
-                case BinaryOp::GREATER_EQUAL: return builder->CreateICmpSGE(left, right);
-                case BinaryOp::LESS: return builder->CreateICmpSLT(left, right);
-                case BinaryOp::AND: return builder->CreateAnd(left, right);
-                case BinaryOp::OR: return builder->CreateOr(left, right);
-                case BinaryOp::POW: return generatePow(left, right);
-                case BinaryOp::XOR: return builder->CreateXor(left, right);
-                
-                
-                default: throw std::runtime_error("Unreachable");
+            if (unaryOp->op == UnaryOp::NEGATE) {
+                Type* operandType = expectedType && expectedType->isFloatTy() ? Type::getFloatTy(*context) : Type::getInt32Ty(*context);
+                Value* operand = generateValue(unaryOp->operand.get(), operandType);
+                if (operand->getType()->isFloatTy()) {
+                    return builder->CreateFNeg(operand);
+                }
+                return builder->CreateNeg(operand);
             }
-        } else if (binOp->op == BinaryOp::INDEX) {
-            Value* arrayPtr = generateValue(binOp->left.get(), PointerType::get(Type::getInt32Ty(*context), 0));
-            Value* index = generateValue(binOp->right.get(), Type::getInt32Ty(*context));
-            Value* elemPtr = builder->CreateGEP(Type::getInt32Ty(*context), arrayPtr, index);
-            return builder->CreateLoad(Type::getInt32Ty(*context), elemPtr);
-        } else if (binOp->op == BinaryOp::MULTIPLY_ARRAY || binOp->op == BinaryOp::ADD_ARRAY ||
-                   binOp->op == BinaryOp::SUBTRACT_ARRAY || binOp->op == BinaryOp::DIVIDE_ARRAY) {
-            Value* arr1 = generateValue(binOp->left.get(), PointerType::get(Type::getInt32Ty(*context), 0));
-            Value* arr2 = generateValue(binOp->right.get(), PointerType::get(Type::getInt32Ty(*context), 0));
-            uint64_t size = 5;
-            if (auto* varRef = dynamic_cast<VarRefNode*>(binOp->left.get())) {
-                auto sizeIt = arraySizes.find(varRef->name);
-                if (sizeIt != arraySizes.end()) size = sizeIt->second;
+            const ValueType& arrayType = unaryOp->operand->valueType;
+            if (unaryOp->op == UnaryOp::LENGTH) {
+                if (arrayType.hasLength()) {
+                    return ConstantInt::get(Type::getInt32Ty(*context), arrayType.length);
+                }
+                return generateArray(unaryOp->operand.get(), llvmType(arrayType)).length;
             }
-            Type* elemType = Type::getInt32Ty(*context);
-            Value* sizeVal = ConstantInt::get(Type::getInt32Ty(*context), size * 4);
-            Value* resultPtr = builder->CreateCall(module->getFunction("malloc"), sizeVal);
-            resultPtr = builder->CreateBitCast(resultPtr, PointerType::get(elemType, 0));
+            if (unaryOp->op != UnaryOp::MIN && unaryOp->op != UnaryOp::MAX) {
+                throw std::runtime_error("Unsupported unary operator");
+            }
+            // MIN / MAX: a reduction over a non-empty array.
+            bool isMin = unaryOp->op == UnaryOp::MIN;
+            Type* elemType = llvmType(arrayType.element);
+            ArrayValue array = generateArray(unaryOp->operand.get(), PointerType::get(elemType, 0));
+            Value* operand = array.data;
             Function* func = builder->GetInsertBlock()->getParent();
-            BasicBlock* loopStart = BasicBlock::Create(*context, "arr_op_loop", func);
-            BasicBlock* loopBody = BasicBlock::Create(*context, "arr_op_body", func);
-            BasicBlock* loopEnd = BasicBlock::Create(*context, "arr_op_end", func);
-            AllocaInst* index = builder->CreateAlloca(Type::getInt32Ty(*context), nullptr, "op_idx");
-            builder->CreateStore(ConstantInt::get(Type::getInt32Ty(*context), 0), index);
+            BasicBlock* loopStart = BasicBlock::Create(*context, isMin ? "min_loop" : "max_loop", func);
+            BasicBlock* loopBody = BasicBlock::Create(*context, isMin ? "min_body" : "max_body", func);
+            BasicBlock* loopEnd = BasicBlock::Create(*context, isMin ? "min_end" : "max_end", func);
+            AllocaInst* index = createEntryAlloca(int32Ty, isMin ? "min_idx" : "max_idx");
+            AllocaInst* best = createEntryAlloca(elemType, isMin ? "min_val" : "max_val");
+            builder->CreateStore(ConstantInt::get(int32Ty, 1), index);
+            builder->CreateStore(builder->CreateLoad(elemType, operand), best);
             builder->CreateBr(loopStart);
             builder->SetInsertPoint(loopStart);
-            Value* idx = builder->CreateLoad(Type::getInt32Ty(*context), index);
-            Value* cond = builder->CreateICmpSLT(idx, ConstantInt::get(Type::getInt32Ty(*context), size));
+            Value* idx = builder->CreateLoad(int32Ty, index);
+            Value* cond = builder->CreateICmpSLT(idx, array.length);
             builder->CreateCondBr(cond, loopBody, loopEnd);
             builder->SetInsertPoint(loopBody);
-            Value* elem1Ptr = builder->CreateGEP(elemType, arr1, idx);
-            Value* elem2Ptr = builder->CreateGEP(elemType, arr2, idx);
-            Value* elem1 = builder->CreateLoad(elemType, elem1Ptr);
-            Value* elem2 = builder->CreateLoad(elemType, elem2Ptr);
-            Value* resultElem = nullptr;
-            switch (binOp->op) {
-                case BinaryOp::MULTIPLY_ARRAY: resultElem = builder->CreateMul(elem1, elem2); break;
-                case BinaryOp::ADD_ARRAY: resultElem = builder->CreateAdd(elem1, elem2); break;
-                case BinaryOp::SUBTRACT_ARRAY: resultElem = builder->CreateSub(elem1, elem2); break;
-                case BinaryOp::DIVIDE_ARRAY: resultElem = builder->CreateSDiv(elem1, elem2); break;
-                default: throw std::runtime_error("Unreachable");
-            }
-            Value* resultElemPtr = builder->CreateGEP(elemType, resultPtr, idx);
-            builder->CreateStore(resultElem, resultElemPtr);
-            Value* nextIdx = builder->CreateAdd(idx, ConstantInt::get(Type::getInt32Ty(*context), 1));
-            builder->CreateStore(nextIdx, index);
+            Value* elem = builder->CreateLoad(elemType, builder->CreateGEP(elemType, operand, idx));
+            Value* current = builder->CreateLoad(elemType, best);
+            Value* better = elemType->isFloatTy()
+                ? (isMin ? builder->CreateFCmpOLT(elem, current) : builder->CreateFCmpOGT(elem, current))
+                : (isMin ? builder->CreateICmpSLT(elem, current) : builder->CreateICmpSGT(elem, current));
+            builder->CreateStore(builder->CreateSelect(better, elem, current), best);
+            builder->CreateStore(builder->CreateAdd(idx, ConstantInt::get(int32Ty, 1)), index);
             builder->CreateBr(loopStart);
             builder->SetInsertPoint(loopEnd);
-            return resultPtr;
-        } else if (binOp->op == BinaryOp::ABS) {
-            Value* left = generateValue(binOp->left.get(), expectedType);
-            if (!left->getType()->isIntegerTy(32)) {
-                throw std::runtime_error("abs argument must be an integer");
-            }
-            llvm::Value* zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), 0);
-            llvm::Value* isNeg = builder->CreateICmpSLT(left, zero, "is_neg");
-            llvm::Value* negExpr = builder->CreateSub(zero, left, "neg");
-            return builder->CreateSelect(isNeg, negExpr, left, "abs");
-        }
-        Value* left = generateValue(binOp->left.get(), expectedType);
-        Value* right = generateValue(binOp->right.get(), expectedType);
-        switch (binOp->op) {
-            case BinaryOp::ADD:
-                return expectedType->isFloatTy() ? builder->CreateFAdd(left, right)
-                                                : builder->CreateAdd(left, right);
-            case BinaryOp::SUBTRACT:
-                return expectedType->isFloatTy() ? builder->CreateFSub(left, right)
-                                                : builder->CreateSub(left, right);
-            case BinaryOp::MULTIPLY:
-                return expectedType->isFloatTy() ? builder->CreateFMul(left, right)
-                                                : builder->CreateMul(left, right);
-            case BinaryOp::DIVIDE:
-                return expectedType->isFloatTy() ? builder->CreateFDiv(left, right)
-                                                : builder->CreateSDiv(left, right);
-            case BinaryOp::MODULO: // NEW: Added modulo case
-                return left->getType()->isFloatTy() ? builder->CreateFRem(left, right)
-                                                : builder->CreateSRem(left, right);
-
-            default:
-                throw std::runtime_error("Unsupported binary operator");
-        }
-    } else if (auto varRef = dynamic_cast<VarRefNode*>(node)) {
-        auto it = symbols.find(varRef->name);
-        if (it == symbols.end()) {
-            throw std::runtime_error("Undeclared variable: " + varRef->name);
-        }
-        AllocaInst* alloca = it->second;
-        if (expectedType == PointerType::get(Type::getInt32Ty(*context), 0)) {
-            return builder->CreateLoad(expectedType, alloca);
-        }
-        if (expectedType && alloca->getAllocatedType() != expectedType) {
-            throw std::runtime_error("Type mismatch: variable " + varRef->name + " has a different type");
-        }
-        return builder->CreateLoad(alloca->getAllocatedType(), alloca);
-    } else if (auto unaryOp = dynamic_cast<UnaryOpNode*>(node)) {
-        if (unaryOp->op == UnaryOp::INCREMENT || unaryOp->op == UnaryOp::DECREMENT) {
-            Value* ptr = nullptr;
-            if (auto* varRef = dynamic_cast<VarRefNode*>(unaryOp->operand.get())) {
-                auto it = symbols.find(varRef->name);
-                if (it == symbols.end()) {
-                    throw std::runtime_error("Undeclared variable: " + varRef->name);
-                }
-                ptr = it->second;
-            } else if (auto* binOp = dynamic_cast<BinaryOpNode*>(unaryOp->operand.get())) {
-                if (binOp->op != BinaryOp::INDEX) {
-                    throw std::runtime_error("Increment/decrement only supported on variables or array elements");
-                }
-                Value* arrayPtr = generateValue(binOp->left.get(), PointerType::get(Type::getInt32Ty(*context), 0));
-                Value* index = generateValue(binOp->right.get(), Type::getInt32Ty(*context));
-                ptr = builder->CreateGEP(Type::getInt32Ty(*context), arrayPtr, index);
-            } else {
-                throw std::runtime_error("Increment/decrement only supported on variables or array elements");
-            }
-            Type* type = Type::getInt32Ty(*context);
-            Value* current = builder->CreateLoad(type, ptr);
-            Value* one = ConstantInt::get(type, 1);
-            Value* newVal = (unaryOp->op == UnaryOp::INCREMENT)
-                ? builder->CreateAdd(current, one)
-                : builder->CreateSub(current, one);
-            builder->CreateStore(newVal, ptr);
-            return current; // Return original value (postfix)
-        }
-        if (unaryOp->op == UnaryOp::NEGATE) {
-            Type* operandType = expectedType && expectedType->isFloatTy() ? Type::getFloatTy(*context) : Type::getInt32Ty(*context);
-            Value* operand = generateValue(unaryOp->operand.get(), operandType);
-            if (operand->getType()->isFloatTy()) {
-                return builder->CreateFNeg(operand);
+            Value* result = builder->CreateLoad(elemType, best);
+            if (expectedType && expectedType->isFloatTy() && elemType->isIntegerTy(32)) {
+                return builder->CreateSIToFP(result, expectedType);
             }
-            return builder->CreateNeg(operand);
+            return result;
         }
-        Value* operand = generateValue(unaryOp->operand.get(), PointerType::get(Type::getInt32Ty(*context), 0));
-        uint64_t size = 5;
-        if (auto* varRef = dynamic_cast<VarRefNode*>(unaryOp->operand.get())) {
-            auto sizeIt = arraySizes.find(varRef->name);
-            if (sizeIt != arraySizes.end()) size = sizeIt->second;
-        }
-        switch (unaryOp->op) {
-            case UnaryOp::LENGTH:
-                return ConstantInt::get(Type::getInt32Ty(*context), size);
-            
-            case UnaryOp::MIN: {
-                Function* func = builder->GetInsertBlock()->getParent();
-                BasicBlock* loopStart = BasicBlock::Create(*context, "min_loop", func);
-                BasicBlock* loopBody = BasicBlock::Create(*context, "min_body", func);
-                BasicBlock* loopEnd = BasicBlock::Create(*context, "min_end", func);
-                AllocaInst* index = builder->CreateAlloca(Type::getInt32Ty(*context), nullptr, "min_idx");
-                AllocaInst* minVal = builder->CreateAlloca(Type::getInt32Ty(*context), nullptr, "min_val");
-                builder->CreateStore(ConstantInt::get(Type::getInt32Ty(*context), 0), index);
-                Value* firstElemPtr = builder->CreateGEP(Type::getInt32Ty(*context), operand, ConstantInt::get(Type::getInt32Ty(*context), 0));
-                Value* firstElem = builder->CreateLoad(Type::getInt32Ty(*context), firstElemPtr);
-                builder->CreateStore(firstElem, minVal);
-                builder->CreateBr(loopStart);
-                builder->SetInsertPoint(loopStart);
-                Value* idx = builder->CreateLoad(Type::getInt32Ty(*context), index);
-                Value* cond = builder->CreateICmpSLT(idx, ConstantInt::get(Type::getInt32Ty(*context), size));
-                builder->CreateCondBr(cond, loopBody, loopEnd);
-                builder->SetInsertPoint(loopBody);
-                Value* elemPtr = builder->CreateGEP(Type::getInt32Ty(*context), operand, idx);
-                Value* elem = builder->CreateLoad(Type::getInt32Ty(*context), elemPtr);
-                Value* currentMin = builder->CreateLoad(Type::getInt32Ty(*context), minVal);
-                Value* isLess = builder->CreateICmpSLT(elem, currentMin);
-                Value* newMin = builder->CreateSelect(isLess, elem, currentMin);
-                builder->CreateStore(newMin, minVal);
-                Value* nextIdx = builder->CreateAdd(idx, ConstantInt::get(Type::getInt32Ty(*context), 1));
-                builder->CreateStore(nextIdx, index);
-                builder->CreateBr(loopStart);
-                builder->SetInsertPoint(loopEnd);
-                return builder->CreateLoad(Type::getInt32Ty(*context), minVal);
-            }
-            case UnaryOp::MAX: {
-                Function* func = builder->GetInsertBlock()->getParent();
-                BasicBlock* loopStart = BasicBlock::Create(*context, "max_loop", func);
-                BasicBlock* loopBody = BasicBlock::Create(*context, "max_body", func);
-                BasicBlock* loopEnd = BasicBlock::Create(*context, "max_end", func);
-                AllocaInst* index = builder->CreateAlloca(Type::getInt32Ty(*context), nullptr, "max_idx");
-                AllocaInst* maxVal = builder->CreateAlloca(Type::getInt32Ty(*context), nullptr, "max_val");
-                builder->CreateStore(ConstantInt::get(Type::getInt32Ty(*context), 0), index);
-                Value* firstElemPtr = builder->CreateGEP(Type::getInt32Ty(*context), operand, ConstantInt::get(Type::getInt32Ty(*context), 0));
-                Value* firstElem = builder->CreateLoad(Type::getInt32Ty(*context), firstElemPtr);
-                builder->CreateStore(firstElem, maxVal);
-                builder->CreateBr(loopStart);
-                builder->SetInsertPoint(loopStart);
-                Value* idx = builder->CreateLoad(Type::getInt32Ty(*context), index);
-                Value* cond = builder->CreateICmpSLT(idx, ConstantInt::get(Type::getInt32Ty(*context), size));
-                builder->CreateCondBr(cond, loopBody, loopEnd);
-                builder->SetInsertPoint(loopBody);
-                Value* elemPtr = builder->CreateGEP(Type::getInt32Ty(*context), operand, idx);
-                Value* elem = builder->CreateLoad(Type::getInt32Ty(*context), elemPtr);
-                Value* currentMax = builder->CreateLoad(Type::getInt32Ty(*context), maxVal);
-                Value* isGreater = builder->CreateICmpSGT(elem, currentMax);
-                Value* newMax = builder->CreateSelect(isGreater, elem, currentMax);
-                builder->CreateStore(newMax, maxVal);
-                Value* nextIdx = builder->CreateAdd(idx, ConstantInt::get(Type::getInt32Ty(*context), 1));
-                builder->CreateStore(nextIdx, index);
-                builder->CreateBr(loopStart);
-                builder->SetInsertPoint(loopEnd);
-                return builder->CreateLoad(Type::getInt32Ty(*context), maxVal);
+        case NodeKind::FloatLiteral: {
+            auto floatLit = static_cast<FloatLiteral*>(node);
+            if (expectedType && !expectedType->isFloatTy()) {
+                throw std::runtime_error("Expected float type");
             }
+            return ConstantFP::get(Type::getFloatTy(*context), floatLit->value);
         }
-        throw std::runtime_error("Unsupported unary operator");
-    } else if (auto floatLit = dynamic_cast<FloatLiteral*>(node)) {
-        if (expectedType && !expectedType->isFloatTy()) {
-            throw std::runtime_error("Expected float type");
-        }
-        return ConstantFP::get(Type::getFloatTy(*context), floatLit->value);
-    } else if (auto boolLit = dynamic_cast<BoolLiteral*>(node)) {
-        if (expectedType && !expectedType->isIntegerTy(1)) {
-            throw std::runtime_error("Expected boolean type");
-        }
-        return ConstantInt::get(Type::getInt1Ty(*context), boolLit->value);
-    } else if (auto charLit = dynamic_cast<CharLiteral*>(node)) {
-        if (expectedType && !expectedType->isIntegerTy(8)) {
-            throw std::runtime_error("Expected char (i8) type");
-        }
-        return ConstantInt::get(Type::getInt8Ty(*context), charLit->value);
-    } 
+        default:
+            break;
+    }
     throw std::runtime_error("Unsupported node type in generateValue");
 }
 
+// An element-wise operation over a fresh buffer as long as the left
+// operand; the trip count is a constant where the analyzer knows it, which
+// lets LLVM unroll or vectorize the loop.
+llvm::Value* CodeGen::generateArrayOp(BinaryOp op, ArrayValue left, llvm::Value* right, llvm::Type* elemType) {
+    Type* int32Ty = Type::getInt32Ty(*context);
+    bool isFloat = elemType->isFloatTy();
+    Value* sizeVal = builder->CreateMul(left.length, ConstantInt::get(int32Ty, 4));
+    Value* resultPtr = builder->CreateCall(module->getFunction("malloc"), sizeVal);
+    resultPtr = builder->CreateBitCast(resultPtr, PointerType::get(elemType, 0));
+    Function* func = builder->GetInsertBlock()->getParent();
+    BasicBlock* loopStart = BasicBlock::Create(*context, "arr_op_loop", func);
+    BasicBlock* loopBody = BasicBlock::Create(*context, "arr_op_body", func);
+    BasicBlock* loopEnd = BasicBlock::Create(*context, "arr_op_end", func);
+    AllocaInst* index = createEntryAlloca(int32Ty, "op_idx");
+    builder->CreateStore(ConstantInt::get(int32Ty, 0), index);
+    builder->CreateBr(loopStart);
+    builder->SetInsertPoint(loopStart);
+    Value* idx = builder->CreateLoad(int32Ty, index);
+    Value* cond = builder->CreateICmpSLT(idx, left.length);
+    builder->CreateCondBr(cond, loopBody, loopEnd);
+    builder->SetInsertPoint(loopBody);
+    Value* elem1 = builder->CreateLoad(elemType, builder->CreateGEP(elemType, left.data, idx));
+    Value* elem2 = builder->CreateLoad(elemType, builder->CreateGEP(elemType, right, idx));
+    Value* resultElem = nullptr;
+    switch (op) {
+        case BinaryOp::MULTIPLY_ARRAY:
+            resultElem = isFloat ? builder->CreateFMul(elem1, elem2) : builder->CreateMul(elem1, elem2);
+            break;
+        case BinaryOp::ADD_ARRAY:
+            resultElem = isFloat ? builder->CreateFAdd(elem1, elem2) : builder->CreateAdd(elem1, elem2);
+            break;
+        case BinaryOp::SUBTRACT_ARRAY:
+            resultElem = isFloat ? builder->CreateFSub(elem1, elem2) : builder->CreateSub(elem1, elem2);
+            break;
+        case BinaryOp::DIVIDE_ARRAY:
+            resultElem = isFloat ? builder->CreateFDiv(elem1, elem2) : builder->CreateSDiv(elem1, elem2);
+            break;
+        default: throw std::runtime_error("Unreachable");
+    }
+    builder->CreateStore(resultElem, builder->CreateGEP(elemType, resultPtr, idx));
+    builder->CreateStore(builder->CreateAdd(idx, ConstantInt::get(int32Ty, 1)), index);
+    builder->CreateBr(loopStart);
+    builder->SetInsertPoint(loopEnd);
+    return resultPtr;
+}
+
+// The array node evaluates to, with its length. A variable of unknown
+// length carries it beside its pointer, a ternary picks one of its
+// branches', and an element-wise operation is as long as its left operand.
+CodeGen::ArrayValue CodeGen::generateArray(ASTNode* node, llvm::Type* pointerType) {
+    Type* int32Ty = Type::getInt32Ty(*context);
+    const ValueType& type = node->valueType;
+    Value* known = type.hasLength() ? ConstantInt::get(int32Ty, type.length) : nullptr;
+    if (auto* varRef = node_cast<VarRefNode>(node)) {
+        Value* length = known;
+        if (!length) {
+            length = builder->CreateLoad(int32Ty, lookupVariable(varRef->slot, varRef->symbol).length);
+        }
+        return {generateValue(node, pointerType), length};
+    }
+    if (auto* ternary = node_cast<TernaryExprNode>(node); ternary && !known) {
+        Value* condValue = generateValue(ternary->condition.get(), Type::getInt1Ty(*context));
+        ArrayValue trueValue = generateArray(ternary->trueBranch.get(), pointerType);
+        ArrayValue falseValue = generateArray(ternary->falseBranch.get(), pointerType);
+        return {builder->CreateSelect(condValue, trueValue.data, falseValue.data, "ternary_result"),
+                builder->CreateSelect(condValue, trueValue.length, falseValue.length, "ternary_length")};
+    }
+    if (auto* binOp = node_cast<BinaryOpNode>(node); binOp && type.isArray()) {
+        Type* elemType = llvmType(type.element);
+        Type* ptrType = PointerType::get(elemType, 0);
+        ArrayValue left = generateArray(binOp->left.get(), ptrType);
+        Value* right = generateValue(binOp->right.get(), ptrType);
+        return {generateArrayOp(binOp->op, left, right, elemType), left.length};
+    }
+    if (!known) {
+        throw std::runtime_error("Array length is not known");
+    }
+    return {generateValue(node, pointerType), known};
+}
+
 void CodeGen::dump() const {
     module->print(llvm::outs(), nullptr);
 }
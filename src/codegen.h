@@ -6,7 +6,6 @@
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
 #include <unordered_map>
-#include <map>
 #include <memory>
 
 class CodeGen {
@@ -20,9 +19,31 @@ private:
     std::unique_ptr<llvm::Module> module;
     std::unique_ptr<llvm::IRBuilder<>> builder;
     llvm::Function* printfFunc; 
-    std::map<std::string, uint64_t> arraySizes;
-    std::unordered_map<std::string, llvm::AllocaInst*> symbols;
+    struct Variable {
+        llvm::AllocaInst* alloca = nullptr;  // created on first declaration
+        llvm::AllocaInst* length = nullptr;  // element count of an array whose length is not static
+        bool ownsBuffer = false;             // see VarDeclNode::ownsBuffer
+        bool live = false;                   // declared in an open scope
+    };
+    std::vector<Variable> variables;   // by SlotId
+    std::vector<SlotId> scopeSlots;    // slots declared in each open scope, innermost last
+    std::vector<size_t> scopeStarts;   // where each open scope begins in scopeSlots
+    // An array and its element count: a constant where the analyzer knows
+    // the length, else read from the variables that carry it.
+    struct ArrayValue {
+        llvm::Value* data;
+        llvm::Value* length;
+    };
     
+    llvm::Type* llvmType(const ValueType& type);  // storage type for a semantic type
+    llvm::AllocaInst* createEntryAlloca(llvm::Type* type, const std::string& name);
+    Variable& declareVariable(SlotId slot, SymbolId symbol, llvm::Type* type);  // in the current scope
+    Variable& lookupVariable(SlotId slot, SymbolId symbol);  // symbol only names it in errors
+    void pushScope();
+    void popScope();
+    void discardScopes(size_t depth);  // closes scopes above depth without emitting code
+    void freeBuffer(llvm::Value* buffer);
+    llvm::Value* ownedString(ASTNode* value, llvm::Value* generated);  // heap copy of a literal
     void generateStatement(ASTNode* node);
     void generateVarDecl(VarDeclNode* node);
     void generateAssign(AssignNode* node);
@@ -32,11 +53,15 @@ private:
     void generatePrint(PrintNode* node);
     void generateLoop(LoopNode* node);
     void printArray(const std::vector<llvm::Value*>& elements);
-    void printArrayVar(llvm::Value* arrayPtr, uint64_t size);
+    void printArrayVar(llvm::Value* arrayPtr, llvm::Value* size, llvm::Type* elemType);
     llvm::Value* generatePow(llvm::Value* base, llvm::Value* exp);
+    llvm::Value* generatePowChain(llvm::Value* base, int32_t exp);
+    llvm::Value* generatePowerOfTwoOp(BinaryOp op, llvm::Value* left, llvm::Value* right);
     void generateTryCatch(TryCatchNode* node);
     void generateMatch(MatchNode* node);
     llvm::Value* generateValue(ASTNode* node, llvm::Type* expectedType);
+    ArrayValue generateArray(ASTNode* node, llvm::Type* pointerType);
+    llvm::Value* generateArrayOp(BinaryOp op, ArrayValue left, llvm::Value* right, llvm::Type* elemType);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,552 @@
+#include "constant_fold.h"
+#include <climits>
+#include <cmath>
+#include <optional>
+#include <string>
+
+static bool isLiteral(const ASTNode& node) {
+    switch (node.kind) {
+        case NodeKind::IntLiteral:
+        case NodeKind::FloatLiteral:
+        case NodeKind::StrLiteral:
+        case NodeKind::BoolLiteral:
+        case NodeKind::CharLiteral:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static std::optional<int32_t> intValue(const ASTNode& node) {
+    if (auto* intLit = node_cast<const IntLiteral>(&node)) return intLit->value;
+    return std::nullopt;
+}
+
+// Int literals count too: CodeGen promotes them wherever a float is expected.
+static std::optional<float> floatValue(const ASTNode& node) {
+    if (auto* floatLit = node_cast<const FloatLiteral>(&node)) return floatLit->value;
+    if (auto* intLit = node_cast<const IntLiteral>(&node)) return float(intLit->value);
+    return std::nullopt;
+}
+
+static std::optional<bool> boolValue(const ASTNode& node) {
+    if (auto* boolLit = node_cast<const BoolLiteral>(&node)) return boolLit->value;
+    return std::nullopt;
+}
+
+static std::optional<std::string> stringValue(const ASTNode& node) {
+    if (auto* strLit = node_cast<const StrLiteral>(&node)) return strLit->value;
+    if (auto* charLit = node_cast<const CharLiteral>(&node)) return std::string(1, charLit->value);
+    return std::nullopt;
+}
+
+// i32 arithmetic as CodeGen emits it: two's complement, wrapping.
+static std::optional<int32_t> foldInt(BinaryOp op, int32_t a, int32_t b) {
+    uint32_t x = uint32_t(a), y = uint32_t(b);
+    switch (op) {
+        case BinaryOp::ADD: return int32_t(x + y);
+        case BinaryOp::SUBTRACT: return int32_t(x - y);
+        case BinaryOp::MULTIPLY: return int32_t(x * y);
+        case BinaryOp::DIVIDE:
+        case BinaryOp::MODULO:
+            if (b == 0 || (a == INT_MIN && b == -1)) {
+                return std::nullopt; // traps at run time; keep it there
+            }
+            return op == BinaryOp::DIVIDE ? a / b : a % b;
+        case BinaryOp::POW: {
+            // generatePow: repeated multiplication, 1 for a negative exponent
+            uint32_t result = 1;
+            for (uint32_t exp = b < 0 ? 0 : uint32_t(b); exp; exp >>= 1, x *= x) {
+                if (exp & 1) result *= x;
+            }
+            return int32_t(result);
+        }
+        default:
+            return std::nullopt;
+    }
+}
+
+static std::optional<float> foldFloat(BinaryOp op, float a, float b) {
+    switch (op) {
+        case BinaryOp::ADD: return a + b;
+        case BinaryOp::SUBTRACT: return a - b;
+        case BinaryOp::MULTIPLY: return a * b;
+        case BinaryOp::DIVIDE: return a / b;
+        case BinaryOp::MODULO: return std::fmod(a, b);
+        default: return std::nullopt; // float pow is left to llvm.powi and llvm.pow
+    }
+}
+
+template <typename T>
+static std::optional<bool> compare(BinaryOp op, T a, T b) {
+    switch (op) {
+        case BinaryOp::EQUAL: return a == b;
+        case BinaryOp::NOT_EQUAL: return a != b;
+        case BinaryOp::LESS: return a < b;
+        case BinaryOp::LESS_EQUAL: return a <= b;
+        case BinaryOp::GREATER: return a > b;
+        case BinaryOp::GREATER_EQUAL: return a >= b;
+        default: return std::nullopt;
+    }
+}
+
+void ConstantFolder::fold(ProgramNode& program) {
+    writes.assign(program.slotCount, 0);
+    constants.assign(program.slotCount, nullptr);
+    literalStores.assign(program.slotCount, 0);
+    owners.clear();
+    for (auto& stmt : program.statements) {
+        countWrites(*stmt);
+    }
+    for (auto& stmt : program.statements) {
+        fold(stmt);
+    }
+    // A variable whose every store folded to a literal holds no heap buffer
+    // any more. One that still gets fresh buffers keeps freeing them; CodeGen
+    // copies the folded literals it stores there to the heap.
+    for (VarDeclNode* decl : owners) {
+        if (literalStores[decl->slot] == writes[decl->slot]) {
+            decl->ownsBuffer = false;
+        }
+    }
+}
+
+void ConstantFolder::noteStore(SlotId slot, const ASTNode& value) {
+    if (value.kind == NodeKind::StrLiteral) {
+        ++literalStores[slot];
+    }
+}
+
+void ConstantFolder::countWrites(ASTNode& node) {
+    auto visit = [&](ASTNode* child) {
+        if (child) countWrites(*child);
+    };
+    switch (node.kind) {
+        case NodeKind::VarDecl: {
+            auto& decl = static_cast<VarDeclNode&>(node);
+            ++writes[decl.slot];
+            visit(decl.value.get());
+            break;
+        }
+        case NodeKind::MultiVarDecl:
+            for (auto& decl : static_cast<MultiVarDeclNode&>(node).declarations) visit(decl.get());
+            break;
+        case NodeKind::Assign: {
+            auto& assign = static_cast<AssignNode&>(node);
+            ++writes[assign.slot];
+            visit(assign.value.get());
+            break;
+        }
+        case NodeKind::CompoundAssign: {
+            auto& compound = static_cast<CompoundAssignNode&>(node);
+            ++writes[compound.slot];
+            visit(compound.value.get());
+            break;
+        }
+        case NodeKind::UnaryOp: {
+            auto& unary = static_cast<UnaryOpNode&>(node);
+            auto* varRef = node_cast<VarRefNode>(unary.operand.get());
+            if (varRef && (unary.op == UnaryOp::INCREMENT || unary.op == UnaryOp::DECREMENT)) {
+                ++writes[varRef->slot];
+            }
+            visit(unary.operand.get());
+            break;
+        }
+        case NodeKind::BinaryOp: {
+            auto& binary = static_cast<BinaryOpNode&>(node);
+            visit(binary.left.get());
+            visit(binary.right.get());
+            break;
+        }
+        case NodeKind::Concat: {
+            auto& concat = static_cast<ConcatNode&>(node);
+            visit(concat.left.get());
+            visit(concat.right.get());
+            break;
+        }
+        case NodeKind::Ternary: {
+            auto& ternary = static_cast<TernaryExprNode&>(node);
+            visit(ternary.condition.get());
+            visit(ternary.trueBranch.get());
+            visit(ternary.falseBranch.get());
+            break;
+        }
+        case NodeKind::ArrayLiteral:
+            for (auto& elem : static_cast<ArrayLiteralNode&>(node).elements) visit(elem.get());
+            break;
+        case NodeKind::Block:
+            for (auto& stmt : static_cast<BlockNode&>(node).statements) visit(stmt.get());
+            break;
+        case NodeKind::IfElse: {
+            auto& ifElse = static_cast<IfElseNode&>(node);
+            visit(ifElse.condition.get());
+            visit(ifElse.then_block.get());
+            visit(ifElse.else_block.get());
+            break;
+        }
+        case NodeKind::Print:
+            visit(static_cast<PrintNode&>(node).expr.get());
+            break;
+        case NodeKind::Loop: {
+            auto& loop = static_cast<LoopNode&>(node);
+            visit(loop.init.get());
+            visit(loop.condition.get());
+            visit(loop.update.get());
+            visit(loop.collection.get());
+            visit(loop.body.get());
+            break;
+        }
+        case NodeKind::TryCatch: {
+            auto& tryCatch = static_cast<TryCatchNode&>(node);
+            visit(tryCatch.tryBlock.get());
+            visit(tryCatch.catchBlock.get());
+            break;
+        }
+        case NodeKind::Match: {
+            auto& match = static_cast<MatchNode&>(node);
+            visit(match.expression.get());
+            for (auto& caseNode : match.cases) {
+                visit(caseNode->value.get());
+                visit(caseNode->body.get());
+            }
+            break;
+        }
+        default:
+            break; // leaves
+    }
+}
+
+void ConstantFolder::fold(NodePtr<ASTNode>& node) {
+    if (!node) {
+        return;
+    }
+    foldChildren(*node);
+    if (NodePtr<ASTNode> folded = evaluate(*node)) {
+        node = std::move(folded);
+    }
+}
+
+void ConstantFolder::foldChildren(ASTNode& node) {
+    switch (node.kind) {
+        case NodeKind::VarDecl:
+            foldVarDecl(static_cast<VarDeclNode&>(node));
+            break;
+        case NodeKind::MultiVarDecl:
+            for (auto& decl : static_cast<MultiVarDeclNode&>(node).declarations) foldVarDecl(*decl);
+            break;
+        case NodeKind::Assign: {
+            auto& assign = static_cast<AssignNode&>(node);
+            fold(assign.value);
+            noteStore(assign.slot, *assign.value);
+            break;
+        }
+        case NodeKind::CompoundAssign: {
+            auto& compound = static_cast<CompoundAssignNode&>(node);
+            if (compound.op == BinaryOp::DIVIDE || compound.op == BinaryOp::MODULO) {
+                foldDivisor(compound.value, nullptr); // the variable may hold INT_MIN
+            } else {
+                fold(compound.value);
+            }
+            break;
+        }
+        case NodeKind::UnaryOp: {
+            auto& unary = static_cast<UnaryOpNode&>(node);
+            if (unary.op != UnaryOp::INCREMENT && unary.op != UnaryOp::DECREMENT) {
+                fold(unary.operand);
+            } else if (auto* index = node_cast<BinaryOpNode>(unary.operand.get())) {
+                fold(index->right); // the element written stays; its index may fold
+            }
+            break;
+        }
+        case NodeKind::BinaryOp: {
+            auto& binary = static_cast<BinaryOpNode&>(node);
+            fold(binary.left);
+            if (binary.op == BinaryOp::DIVIDE || binary.op == BinaryOp::MODULO || binary.op == BinaryOp::DIVIDE_ARRAY) {
+                foldDivisor(binary.right, binary.left.get());
+            } else {
+                fold(binary.right);
+            }
+            break;
+        }
+        case NodeKind::Concat: {
+            auto& concat = static_cast<ConcatNode&>(node);
+            fold(concat.left);
+            fold(concat.right);
+            break;
+        }
+        case NodeKind::Ternary: {
+            auto& ternary = static_cast<TernaryExprNode&>(node);
+            fold(ternary.condition);
+            fold(ternary.trueBranch);
+            fold(ternary.falseBranch);
+            break;
+        }
+        case NodeKind::ArrayLiteral:
+            for (auto& elem : static_cast<ArrayLiteralNode&>(node).elements) fold(elem);
+            break;
+        case NodeKind::Block:
+            for (auto& stmt : static_cast<BlockNode&>(node).statements) fold(stmt);
+            break;
+        case NodeKind::IfElse: {
+            auto& ifElse = static_cast<IfElseNode&>(node);
+            fold(ifElse.condition);
+            fold(ifElse.then_block);
+            fold(ifElse.else_block);
+            break;
+        }
+        case NodeKind::Print:
+            fold(static_cast<PrintNode&>(node).expr);
+            break;
+        case NodeKind::Loop: {
+            auto& loop = static_cast<LoopNode&>(node);
+            fold(loop.init);
+            fold(loop.condition);
+            fold(loop.update);
+            fold(loop.collection);
+            fold(loop.body);
+            break;
+        }
+        case NodeKind::TryCatch: {
+            auto& tryCatch = static_cast<TryCatchNode&>(node);
+            foldChildren(*tryCatch.tryBlock);
+            foldChildren(*tryCatch.catchBlock);
+            break;
+        }
+        case NodeKind::Match: {
+            auto& match = static_cast<MatchNode&>(node);
+            fold(match.expression);
+            for (auto& caseNode : match.cases) {
+                fold(caseNode->value);
+                fold(caseNode->body);
+            }
+            break;
+        }
+        default:
+            break; // leaves
+    }
+}
+
+// A declaration that is its variable's only write fixes the value of every
+// read, so a literal initializer can stand in for them all.
+void ConstantFolder::foldVarDecl(VarDeclNode& decl) {
+    if (!decl.value) {
+        return;
+    }
+    fold(decl.value);
+    ASTNode& value = *decl.value;
+    noteStore(decl.slot, value);
+    if (decl.ownsBuffer) {
+        owners.push_back(&decl);
+    }
+    if (writes[decl.slot] != 1 || !isLiteral(value)) {
+        return;
+    }
+    if (decl.type == VarType::FLOAT && value.kind == NodeKind::IntLiteral) {
+        // reads are float-typed; give them a float literal
+        constants[decl.slot] = arena.make<FloatLiteral>(float(static_cast<IntLiteral&>(value).value)).release();
+    } else {
+        constants[decl.slot] = &value;
+    }
+}
+
+// Dividing by 0, or INT_MIN by -1, traps at run time. Propagating a
+// constant into such a divisor would hand CodeGen a literal division, which
+// IRBuilder folds to poison instead, so the divisor keeps its variable
+// reads. A null dividend may hold anything.
+void ConstantFolder::foldDivisor(NodePtr<ASTNode>& divisor, const ASTNode* dividend) {
+    if (!divisor) {
+        return;
+    }
+    std::optional<int32_t> value = intConstant(*divisor);
+    std::optional<int32_t> numerator = dividend ? intValue(*dividend) : std::nullopt;
+    bool traps = value && (*value == 0 || (*value == -1 && numerator.value_or(INT_MIN) == INT_MIN));
+    bool saved = propagate;
+    propagate = propagate && !traps;
+    fold(divisor);
+    propagate = saved;
+}
+
+// The int node would fold to, without rewriting it.
+std::optional<int32_t> ConstantFolder::intConstant(const ASTNode& node) const {
+    switch (node.kind) {
+        case NodeKind::VarRef: {
+            ASTNode* constant = propagate ? constants[static_cast<const VarRefNode&>(node).slot] : nullptr;
+            return constant ? intValue(*constant) : std::nullopt;
+        }
+        case NodeKind::UnaryOp: {
+            auto& unary = static_cast<const UnaryOpNode&>(node);
+            std::optional<int32_t> operand;
+            if (unary.op == UnaryOp::NEGATE) operand = intConstant(*unary.operand);
+            return operand ? std::optional<int32_t>(int32_t(0u - uint32_t(*operand))) : std::nullopt;
+        }
+        case NodeKind::BinaryOp: {
+            auto& binary = static_cast<const BinaryOpNode&>(node);
+            if (!binary.right) return std::nullopt;
+            auto a = intConstant(*binary.left), b = intConstant(*binary.right);
+            return a && b ? foldInt(binary.op, *a, *b) : std::nullopt;
+        }
+        default:
+            return intValue(node);
+    }
+}
+
+NodePtr<ASTNode> ConstantFolder::evaluate(ASTNode& node) {
+    switch (node.kind) {
+        case NodeKind::VarRef: {
+            if (!propagate) {
+                return nullptr;
+            }
+            ASTNode* constant = constants[static_cast<VarRefNode&>(node).slot];
+            return constant ? copyLiteral(*constant) : nullptr;
+        }
+        case NodeKind::BinaryOp:
+            return evaluateBinary(static_cast<BinaryOpNode&>(node));
+        case NodeKind::UnaryOp:
+            return evaluateUnary(static_cast<UnaryOpNode&>(node));
+        case NodeKind::Concat: {
+            auto& concat = static_cast<ConcatNode&>(node);
+            auto left = stringValue(*concat.left);
+            auto right = stringValue(*concat.right);
+            if (left && right) {
+                return arena.make<StrLiteral>(*left + *right);
+            }
+            return nullptr;
+        }
+        case NodeKind::Ternary: {
+            auto& ternary = static_cast<TernaryExprNode&>(node);
+            if (auto condition = boolValue(*ternary.condition)) {
+                return std::move(*condition ? ternary.trueBranch : ternary.falseBranch);
+            }
+            return nullptr;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+NodePtr<ASTNode> ConstantFolder::evaluateBinary(BinaryOpNode& binary) {
+    const ASTNode& left = *binary.left;
+    if (binary.op == BinaryOp::ABS) {
+        if (auto a = intValue(left)) {
+            return arena.make<IntLiteral>(*a < 0 ? int32_t(0u - uint32_t(*a)) : *a);
+        }
+        if (auto a = floatValue(left)) {
+            return arena.make<FloatLiteral>(std::fabs(*a));
+        }
+        return nullptr;
+    }
+    if (!binary.right) {
+        return nullptr;
+    }
+    const ASTNode& right = *binary.right;
+    switch (binary.op) {
+        case BinaryOp::ADD:
+        case BinaryOp::SUBTRACT:
+        case BinaryOp::MULTIPLY:
+        case BinaryOp::DIVIDE:
+        case BinaryOp::MODULO:
+        case BinaryOp::POW: {
+            auto a = intValue(left), b = intValue(right);
+            if (a && b) {
+                auto result = foldInt(binary.op, *a, *b);
+                return result ? arena.make<IntLiteral>(*result) : nullptr;
+            }
+            auto x = floatValue(left), y = floatValue(right);
+            if (x && y) {
+                auto result = foldFloat(binary.op, *x, *y);
+                return result ? arena.make<FloatLiteral>(*result) : nullptr;
+            }
+            return nullptr;
+        }
+        case BinaryOp::EQUAL:
+        case BinaryOp::NOT_EQUAL:
+        case BinaryOp::LESS:
+        case BinaryOp::LESS_EQUAL:
+        case BinaryOp::GREATER:
+        case BinaryOp::GREATER_EQUAL: {
+            std::optional<bool> result;
+            if (auto a = intValue(left), b = intValue(right); a && b) {
+                result = compare(binary.op, *a, *b);
+            } else if (auto x = floatValue(left), y = floatValue(right); x && y) {
+                result = compare(binary.op, *x, *y);
+            } else if (auto p = boolValue(left), q = boolValue(right); p && q) {
+                result = compare(binary.op, *p, *q);
+            }
+            return result ? arena.make<BoolLiteral>(*result) : nullptr;
+        }
+        case BinaryOp::AND:
+        case BinaryOp::OR:
+        case BinaryOp::XOR: {
+            auto p = boolValue(left), q = boolValue(right);
+            if (!p || !q) {
+                return nullptr;
+            }
+            bool result = binary.op == BinaryOp::AND ? *p && *q : binary.op == BinaryOp::OR ? *p || *q : *p != *q;
+            return arena.make<BoolLiteral>(result);
+        }
+        default:
+            return nullptr;
+    }
+}
+
+NodePtr<ASTNode> ConstantFolder::evaluateUnary(UnaryOpNode& unary) {
+    const ASTNode& operand = *unary.operand;
+    switch (unary.op) {
+        case UnaryOp::NEGATE:
+            if (auto a = intValue(operand)) {
+                return arena.make<IntLiteral>(int32_t(0u - uint32_t(*a)));
+            }
+            if (auto* floatLit = node_cast<const FloatLiteral>(&operand)) {
+                return arena.make<FloatLiteral>(-floatLit->value);
+            }
+            return nullptr;
+        case UnaryOp::LENGTH:
+            // Only drop operands that cannot have effects: a variable or a
+            // literal (whose elements are literals or variables).
+            if (operand.valueType.hasLength() &&
+                (operand.kind == NodeKind::VarRef || operand.kind == NodeKind::ArrayLiteral)) {
+                return arena.make<IntLiteral>(int32_t(operand.valueType.length));
+            }
+            return nullptr;
+        case UnaryOp::MIN:
+        case UnaryOp::MAX: {
+            auto* arrayLit = node_cast<const ArrayLiteralNode>(&operand);
+            if (!arrayLit || arrayLit->elements.empty()) {
+                return nullptr;
+            }
+            bool isMin = unary.op == UnaryOp::MIN;
+            if (arrayLit->valueType.element == VarType::INT) {
+                int32_t best = 0;
+                for (size_t i = 0; i < arrayLit->elements.size(); ++i) {
+                    auto value = intValue(*arrayLit->elements[i]);
+                    if (!value) return nullptr;
+                    if (i == 0 || (isMin ? *value < best : *value > best)) best = *value;
+                }
+                return arena.make<IntLiteral>(best);
+            }
+            if (arrayLit->valueType.element == VarType::FLOAT) {
+                float best = 0;
+                for (size_t i = 0; i < arrayLit->elements.size(); ++i) {
+                    auto* value = node_cast<const FloatLiteral>(arrayLit->elements[i].get());
+                    if (!value) return nullptr;
+                    if (i == 0 || (isMin ? value->value < best : value->value > best)) best = value->value;
+                }
+                return arena.make<FloatLiteral>(best);
+            }
+            return nullptr;
+        }
+        default:
+            return nullptr; // ++ and -- write their operand
+    }
+}
+
+NodePtr<ASTNode> ConstantFolder::copyLiteral(const ASTNode& literal) {
+    switch (literal.kind) {
+        case NodeKind::IntLiteral: return arena.make<IntLiteral>(static_cast<const IntLiteral&>(literal).value);
+        case NodeKind::FloatLiteral: return arena.make<FloatLiteral>(static_cast<const FloatLiteral&>(literal).value);
+        case NodeKind::StrLiteral: return arena.make<StrLiteral>(static_cast<const StrLiteral&>(literal).value);
+        case NodeKind::BoolLiteral: return arena.make<BoolLiteral>(static_cast<const BoolLiteral&>(literal).value);
+        case NodeKind::CharLiteral: return arena.make<CharLiteral>(static_cast<const CharLiteral&>(literal).value);
+        default: return nullptr;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef CONSTANT_FOLD_H
+#define CONSTANT_FOLD_H
+
+#include "ast.h"
+#include <optional>
+#include <vector>
+
+// Replaces constant expressions with literals, bottom-up, and propagates the
+// value of every variable whose only write is a literal initializer. Folded
+// results keep the semantics CodeGen gives the original: int arithmetic
+// wraps, division by zero is left to run (no constant is propagated into
+// a divisor that would trap), floats are single precision.
+// Needs an analyzed program, since it reads valueType and slots.
+class ConstantFolder {
+public:
+    explicit ConstantFolder(AstArena& arena) : arena(arena) {}
+    void fold(ProgramNode& program);
+
+private:
+    AstArena& arena;
+    std::vector<uint32_t> writes;        // by slot: declarations and stores anywhere in the program
+    std::vector<ASTNode*> constants;     // by slot: the literal every read sees, or null
+    std::vector<uint32_t> literalStores; // by slot: writes that folded to a string literal
+    std::vector<VarDeclNode*> owners;    // declarations folded while owning their buffer
+    bool propagate = true;               // substitute constants for variable reads
+
+    void countWrites(ASTNode& node);
+    void fold(NodePtr<ASTNode>& node);  // folds node in place
+    void foldChildren(ASTNode& node);
+    void foldVarDecl(VarDeclNode& decl);
+    void foldDivisor(NodePtr<ASTNode>& divisor, const ASTNode* dividend);
+    void noteStore(SlotId slot, const ASTNode& value);
+    std::optional<int32_t> intConstant(const ASTNode& node) const;
+    NodePtr<ASTNode> evaluate(ASTNode& node);  // literal for node, or null
+    NodePtr<ASTNode> evaluateBinary(BinaryOpNode& binary);
+    NodePtr<ASTNode> evaluateUnary(UnaryOpNode& unary);
+    NodePtr<ASTNode> copyLiteral(const ASTNode& literal);
+};
+
+#endif
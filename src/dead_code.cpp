@@ -0,0 +1,292 @@
+#include "dead_code.h"
+#include <algorithm>
+
+// Integer division by a value that may be zero traps at run time; like
+// ConstantFolder, leave that to happen.
+static bool mayTrap(BinaryOpNode& binary) {
+    if (binary.op != BinaryOp::DIVIDE && binary.op != BinaryOp::MODULO && binary.op != BinaryOp::DIVIDE_ARRAY) {
+        return false;
+    }
+    VarType type = binary.valueType.isArray() ? binary.valueType.element : binary.valueType.kind;
+    if (type == VarType::FLOAT) {
+        return false;
+    }
+    auto* divisor = node_cast<IntLiteral>(binary.right.get());
+    return !divisor || divisor->value == 0;
+}
+
+bool hasSideEffects(ASTNode& node) {
+    if (auto* unary = node_cast<UnaryOpNode>(&node)) {
+        if (unary->op == UnaryOp::INCREMENT || unary->op == UnaryOp::DECREMENT) {
+            return true;
+        }
+    } else if (auto* binary = node_cast<BinaryOpNode>(&node)) {
+        if (mayTrap(*binary)) {
+            return true;
+        }
+    }
+    bool effects = false;
+    forEachChild(node, [&](auto& child) { effects = effects || hasSideEffects(*child); });
+    return effects;
+}
+
+// Adds every slot node may read to live.
+static void markReads(ASTNode& node, std::vector<bool>& live) {
+    if (auto* varRef = node_cast<VarRefNode>(&node)) {
+        live[varRef->slot] = true;
+    } else if (auto* compound = node_cast<CompoundAssignNode>(&node)) {
+        live[compound->slot] = true;
+    }
+    forEachChild(node, [&](auto& child) { markReads(*child, live); });
+}
+
+static void merge(std::vector<bool>& into, const std::vector<bool>& from) {
+    for (size_t i = 0; i < into.size(); ++i) {
+        into[i] = into[i] || from[i];
+    }
+}
+
+static bool isEmptyBlock(const ASTNode* node) {
+    auto* block = node_cast<const BlockNode>(node);
+    return block && block->statements.empty();
+}
+
+void DeadCodeEliminator::eliminate(ProgramNode& program) {
+    // Each round can only shrink the tree; dropping a store may leave the
+    // variables it read unused in turn.
+    do {
+        changed = false;
+        uses.assign(program.slotCount, 0);
+        for (auto& stmt : program.statements) {
+            if (stmt) countUses(*stmt);
+        }
+        LiveSet live(program.slotCount), pinned(program.slotCount);
+        sweepBlock(program.statements, live, pinned);
+    } while (changed);
+}
+
+void DeadCodeEliminator::countUses(ASTNode& node) {
+    if (auto* varRef = node_cast<VarRefNode>(&node)) {
+        ++uses[varRef->slot];
+    } else if (auto* assign = node_cast<AssignNode>(&node)) {
+        ++uses[assign->slot];
+    } else if (auto* compound = node_cast<CompoundAssignNode>(&node)) {
+        ++uses[compound->slot];
+    }
+    forEachChild(node, [&](auto& child) { countUses(*child); });
+}
+
+// Walks statements last to first. On entry live holds the slots that may be
+// read after the block; on exit, those that may be read from its start.
+// Pinned slots count as live everywhere in the block. Returns false when no
+// statement is left.
+bool DeadCodeEliminator::sweepBlock(std::vector<NodePtr<ASTNode>>& statements, LiveSet& live, const LiveSet& pinned) {
+    bool anyKept = false;
+    for (size_t i = statements.size(); i-- > 0;) {
+        if (!statements[i]) {
+            continue;
+        }
+        if (sweep(statements[i], live, pinned)) {
+            anyKept = true;
+        } else if (!dryRun) {
+            statements[i] = nullptr;
+        }
+    }
+    if (!dryRun) {
+        statements.erase(std::remove_if(statements.begin(), statements.end(), [](const auto& stmt) { return !stmt; }),
+                         statements.end());
+    }
+    return anyKept;
+}
+
+// Removal of the statement being swept; a dry run only asks what would go.
+bool DeadCodeEliminator::drop() {
+    if (!dryRun) {
+        changed = true;
+    }
+    return false;
+}
+
+bool DeadCodeEliminator::sweep(NodePtr<ASTNode>& stmt, LiveSet& live, const LiveSet& pinned) {
+    auto isLive = [&](SlotId slot) { return live[slot] || pinned[slot]; };
+    switch (stmt->kind) {
+        case NodeKind::VarDecl:
+            return sweepVarDecl(static_cast<VarDeclNode&>(*stmt), live, pinned);
+        case NodeKind::MultiVarDecl: {
+            auto& decls = static_cast<MultiVarDeclNode&>(*stmt).declarations;
+            bool anyKept = false;
+            for (size_t i = decls.size(); i-- > 0;) {
+                if (sweepVarDecl(*decls[i], live, pinned)) {
+                    anyKept = true;
+                } else if (!dryRun) {
+                    decls.erase(decls.begin() + i);
+                }
+            }
+            return anyKept;
+        }
+        case NodeKind::Assign: {
+            auto& assign = static_cast<AssignNode&>(*stmt);
+            if (!isLive(assign.slot) && !hasSideEffects(*assign.value)) {
+                return drop();
+            }
+            live[assign.slot] = false;
+            markReads(*assign.value, live);
+            return true;
+        }
+        case NodeKind::CompoundAssign: {
+            auto& compound = static_cast<CompoundAssignNode&>(*stmt);
+            if (!isLive(compound.slot) && !hasSideEffects(*compound.value)) {
+                return drop();
+            }
+            markReads(compound, live);
+            return true;
+        }
+        case NodeKind::UnaryOp: {
+            // x++ on its own is a store to x; a[i]++ writes through a
+            // pointer other variables may share, so it always stays.
+            auto& unary = static_cast<UnaryOpNode&>(*stmt);
+            auto* varRef = node_cast<VarRefNode>(unary.operand.get());
+            if (varRef && (unary.op == UnaryOp::INCREMENT || unary.op == UnaryOp::DECREMENT) && !isLive(varRef->slot)) {
+                return drop();
+            }
+            break;
+        }
+        case NodeKind::Block:
+            return sweepBlock(static_cast<BlockNode&>(*stmt).statements, live, pinned);
+        case NodeKind::IfElse: {
+            auto& ifElse = static_cast<IfElseNode&>(*stmt);
+            if (auto* condition = node_cast<BoolLiteral>(ifElse.condition.get())) {
+                NodePtr<ASTNode>& taken = condition->value ? ifElse.then_block : ifElse.else_block;
+                if (!taken) {
+                    return drop();
+                }
+                if (dryRun) {
+                    return sweep(taken, live, pinned);
+                }
+                changed = true;
+                stmt = std::move(taken);
+                return sweep(stmt, live, pinned);
+            }
+            LiveSet elseLive = live;
+            bool elseKept = ifElse.else_block && sweep(ifElse.else_block, elseLive, pinned);
+            if (!elseKept && !dryRun) {
+                ifElse.else_block = nullptr;
+            }
+            bool thenKept = sweepBody(ifElse.then_block, live, pinned);
+            merge(live, elseLive);
+            if (!thenKept && !elseKept && !hasSideEffects(*ifElse.condition)) {
+                return drop();
+            }
+            markReads(*ifElse.condition, live);
+            return true;
+        }
+        case NodeKind::Loop: {
+            auto& loop = static_cast<LoopNode&>(*stmt);
+            LiveSet header(live.size());  // read by every test of the condition
+            if (loop.condition) markReads(*loop.condition, header);
+            if (loop.update) markReads(*loop.update, header);
+            // What is live at the end of the body is live after the loop or
+            // at the start of the next iteration; iterate until that settles.
+            LiveSet bodyOut = live;
+            merge(bodyOut, header);
+            for (;;) {
+                LiveSet next = bodyOut;
+                bool outer = dryRun;
+                dryRun = true;
+                sweepBody(loop.body, next, pinned);
+                dryRun = outer;
+                merge(next, live);
+                merge(next, header);
+                if (next == bodyOut) break;
+                bodyOut = std::move(next);
+            }
+            bool bodyKept = sweepBody(loop.body, bodyOut, pinned);
+            if (loop.type == LoopType::Foreach && !bodyKept && !hasSideEffects(*loop.collection)) {
+                return drop();
+            }
+            merge(live, bodyOut);
+            merge(live, header);
+            if (loop.collection) {
+                markReads(*loop.collection, live);
+            }
+            if (auto* decl = node_cast<VarDeclNode>(loop.init.get())) {
+                live[decl->slot] = false;
+                if (decl->value) markReads(*decl->value, live);
+            } else if (auto* assign = node_cast<AssignNode>(loop.init.get())) {
+                live[assign->slot] = false;
+                markReads(*assign->value, live);
+            }
+            return true;
+        }
+        case NodeKind::TryCatch: {
+            auto& tryCatch = static_cast<TryCatchNode&>(*stmt);
+            LiveSet catchLive = live;
+            sweepBlock(tryCatch.catchBlock->statements, catchLive, pinned);
+            // The catch block may run from any point of the try block.
+            LiveSet inTry = pinned;
+            merge(inTry, catchLive);
+            merge(live, catchLive);
+            bool tryKept = sweepBlock(tryCatch.tryBlock->statements, live, inTry);
+            merge(live, catchLive);
+            if (!tryKept) {
+                return drop(); // nothing left that could throw
+            }
+            return true;
+        }
+        case NodeKind::Match: {
+            auto& match = static_cast<MatchNode&>(*stmt);
+            LiveSet caseLive, afterMatch = live;  // live stays as is when no case matches
+            bool anyKept = false;
+            for (auto& caseNode : match.cases) {
+                caseLive = afterMatch;
+                anyKept = sweepBody(caseNode->body, caseLive, pinned) || anyKept;
+                merge(live, caseLive);
+            }
+            if (!anyKept && !hasSideEffects(match)) {
+                return drop();
+            }
+            markReads(*match.expression, live);
+            for (auto& caseNode : match.cases) {
+                if (caseNode->value) markReads(*caseNode->value, live);
+            }
+            return true;
+        }
+        case NodeKind::Print:
+            break;
+        default:
+            if (!hasSideEffects(*stmt)) {
+                return drop();
+            }
+            break;
+    }
+    markReads(*stmt, live);
+    return true;
+}
+
+// Sweeps a statement that has to stay in place, such as a branch or a loop
+// body; if it turns out dead it becomes an empty block. Returns false when
+// nothing is left to run.
+bool DeadCodeEliminator::sweepBody(NodePtr<ASTNode>& body, LiveSet& live, const LiveSet& pinned) {
+    if (sweep(body, live, pinned)) {
+        return true;
+    }
+    if (!dryRun && !isEmptyBlock(body.get())) {
+        body = arena.make<BlockNode>();
+    }
+    return false;
+}
+
+// The initializer of a variable that is read later is a store like any
+// other, but the declaration has to stay; only once nothing else names the
+// slot does the whole declaration go.
+bool DeadCodeEliminator::sweepVarDecl(VarDeclNode& decl, LiveSet& live, const LiveSet& pinned) {
+    bool pure = !decl.value || !hasSideEffects(*decl.value);
+    if (uses[decl.slot] == 0 && pure) {
+        return drop();
+    }
+    live[decl.slot] = false;
+    if (decl.value) {
+        markReads(*decl.value, live);
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef DEAD_CODE_H
+#define DEAD_CODE_H
+
+#include "ast.h"
+#include <vector>
+
+// Whether evaluating node may do more than produce a value: ++ or --, or
+// an integer division that may trap.
+bool hasSideEffects(ASTNode& node);
+
+// Removes stores no later read can see, declarations nothing refers to
+// any more, branches behind constant conditions, and statements left with
+// nothing to do. Liveness is computed backwards over the structured AST,
+// iterating loop bodies to a fixed point; inside a try, everything the
+// catch block reads counts as live throughout. Expressions with side
+// effects, ++ and -- or an integer division that may trap, are kept; a
+// bare `x++;` is just a store to x.
+// Needs an analyzed program, since it works on slots.
+class DeadCodeEliminator {
+public:
+    explicit DeadCodeEliminator(AstArena& arena) : arena(arena) {}
+    void eliminate(ProgramNode& program);
+
+private:
+    using LiveSet = std::vector<bool>;  // by slot
+
+    AstArena& arena;
+    std::vector<uint32_t> uses;  // by slot: reads and stores, not counting the declaration
+    bool changed = false;
+    bool dryRun = false;  // computing liveness only, nothing is removed
+
+    void countUses(ASTNode& node);
+    bool sweepBlock(std::vector<NodePtr<ASTNode>>& statements, LiveSet& live, const LiveSet& pinned);
+    bool sweep(NodePtr<ASTNode>& stmt, LiveSet& live, const LiveSet& pinned);  // false: drop stmt
+    bool sweepBody(NodePtr<ASTNode>& body, LiveSet& live, const LiveSet& pinned);
+    bool sweepVarDecl(VarDeclNode& decl, LiveSet& live, const LiveSet& pinned);
+    bool drop();
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "flat_ast.h"
+#include <stdexcept>
+
+FlatAst::FlatAst(const ProgramNode& program) {
+    topLevel.reserve(program.statements.size());
+    for (const auto& stmt : program.statements) {
+        topLevel.push_back(add(stmt.get()));
+    }
+    // the pools are read-only from here on; drop the growth slack
+    std::apply([](auto&... nodes) { (nodes.shrink_to_fit(), ...); }, pools);
+    lists.shrink_to_fit();
+    strings.shrink_to_fit();
+    postOrder.shrink_to_fit();
+}
+
+template <typename T>
+NodeRef FlatAst::push(const T& node) {
+    auto& nodes = pool<T>();
+    if (nodes.size() > NodeRef::MaxIndex) {
+        throw std::runtime_error("Program too large for the flat AST");
+    }
+    NodeRef ref(T::Kind, uint32_t(nodes.size()));
+    nodes.push_back(node);
+    postOrder.push_back(ref);
+    return ref;
+}
+
+// The children are flattened first (they may add lists of their own), then
+// their refs are appended to `lists` as one contiguous run.
+template <typename Range>
+NodeList FlatAst::addList(const Range& children) {
+    std::vector<NodeRef> refs;
+    refs.reserve(children.size());
+    for (const auto& child : children) {
+        refs.push_back(add(child.get()));
+    }
+    NodeList list{uint32_t(lists.size()), uint32_t(refs.size())};
+    lists.insert(lists.end(), refs.begin(), refs.end());
+    return list;
+}
+
+NodeRef FlatAst::add(const ASTNode* node) {
+    if (!node) {
+        return NodeRef();
+    }
+    switch (node->kind) {
+        case NodeKind::VarDecl: {
+            auto* varDecl = static_cast<const VarDeclNode*>(node);
+            NodeRef value = add(varDecl->value.get());
+            return push(flat::VarDecl{varDecl->symbol, value, varDecl->type});
+        }
+        case NodeKind::MultiVarDecl:
+            return push(flat::MultiVarDecl{addList(static_cast<const MultiVarDeclNode*>(node)->declarations)});
+        case NodeKind::Assign: {
+            auto* assign = static_cast<const AssignNode*>(node);
+            NodeRef value = add(assign->value.get());
+            return push(flat::Assign{assign->symbol, value});
+        }
+        case NodeKind::VarRef:
+            return push(flat::VarRef{static_cast<const VarRefNode*>(node)->symbol});
+        case NodeKind::IntLiteral:
+            return push(flat::IntLiteral{static_cast<const IntLiteral*>(node)->value});
+        case NodeKind::StrLiteral: {
+            const std::string& value = static_cast<const StrLiteral*>(node)->value;
+            flat::StrLiteral literal{uint32_t(strings.size()), uint32_t(value.size())};
+            strings += value;
+            return push(literal);
+        }
+        case NodeKind::BoolLiteral:
+            return push(flat::BoolLiteral{static_cast<const BoolLiteral*>(node)->value});
+        case NodeKind::FloatLiteral:
+            return push(flat::FloatLiteral{static_cast<const FloatLiteral*>(node)->value});
+        case NodeKind::CharLiteral:
+            return push(flat::CharLiteral{static_cast<const CharLiteral*>(node)->value});
+        case NodeKind::BinaryOp: {
+            auto* binary = static_cast<const BinaryOpNode*>(node);
+            NodeRef left = add(binary->left.get());
+            NodeRef right = add(binary->right.get());
+            return push(flat::Binary{left, right, binary->op});
+        }
+        case NodeKind::CompoundAssign: {
+            auto* compound = static_cast<const CompoundAssignNode*>(node);
+            NodeRef value = add(compound->value.get());
+            return push(flat::CompoundAssign{compound->symbol, value, compound->op});
+        }
+        case NodeKind::Block:
+            return push(flat::Block{addList(static_cast<const BlockNode*>(node)->statements)});
+        case NodeKind::IfElse: {
+            auto* ifElse = static_cast<const IfElseNode*>(node);
+            NodeRef condition = add(ifElse->condition.get());
+            NodeRef thenBlock = add(ifElse->then_block.get());
+            NodeRef elseBlock = add(ifElse->else_block.get());
+            return push(flat::IfElse{condition, thenBlock, elseBlock});
+        }
+        case NodeKind::Print:
+            return push(flat::Print{add(static_cast<const PrintNode*>(node)->expr.get())});
+        case NodeKind::Loop: {
+            auto* loop = static_cast<const LoopNode*>(node);
+            NodeRef init = add(loop->init.get());
+            NodeRef condition = add(loop->condition.get());
+            NodeRef update = add(loop->update.get());
+            NodeRef collection = add(loop->collection.get());
+            NodeRef body = add(loop->body.get());
+            return push(flat::Loop{init, condition, update, collection, body, loop->varSymbol, loop->type});
+        }
+        case NodeKind::Concat: {
+            auto* concat = static_cast<const ConcatNode*>(node);
+            NodeRef left = add(concat->left.get());
+            NodeRef right = add(concat->right.get());
+            return push(flat::Concat{left, right});
+        }
+        case NodeKind::ArrayLiteral:
+            return push(flat::ArrayLiteral{addList(static_cast<const ArrayLiteralNode*>(node)->elements)});
+        case NodeKind::UnaryOp: {
+            auto* unary = static_cast<const UnaryOpNode*>(node);
+            return push(flat::Unary{add(unary->operand.get()), unary->op});
+        }
+        case NodeKind::TryCatch: {
+            auto* tryCatch = static_cast<const TryCatchNode*>(node);
+            NodeRef tryBlock = add(tryCatch->tryBlock.get());
+            NodeRef catchBlock = add(tryCatch->catchBlock.get());
+            return push(flat::TryCatch{tryBlock, catchBlock, tryCatch->errorSymbol});
+        }
+        case NodeKind::Ternary: {
+            auto* ternary = static_cast<const TernaryExprNode*>(node);
+            NodeRef condition = add(ternary->condition.get());
+            NodeRef trueBranch = add(ternary->trueBranch.get());
+            NodeRef falseBranch = add(ternary->falseBranch.get());
+            return push(flat::Ternary{condition, trueBranch, falseBranch});
+        }
+        case NodeKind::MatchCase: {
+            auto* matchCase = static_cast<const MatchCaseNode*>(node);
+            NodeRef value = add(matchCase->value.get());
+            NodeRef body = add(matchCase->body.get());
+            return push(flat::MatchCase{value, body});
+        }
+        case NodeKind::Match: {
+            auto* match = static_cast<const MatchNode*>(node);
+            NodeRef expression = add(match->expression.get());
+            return push(flat::Match{expression, addList(match->cases)});
+        }
+        default:
+            throw std::runtime_error("Unknown node type in flat AST");
+    }
+}
+
+size_t FlatAst::bytesUsed() const {
+    size_t bytes = 0;
+    std::apply([&](const auto&... nodes) { ((bytes += nodes.capacity() * sizeof(nodes[0])), ...); }, pools);
+    return bytes + lists.capacity() * sizeof(NodeRef) + strings.capacity() +
+           (topLevel.capacity() + postOrder.capacity()) * sizeof(NodeRef);
+}
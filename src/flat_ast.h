@@ -0,0 +1,292 @@
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include "ast.h"
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Reference to a node of a FlatAst: the node's kind in the top 5 bits and its
+// index in that kind's pool in the low 27. A default-constructed ref is null.
+class NodeRef {
+public:
+    static constexpr uint32_t MaxIndex = (1u << 27) - 1;
+
+    NodeRef() = default;
+    NodeRef(NodeKind kind, uint32_t index) : bits(uint32_t(kind) << 27 | index) {}
+
+    NodeKind kind() const { return NodeKind(bits >> 27); }
+    uint32_t index() const { return bits & MaxIndex; }
+    explicit operator bool() const { return bits != UINT32_MAX; }
+
+private:
+    uint32_t bits = UINT32_MAX;
+};
+
+static_assert(uint32_t(NodeKind::Match) < 31, "node kinds must fit in the 5 kind bits of a NodeRef");
+
+// A run of children stored back to back in FlatAst::lists.
+struct NodeList {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+// One plain struct per node kind, mirroring the classes in ast.h. Children are
+// NodeRefs and the enums are a byte each, so most nodes fit in 4-12 bytes.
+namespace flat {
+struct VarDecl {
+    static constexpr NodeKind Kind = NodeKind::VarDecl;
+    SymbolId symbol;
+    NodeRef value;
+    VarType type;
+};
+struct MultiVarDecl {
+    static constexpr NodeKind Kind = NodeKind::MultiVarDecl;
+    NodeList declarations;
+};
+struct Assign {
+    static constexpr NodeKind Kind = NodeKind::Assign;
+    SymbolId symbol;
+    NodeRef value;
+};
+struct VarRef {
+    static constexpr NodeKind Kind = NodeKind::VarRef;
+    SymbolId symbol;
+};
+struct IntLiteral {
+    static constexpr NodeKind Kind = NodeKind::IntLiteral;
+    int32_t value;
+};
+struct StrLiteral {
+    static constexpr NodeKind Kind = NodeKind::StrLiteral;
+    uint32_t offset;  // into FlatAst::strings
+    uint32_t length;
+};
+struct BoolLiteral {
+    static constexpr NodeKind Kind = NodeKind::BoolLiteral;
+    bool value;
+};
+struct FloatLiteral {
+    static constexpr NodeKind Kind = NodeKind::FloatLiteral;
+    float value;
+};
+struct CharLiteral {
+    static constexpr NodeKind Kind = NodeKind::CharLiteral;
+    char value;
+};
+struct Binary {
+    static constexpr NodeKind Kind = NodeKind::BinaryOp;
+    NodeRef left;
+    NodeRef right;  // null for ABS
+    BinaryOp op;
+};
+struct CompoundAssign {
+    static constexpr NodeKind Kind = NodeKind::CompoundAssign;
+    SymbolId symbol;
+    NodeRef value;
+    BinaryOp op;
+};
+struct Block {
+    static constexpr NodeKind Kind = NodeKind::Block;
+    NodeList statements;
+};
+struct IfElse {
+    static constexpr NodeKind Kind = NodeKind::IfElse;
+    NodeRef condition;
+    NodeRef thenBlock;
+    NodeRef elseBlock;  // Block, IfElse or null
+};
+struct Print {
+    static constexpr NodeKind Kind = NodeKind::Print;
+    NodeRef expr;
+};
+struct Loop {
+    static constexpr NodeKind Kind = NodeKind::Loop;
+    NodeRef init;        // for
+    NodeRef condition;   // for
+    NodeRef update;      // for
+    NodeRef collection;  // foreach
+    NodeRef body;
+    SymbolId varSymbol;  // foreach
+    LoopType type;
+};
+struct Concat {
+    static constexpr NodeKind Kind = NodeKind::Concat;
+    NodeRef left;
+    NodeRef right;
+};
+struct ArrayLiteral {
+    static constexpr NodeKind Kind = NodeKind::ArrayLiteral;
+    NodeList elements;
+};
+struct Unary {
+    static constexpr NodeKind Kind = NodeKind::UnaryOp;
+    NodeRef operand;
+    UnaryOp op;
+};
+struct TryCatch {
+    static constexpr NodeKind Kind = NodeKind::TryCatch;
+    NodeRef tryBlock;
+    NodeRef catchBlock;
+    SymbolId errorSymbol;
+};
+struct Ternary {
+    static constexpr NodeKind Kind = NodeKind::Ternary;
+    NodeRef condition;
+    NodeRef trueBranch;
+    NodeRef falseBranch;
+};
+struct MatchCase {
+    static constexpr NodeKind Kind = NodeKind::MatchCase;
+    NodeRef value;  // null for _
+    NodeRef body;
+};
+struct Match {
+    static constexpr NodeKind Kind = NodeKind::Match;
+    NodeRef expression;
+    NodeList cases;
+};
+} // namespace flat
+
+// Index-based copy of a program's tree. Every node lives in a contiguous
+// per-kind pool and refers to its children by NodeRef, so a pass can either
+// recurse from statements() or make one linear sweep over order(), which
+// lists every node after its children. It carries no slots, value types or
+// buffer ownership, so no compiler phase runs on it; only bench_flat_ast
+// builds it.
+class FlatAst {
+public:
+    explicit FlatAst(const ProgramNode& program);
+
+    const std::vector<NodeRef>& statements() const { return topLevel; }
+    const std::vector<NodeRef>& order() const { return postOrder; }
+    size_t size() const { return postOrder.size(); }
+
+    template <typename T>
+    const T& get(NodeRef ref) const {
+        assert(ref.kind() == T::Kind);
+        return pool<T>()[ref.index()];
+    }
+    // Every node of one kind, in creation order.
+    template <typename T>
+    const std::vector<T>& pool() const {
+        return std::get<std::vector<T>>(pools);
+    }
+
+    const NodeRef* begin(NodeList list) const { return lists.data() + list.first; }
+    const NodeRef* end(NodeList list) const { return lists.data() + list.first + list.count; }
+    std::string_view text(const flat::StrLiteral& literal) const {
+        return std::string_view(strings).substr(literal.offset, literal.length);
+    }
+
+    // Calls f(ref) for ref and every node below it, parents first.
+    template <typename F>
+    void walk(NodeRef ref, F&& f) const;
+
+    size_t bytesUsed() const;  // pools, lists, string data and order()
+
+private:
+    std::tuple<std::vector<flat::VarDecl>, std::vector<flat::MultiVarDecl>, std::vector<flat::Assign>,
+               std::vector<flat::VarRef>, std::vector<flat::IntLiteral>, std::vector<flat::StrLiteral>,
+               std::vector<flat::BoolLiteral>, std::vector<flat::FloatLiteral>, std::vector<flat::CharLiteral>,
+               std::vector<flat::Binary>, std::vector<flat::CompoundAssign>, std::vector<flat::Block>,
+               std::vector<flat::IfElse>, std::vector<flat::Print>, std::vector<flat::Loop>,
+               std::vector<flat::Concat>, std::vector<flat::ArrayLiteral>, std::vector<flat::Unary>,
+               std::vector<flat::TryCatch>, std::vector<flat::Ternary>, std::vector<flat::MatchCase>,
+               std::vector<flat::Match>>
+        pools;
+    std::vector<NodeRef> lists;  // children of Block, ArrayLiteral, MultiVarDecl and Match
+    std::string strings;         // StrLiteral text, back to back
+    std::vector<NodeRef> topLevel;
+    std::vector<NodeRef> postOrder;
+
+    template <typename T>
+    std::vector<T>& pool() {
+        return std::get<std::vector<T>>(pools);
+    }
+    template <typename T>
+    NodeRef push(const T& node);       // appends to T's pool and to order()
+    NodeRef add(const ASTNode* node);  // flattens a subtree, children first
+    template <typename Range>
+    NodeList addList(const Range& children);
+};
+
+template <typename F>
+void FlatAst::walk(NodeRef ref, F&& f) const {
+    if (!ref) {
+        return;
+    }
+    f(ref);
+    auto each = [&](NodeList list) {
+        for (const NodeRef* it = begin(list); it != end(list); ++it) walk(*it, f);
+    };
+    switch (ref.kind()) {
+        case NodeKind::VarDecl: walk(get<flat::VarDecl>(ref).value, f); break;
+        case NodeKind::MultiVarDecl: each(get<flat::MultiVarDecl>(ref).declarations); break;
+        case NodeKind::Assign: walk(get<flat::Assign>(ref).value, f); break;
+        case NodeKind::BinaryOp: {
+            const auto& binary = get<flat::Binary>(ref);
+            walk(binary.left, f);
+            walk(binary.right, f);
+            break;
+        }
+        case NodeKind::CompoundAssign: walk(get<flat::CompoundAssign>(ref).value, f); break;
+        case NodeKind::Block: each(get<flat::Block>(ref).statements); break;
+        case NodeKind::IfElse: {
+            const auto& ifElse = get<flat::IfElse>(ref);
+            walk(ifElse.condition, f);
+            walk(ifElse.thenBlock, f);
+            walk(ifElse.elseBlock, f);
+            break;
+        }
+        case NodeKind::Print: walk(get<flat::Print>(ref).expr, f); break;
+        case NodeKind::Loop: {
+            const auto& loop = get<flat::Loop>(ref);
+            walk(loop.init, f);
+            walk(loop.condition, f);
+            walk(loop.update, f);
+            walk(loop.collection, f);
+            walk(loop.body, f);
+            break;
+        }
+        case NodeKind::Concat: {
+            const auto& concat = get<flat::Concat>(ref);
+            walk(concat.left, f);
+            walk(concat.right, f);
+            break;
+        }
+        case NodeKind::ArrayLiteral: each(get<flat::ArrayLiteral>(ref).elements); break;
+        case NodeKind::UnaryOp: walk(get<flat::Unary>(ref).operand, f); break;
+        case NodeKind::TryCatch: {
+            const auto& tryCatch = get<flat::TryCatch>(ref);
+            walk(tryCatch.tryBlock, f);
+            walk(tryCatch.catchBlock, f);
+            break;
+        }
+        case NodeKind::Ternary: {
+            const auto& ternary = get<flat::Ternary>(ref);
+            walk(ternary.condition, f);
+            walk(ternary.trueBranch, f);
+            walk(ternary.falseBranch, f);
+            break;
+        }
+        case NodeKind::MatchCase: {
+            const auto& matchCase = get<flat::MatchCase>(ref);
+            walk(matchCase.value, f);
+            walk(matchCase.body, f);
+            break;
+        }
+        case NodeKind::Match: {
+            const auto& match = get<flat::Match>(ref);
+            walk(match.expression, f);
+            each(match.cases);
+            break;
+        }
+        default: break;  // leaves
+    }
+}
+
+#endif
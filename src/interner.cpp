@@ -0,0 +1,80 @@
+#include "interner.h"
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+
+SymbolId Interner::find(std::string_view text, uint32_t hash) const {
+    if (slots.empty()) return NoSymbol;
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.id == NoSymbol) return NoSymbol;
+        if (slot.hash == hash && names[slot.id] == text) return slot.id;
+    }
+}
+
+uint32_t Interner::hash(std::string_view text) {
+    return uint32_t(std::hash<std::string_view>()(text));
+}
+
+SymbolId Interner::intern(std::string_view text, uint32_t hash) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        SymbolId id = find(text, hash);
+        if (id != NoSymbol) return id;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    SymbolId id = find(text, hash); // another thread may have added it meanwhile
+    if (id != NoSymbol) return id;
+
+    if ((names.size() + 1) * 2 > slots.size()) grow();
+    id = SymbolId(names.size());
+    names.push_back(store(text));
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].id != NoSymbol) i = (i + 1) & mask;
+    slots[i] = {hash, id};
+    return id;
+}
+
+std::string_view Interner::name(SymbolId id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (id >= names.size()) throw std::out_of_range("Unknown symbol id " + std::to_string(id));
+    return names[id];
+}
+
+size_t Interner::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.size();
+}
+
+// Copies text into the current block; names never move once stored.
+std::string_view Interner::store(std::string_view text) {
+    if (blockUsed + text.size() > blockSize) {
+        blockSize = std::max<size_t>(64 * 1024, text.size());
+        blocks.push_back(std::make_unique<char[]>(blockSize));
+        blockUsed = 0;
+    }
+    char* dest = blocks.back().get() + blockUsed;
+    std::memcpy(dest, text.data(), text.size());
+    blockUsed += text.size();
+    return std::string_view(dest, text.size());
+}
+
+void Interner::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.empty() ? 1024 : old.size() * 2, Slot{0, NoSymbol});
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.id == NoSymbol) continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].id != NoSymbol) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+Interner& globalInterner() {
+    static Interner interner;
+    return interner;
+}
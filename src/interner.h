@@ -0,0 +1,49 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Identifiers are interned once by the lexer; every later phase refers to a
+// variable by its SymbolId and compares or indexes by that integer.
+using SymbolId = uint32_t;
+constexpr SymbolId NoSymbol = UINT32_MAX;
+
+// Thread-safe, append-only string table. Ids are dense (0, 1, 2, ...) and
+// names stay valid for the life of the interner.
+class Interner {
+public:
+    static uint32_t hash(std::string_view text);
+    SymbolId intern(std::string_view text) { return intern(text, hash(text)); }
+    SymbolId intern(std::string_view text, uint32_t hash);  // hash must be hash(text)
+    std::string_view name(SymbolId id) const;
+    size_t size() const;
+
+private:
+    struct Slot {
+        uint32_t hash;
+        SymbolId id;  // NoSymbol when empty
+    };
+
+    mutable std::shared_mutex mutex;
+    std::vector<Slot> slots;               // open addressing, power-of-two size
+    std::vector<std::string_view> names;   // id -> text in blocks
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockUsed = 0, blockSize = 0;
+
+    SymbolId find(std::string_view text, uint32_t hash) const;  // caller holds the lock
+    std::string_view store(std::string_view text);
+    void grow();
+};
+
+Interner& globalInterner();  // shared by the lexer threads and all phases
+
+inline std::string symbolName(SymbolId id) {
+    return std::string(globalInterner().name(id));
+}
+
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+#include "lexer.h"
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Keyword recognition shared by the lexer and bench_lexer's reference lexer.
+
+namespace keywords {
+
+struct Keyword {
+    std::string_view text;
+    Token::Type type;
+    bool keepLexeme; // builtins and bool literals carry their spelling
+};
+
+constexpr Keyword keywords[] = {
+    {"int", Token::Int, false},          {"string", Token::StringType, false},
+    {"bool", Token::Bool, false},        {"true", Token::BoolLiteral, true},
+    {"false", Token::BoolLiteral, true}, {"float", Token::Float, false},
+    {"char", Token::Char, false},        {"if", Token::If, false},
+    {"else", Token::Else, false},        {"print", Token::Print, false},
+    {"for", Token::For, false},          {"foreach", Token::Foreach, false},
+    {"in", Token::In, false},            {"concat", Token::Concat, false},
+    {"pow", Token::Pow, false},          {"abs", Token::Abs, false},
+    {"array", Token::Array, false},      {"length", Token::Length, true},
+    {"min", Token::Min, true},           {"max", Token::Max, true},
+    {"index", Token::Index, true},       {"multiply", Token::Multiply, true},
+    {"add", Token::Add, true},           {"subtract", Token::Subtract, true},
+    {"divide", Token::Divide, true},     {"try", Token::Try, false},
+    {"catch", Token::Catch, false},      {"error", Token::Error, false},
+    {"match", Token::Match, false},
+};
+constexpr size_t keywordCount = sizeof(keywords) / sizeof(keywords[0]);
+constexpr size_t keywordTableSize = 64; // power of two, > keywordCount
+constexpr size_t maxKeywordLength = 8;
+
+// Hash over length, first and last character only, so an identifier is
+// classified without touching the bytes in between.
+constexpr uint32_t keywordHash(std::string_view word, uint32_t seed) {
+    uint32_t h = uint32_t(word.size()) * 0x9E3779B1u;
+    h ^= uint32_t(uint8_t(word.front())) * seed;
+    h ^= uint32_t(uint8_t(word.back())) * (seed >> 7 | 1u);
+    return (h ^ (h >> 15)) & (keywordTableSize - 1);
+}
+
+constexpr bool isCollisionFree(uint32_t seed) {
+    bool used[keywordTableSize] = {};
+    for (const Keyword& kw : keywords) {
+        uint32_t slot = keywordHash(kw.text, seed);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findKeywordSeed() {
+    for (uint32_t seed = 1; seed < 100000; seed += 2) {
+        if (isCollisionFree(seed)) return seed;
+    }
+    return 0;
+}
+
+constexpr uint32_t keywordSeed = findKeywordSeed();
+static_assert(keywordSeed != 0, "no perfect hash seed for the keyword table");
+
+// slot -> index into keywords[], -1 when empty
+constexpr std::array<int8_t, keywordTableSize> buildKeywordTable() {
+    std::array<int8_t, keywordTableSize> table{};
+    for (auto& slot : table) slot = -1;
+    for (size_t i = 0; i < keywordCount; ++i) {
+        table[keywordHash(keywords[i].text, keywordSeed)] = int8_t(i);
+    }
+    return table;
+}
+
+constexpr std::array<int8_t, keywordTableSize> keywordTable = buildKeywordTable();
+
+inline const Keyword* lookupKeyword(std::string_view word) {
+    if (word.size() < 2 || word.size() > maxKeywordLength) return nullptr;
+    int8_t index = keywordTable[keywordHash(word, keywordSeed)];
+    if (index < 0 || keywords[index].text != word) return nullptr;
+    return &keywords[index];
+}
+
+} // namespace keywords
@@ -1,417 +1,459 @@
 #include "lexer.h"
-#include <cctype>
+#include "keywords.h"
+#include "scan.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <future>
 #include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
  //  in tekenizing char we have problems and its desabled for now
-Lexer::Lexer(const std::string& source) : source(source) {}
 
-void Lexer::skipWhitespace() {
-    while (pos < source.size() && std::isspace(source[pos])) {
-        if (source[pos] == '\n') {
-            line++;
-            column = 1;
-        } else {
-            column++;
-        }
-        pos++;
-    }
+namespace {
+
+// Character classes. Every byte that can start or continue a token differently
+// gets its own class; everything else is Other.
+enum CharClass : uint8_t {
+    Other, Letter, Digit, Underscore, Quote, Dot, Plus, Minus, EqualSign, LessSign,
+    GreaterSign, Bang, Amp, Pipe, Percent, StarSign, SlashSign, Caret, LParen,
+    RParen, LBracket, RBracket, LBrace, RBrace, CommaSign, SemicolonSign,
+    ColonSign, QuestionSign,
+    ClassCount
+};
+
+constexpr std::array<uint8_t, 256> buildCharClasses() {
+    std::array<uint8_t, 256> classes{};
+    for (int c = 'a'; c <= 'z'; ++c) classes[c] = Letter;
+    for (int c = 'A'; c <= 'Z'; ++c) classes[c] = Letter;
+    for (int c = '0'; c <= '9'; ++c) classes[c] = Digit;
+    classes['_'] = Underscore;  classes['"'] = Quote;      classes['.'] = Dot;
+    classes['+'] = Plus;        classes['-'] = Minus;      classes['='] = EqualSign;
+    classes['<'] = LessSign;    classes['>'] = GreaterSign; classes['!'] = Bang;
+    classes['&'] = Amp;         classes['|'] = Pipe;       classes['%'] = Percent;
+    classes['*'] = StarSign;    classes['/'] = SlashSign;  classes['^'] = Caret;
+    classes['('] = LParen;      classes[')'] = RParen;     classes['['] = LBracket;
+    classes[']'] = RBracket;    classes['{'] = LBrace;     classes['}'] = RBrace;
+    classes[','] = CommaSign;   classes[';'] = SemicolonSign;
+    classes[':'] = ColonSign;   classes['?'] = QuestionSign;
+    return classes;
 }
 
-void Lexer::skipComments() {
-    if (pos + 1 >= source.size()) return;
-    
-    // Check for single-line comment (//)
-    if (source[pos] == '/' && source[pos + 1] == '/') {
-        pos += 2;
-        column += 2;
-        // Skip until end of line
-        while (pos < source.size() && source[pos] != '\n') {
-            pos++;
-            column++;
-        }
-        if (pos < source.size()) {  // consume the newline
-            pos++;
-            line++;
-            column = 1;
+constexpr std::array<uint8_t, 256> charClasses = buildCharClasses();
+
+// DFA states. Stop means "no transition": the token ends before the current byte.
+enum State : uint8_t {
+    Stop, Start,
+    Word, WordTail, BadName,  // identifiers and keywords
+    IntPart, SignedIntPart, FloatPart,
+    StringOpen,               // the rest of a string literal is scanned in bulk
+    PlusOp, PlusEqualOp, PlusPlusOp,
+    MinusOp, MinusEqualOp, MinusMinusOp, ArrowOp, NegParenOp,
+    EqualOp, EqualEqualOp, LessOp, LessEqualOp, GreaterOp, GreaterEqualOp,
+    BangOp, NotEqualOp, AmpOp, AndOp, PipeOp, OrOp,
+    PercentOp, ModuloEqualOp, StarOp, StarEqualOp, SlashOp, SlashEqualOp,
+    CaretOp, LParenOp, RParenOp, LBracketOp, RBracketOp, LBraceOp, RBraceOp,
+    CommaOp, DotOp, SemicolonOp, ColonOp, QuestionOp,
+    Unexpected,
+    StateCount
+};
+
+using TransitionTable = std::array<std::array<uint8_t, ClassCount>, StateCount>;
+
+constexpr TransitionTable buildTransitions() {
+    TransitionTable t{};  // all Stop
+    auto& start = t[Start];
+    for (auto& next : start) next = Unexpected;
+    start[Letter] = Word;          start[Underscore] = BadName;  start[Digit] = IntPart;
+    start[Quote] = StringOpen;     start[Plus] = PlusOp;         start[Minus] = MinusOp;
+    start[EqualSign] = EqualOp;    start[LessSign] = LessOp;     start[GreaterSign] = GreaterOp;
+    start[Bang] = BangOp;          start[Amp] = AmpOp;           start[Pipe] = PipeOp;
+    start[Percent] = PercentOp;    start[StarSign] = StarOp;     start[SlashSign] = SlashOp;
+    start[Caret] = CaretOp;        start[LParen] = LParenOp;     start[RParen] = RParenOp;
+    start[LBracket] = LBracketOp;  start[RBracket] = RBracketOp; start[LBrace] = LBraceOp;
+    start[RBrace] = RBraceOp;      start[CommaSign] = CommaOp;   start[Dot] = DotOp;
+    start[SemicolonSign] = SemicolonOp; start[ColonSign] = ColonOp; start[QuestionSign] = QuestionOp;
+
+    // Names may not start with '_' or have a digit as their second character.
+    t[Word][Letter] = WordTail;  t[Word][Underscore] = WordTail;  t[Word][Digit] = BadName;
+    t[WordTail][Letter] = WordTail;  t[WordTail][Underscore] = WordTail;  t[WordTail][Digit] = WordTail;
+
+    t[IntPart][Digit] = IntPart;              t[IntPart][Dot] = FloatPart;
+    t[SignedIntPart][Digit] = SignedIntPart;  t[SignedIntPart][Dot] = FloatPart;
+    t[FloatPart][Digit] = FloatPart;          t[FloatPart][Dot] = FloatPart;
+
+    // A sign followed by a digit is part of the number.
+    t[PlusOp][Digit] = SignedIntPart;   t[PlusOp][EqualSign] = PlusEqualOp;   t[PlusOp][Plus] = PlusPlusOp;
+    t[MinusOp][Digit] = SignedIntPart;  t[MinusOp][EqualSign] = MinusEqualOp; t[MinusOp][Minus] = MinusMinusOp;
+    t[MinusOp][GreaterSign] = ArrowOp;  t[MinusOp][LParen] = NegParenOp;      t[PlusOp][LParen] = NegParenOp;
+
+    t[EqualOp][EqualSign] = EqualEqualOp;
+    t[LessOp][EqualSign] = LessEqualOp;
+    t[GreaterOp][EqualSign] = GreaterEqualOp;
+    t[BangOp][EqualSign] = NotEqualOp;
+    t[AmpOp][Amp] = AndOp;
+    t[PipeOp][Pipe] = OrOp;
+    t[PercentOp][EqualSign] = ModuloEqualOp;
+    t[StarOp][EqualSign] = StarEqualOp;
+    t[SlashOp][EqualSign] = SlashEqualOp;
+    return t;
+}
+
+constexpr TransitionTable transitions = buildTransitions();
+
+struct Accept {
+    Token::Type type;
+    bool keepLexeme;
+};
+
+constexpr std::array<Accept, StateCount> buildAccepts() {
+    std::array<Accept, StateCount> a{};
+    for (auto& accept : a) accept = {Token::Error, true};
+    a[Word] = a[WordTail] = {Token::Ident, true};
+    a[IntPart] = {Token::IntLiteral, true};
+    a[SignedIntPart] = {Token::SignedIntLiteral, true};
+    a[FloatPart] = {Token::FloatLiteral, true};
+    a[StringOpen] = {Token::StrLiteral, true};
+    // the sign family keeps its spelling, the parser reads it back
+    a[PlusOp] = {Token::Plus, true};             a[PlusEqualOp] = {Token::PlusEqual, true};
+    a[PlusPlusOp] = {Token::PlusPlus, true};     a[MinusOp] = {Token::Minus, true};
+    a[MinusEqualOp] = {Token::MinusEqual, true}; a[MinusMinusOp] = {Token::MinusMinus, true};
+    a[ArrowOp] = {Token::Arrow, true};           a[NegParenOp] = {Token::negLeftParen, true};
+    a[CaretOp] = {Token::Xor, true};
+    a[EqualOp] = {Token::Equal, false};          a[EqualEqualOp] = {Token::EqualEqual, false};
+    a[LessOp] = {Token::Less, false};            a[LessEqualOp] = {Token::LessEqual, false};
+    a[GreaterOp] = {Token::Greater, false};      a[GreaterEqualOp] = {Token::GreaterEqual, false};
+    a[NotEqualOp] = {Token::NotEqual, false};    a[AndOp] = {Token::And, false};
+    a[OrOp] = {Token::Or, false};                a[PercentOp] = {Token::Modulo, false};
+    a[ModuloEqualOp] = {Token::ModuloEqual, false};
+    a[StarOp] = {Token::Star, false};            a[StarEqualOp] = {Token::StarEqual, false};
+    a[SlashOp] = {Token::Slash, false};          a[SlashEqualOp] = {Token::SlashEqual, false};
+    a[LParenOp] = {Token::LeftParen, false};     a[RParenOp] = {Token::RightParen, false};
+    a[LBracketOp] = {Token::LeftBracket, false}; a[RBracketOp] = {Token::RightBracket, false};
+    a[LBraceOp] = {Token::LeftBrace, false};     a[RBraceOp] = {Token::RightBrace, false};
+    a[CommaOp] = {Token::Comma, false};          a[DotOp] = {Token::Dot, false};
+    a[SemicolonOp] = {Token::Semicolon, false};  a[ColonOp] = {Token::Colon, false};
+    a[QuestionOp] = {Token::Question, false};
+    return a;  // lone '!', '&', '|' and unknown bytes stay Error
+}
+
+constexpr std::array<Accept, StateCount> accepts = buildAccepts();
+
+// The value slot of a token as stored in TokenBuffer::values.
+uint32_t valueBits(const Token& token) {
+    switch (token.type) {
+        case Token::FloatLiteral: {
+            uint32_t bits;
+            std::memcpy(&bits, &token.floatValue, sizeof(bits));
+            return bits;
         }
+        case Token::Ident:
+            return token.symbol;
+        default:
+            return uint32_t(token.intValue);
     }
-    // Check for multi-line comment (/* ... */)
-    else if (source[pos] == '/' && source[pos + 1] == '*') {
-        pos += 2;
-        column += 2;
-        bool commentClosed = false;
-        
-        while (pos + 1 < source.size()) {
-            if (source[pos] == '*' && source[pos + 1] == '/') {
-                pos += 2;
-                column += 2;
-                commentClosed = true;
-                break;
-            }
-            if (source[pos] == '\n') {
-                line++;
-                column = 1;
-            } else {
-                column++;
+}
+
+// Returns up to parts - 1 increasing offsets, each just past a newline that
+// lies outside every string literal and comment, so lexing can restart there
+// without context. The scan jumps between quotes and slashes, the only bytes
+// that open a multi-line token.
+std::vector<size_t> findSplitPoints(std::string_view source, size_t parts) {
+    const char* begin = source.data();
+    const char* end = begin + source.size();
+    std::vector<size_t> splits;
+    const char* p = begin;
+    const char* quote = scan::find(p, end, '"');
+    const char* slash = scan::find(p, end, '/');
+    while (splits.size() + 1 < parts) {
+        const char* target = begin + source.size() / parts * (splits.size() + 1);
+        if (quote < p) quote = scan::find(p, end, '"');
+        if (slash < p) slash = scan::find(p, end, '/');
+        const char* special = std::min(quote, slash);
+
+        // Everything in [p, special) is plain code; a newline there past the
+        // target is a split point.
+        const char* from = std::max(p, target);
+        if (from < special) {
+            const char* newline = scan::find(from, special, '\n');
+            if (newline != special) {
+                p = newline + 1;
+                splits.push_back(p - begin);
+                continue;
             }
-            pos++;
         }
-        
-        if (!commentClosed) {
-            error("Unterminated multi-line comment");
+        if (special == end) break;
+
+        if (*special == '"') {
+            const char* close = scan::find(special + 1, end, '"');
+            if (close == end) break;  // unterminated string runs to the end
+            p = close + 1;
+        } else if (special + 1 < end && special[1] == '/') {
+            const char* newline = scan::find(special + 2, end, '\n');
+            if (newline == end) break;
+            p = newline;  // the newline itself is code again
+        } else if (special + 1 < end && special[1] == '*') {
+            const char* star = special + 2;
+            while ((star = scan::find(star, end - 1, '*')) < end - 1 && star[1] != '/') ++star;
+            if (star >= end - 1) break;  // unterminated comment; let the lexer report it
+            p = star + 2;
+        } else {
+            p = special + 1;
         }
     }
+    return splits;
 }
 
-Token Lexer::nextToken() {
-    skipWhitespace();
-    skipComments();
-    skipWhitespace();
-    
-    if (pos >= source.size()) return {Token::Eof, "", line, column};
-    
-    char c = source[pos];
-    
-    size_t token_start_column = column;
-    
-    if (std::isalpha(c) || c == '_') {
-        size_t start = pos; ///////////////////////////////
-        pos++;
-        column++;
-        if(c == '_' || std::isdigit(source[pos])) throw std::runtime_error("Parser-Error: Names can not begin with numbers.");
-        while (pos < source.size() && (std::isalnum(source[pos]) || source[pos] == '_')) {
-            pos++;
-            column++;
-        }
-        std::string lexeme = source.substr(start, pos - start);
-        
-        if (lexeme == "int") return {Token::Int, "", line, column};
-        if (lexeme == "string") return {Token::StringType, "", line, column};
-        if (lexeme == "bool") return {Token::Bool, "", line, column};
-        if (lexeme == "true" || lexeme == "false") return {Token::BoolLiteral, lexeme, line, column};
-        if (lexeme == "float") return {Token::Float, "", line, column};
-        if (lexeme == "char") return {Token::Char, "", line, column};
-        if (lexeme == "if") return {Token::If, "", line, column};
-        if (lexeme == "else") return {Token::Else, "", line, column};
-        if (lexeme == "print") return {Token::Print, "", line, column};
-        if (lexeme == "for") return {Token::For, "", line, column};
-        if (lexeme == "foreach") return {Token::Foreach, "", line, column};
-        if (lexeme == "in") return {Token::In, "", line, column};
-        if (lexeme == "concat") return {Token::Concat, "", line, column};
-        if (lexeme == "pow") return {Token::Pow, "", line, column};
-        if (lexeme == "abs") return {Token::Abs, "", line, column};
-        if (lexeme == "array") return {Token::Array, "", line, column};
-        if (lexeme == "length") return {Token::Length, lexeme, line, column - int(lexeme.size())};
-        if (lexeme == "min") return {Token::Min, lexeme, line, column - int(lexeme.size())};
-        if (lexeme == "max") return {Token::Max, lexeme, line, column - int(lexeme.size())};
-        if (lexeme == "index") return {Token::Index, lexeme, line, column - int(lexeme.size())};
-        if (lexeme == "multiply") return {Token::Multiply, lexeme, line, column - int(lexeme.size())};
-        if (lexeme == "add") return {Token::Add, lexeme, line, column - int(lexeme.size())};
-        if (lexeme == "subtract") return {Token::Subtract, lexeme, line, column - int(lexeme.size())};
-        if (lexeme == "divide") return {Token::Divide, lexeme, line, column - int(lexeme.size())};
-        if (lexeme == "try") return {Token::Try, "", line, column};
-        if (lexeme == "catch") return {Token::Catch, "", line, column};
-        if (lexeme == "error") return {Token::Error, "", line, column};
-        if (lexeme == "match") return {Token::Match, "", line, column};
-        
-
-        //          add other keywords           //
-
-        return {Token::Ident, lexeme, line, column};
-    }
-    
-    if (c == '-' || c == '+' || std::isdigit(c)) {
-        bool hasDot = false;
-        bool isSigned = (c == '-' || c == '+');
-        size_t start = pos;
-        std::string lexeme;
-
-        // Handle sign
-        if (isSigned) {
-            lexeme += c;
-            pos++;
-            column++;
+} // namespace
 
-            if (peek() == '(') {
-                pos++;
-                column++;
-                return {Token::negLeftParen, lexeme + "=", line, column - 1};
-            }
-            // Check for -= or +=
-            if (peek() == '=') {
-                pos++;
-                column++;
-                return {c == '-' ? Token::MinusEqual : Token::PlusEqual, lexeme + "=", line, column - 1};
-            }
-            
-            if (c == '-' && peek() == '-') {
-                pos++;
-                column++;
-                return {Token::MinusMinus, lexeme + "-", line, column - 1};
-            }
-            
-            if (c == '+' && peek() == '+') {
-                pos++;
-                column++;
-                return {Token::PlusPlus, lexeme + "+", line, column - 1};
-            }
 
-            if (c == '-' && peek() == '>') {
-                pos++;
-                column++;
-                return {Token::Arrow, lexeme + "+", line, column - 1};
-            }
-            
-            if (pos >= source.size() || !std::isdigit(source[pos])) {
-                return {c == '-' ? Token::Minus : Token::Plus, lexeme, line, column - 1};
-            }
-        }
+Lexer::Lexer(std::string_view source) : source(source) {}
 
-        // Collect digits and optional dot
-        while (pos < source.size() && (std::isdigit(source[pos]) || source[pos] == '.')) {
-            if (source[pos] == '.') hasDot = true;
-            lexeme += source[pos];
-            pos++;
-            column++;
-        }
+void Lexer::skipWhitespace() {
+    const char* begin = source.data();
+    pos = scan::skipWhitespace(begin + pos, begin + source.size()) - begin;
+}
 
-        // Determine token type
-        if (hasDot) {
-            return {Token::FloatLiteral, lexeme, line, column - int(lexeme.size())};
-        } else if (isSigned) {
-            return {Token::SignedIntLiteral, lexeme, line, column - int(lexeme.size())};
-        } else {
-            return {Token::IntLiteral, lexeme, line, column - int(lexeme.size())};
-        }
+bool Lexer::skipComments() {
+    if (pos + 1 >= source.size()) return false;
+    const char* begin = source.data();
+    const char* end = begin + source.size();
+    
+    // Check for single-line comment (//)
+    if (source[pos] == '/' && source[pos + 1] == '/') {
+        // Skip until end of line, then consume the newline
+        const char* newline = scan::find(begin + pos + 2, end, '\n');
+        pos = newline == end ? source.size() : newline - begin + 1;
+        return true;
     }
-
-    if (c == '=') {
-        pos++; column++;
-        if (peek() == '=') {
-            pos++; column++;
-            return {Token::EqualEqual, "", line, column};
+    // Check for multi-line comment (/* ... */)
+    if (source[pos] == '/' && source[pos + 1] == '*') {
+        const char* p = begin + pos + 2;
+        while ((p = scan::find(p, end - 1, '*')) < end - 1) {
+            if (p[1] == '/') {
+                pos = p - begin + 2;
+                return true;
+            }
+            ++p;
         }
-        return {Token::Equal, "", line, column};
-    }
-
-    if (c == '[') {
-        pos++;
-        column++;
-        return {Token::LeftBracket, "", line, column};
+        pos = std::max(pos, source.size() - 1);
+        error("Unterminated multi-line comment");
     }
+    return false;
+}
 
-    if (c == '%') {
-        pos++; column++;
-        if (peek() == '=') {
-            pos++; column++;
-            return {Token::ModuloEqual, "", line, column};
-        }
-        return {Token::Modulo, "", line, column};
-    }
+Token Lexer::nextToken() {
+    do {
+        skipWhitespace();
+    } while (skipComments());
+    tokenStart = pos;
+    Token token = lexToken();
+    // Keywords carry no lexeme; they are located by where they start.
+    token.offset = uint32_t(token.lexeme.empty() ? tokenStart : token.lexeme.data() - source.data());
+    return token;
+}
 
-    if (c == ']') {
+Token Lexer::lexToken() {
+    if (pos >= source.size()) return {Token::Eof, ""};
+
+    // Run the DFA to the longest match; no token is longer than two bytes
+    // except names and numbers, whose states loop on themselves.
+    const char* begin = source.data();
+    size_t start = pos;
+    uint8_t state = Start;
+    while (pos < source.size()) {
+        uint8_t next = transitions[state][charClasses[uint8_t(begin[pos])]];
+        if (next == Stop) break;
+        state = next;
         pos++;
-        column++;
-        return {Token::RightBracket, "", line, column};
     }
 
-    if (c == '<') {
-        pos++; column++;
-        if (peek() == '=') {
-            pos++; column++;
-            return {Token::LessEqual, "", line, column};
+    switch (state) {
+        case BadName:
+            throw std::runtime_error("Parser-Error: Names can not begin with numbers.");
+        case Word:
+        case WordTail: {
+            std::string_view word = slice(start);
+            if (const keywords::Keyword* kw = keywords::lookupKeyword(word)) {
+                return {kw->type, kw->keepLexeme ? word : ""};
+            }
+            Token token{Token::Ident, word};
+            token.symbol = symbolFor(word);
+            return token;
         }
-        return {Token::Less, "", line, column};
-    }
-
-    if (c == '>') {
-        pos++; column++;
-        if (peek() == '=') {
-            pos++; column++;
-            return {Token::GreaterEqual, "", line, column};
+        case IntPart:
+            return number(Token::IntLiteral, start);
+        case SignedIntPart:
+            return number(Token::SignedIntLiteral, start);
+        case FloatPart:
+            return number(Token::FloatLiteral, start);
+        case StringOpen: {
+            size_t valueStart = pos;
+            pos = scan::find(begin + pos, begin + source.size(), '"') - begin;
+            if (pos >= source.size()) return {Token::Error, slice(valueStart)}; // unterminated string
+            std::string_view value = slice(valueStart);
+            pos++;
+            return {Token::StrLiteral, value};
         }
-        return {Token::Greater, "", line, column};
-    }
-
-    if (c == '!') {
-        pos++; column++;
-        if (peek() == '=') {
-            pos++; column++;
-            return {Token::NotEqual, "", line, column};
+        default: {
+            const Accept& accept = accepts[state];
+            return {accept.type, accept.keepLexeme ? slice(start) : ""};
         }
-        // not defined yet. in case of use will return error
     }
+}
 
-    if (c == '&') {
-        pos++; column++;
-        if (peek() == '&') {
-            pos++; column++;
-            return {Token::And, "", line, column};
-        }
-        // not defined yet. in case of use will return error
+Token Lexer::number(Token::Type type, size_t start) {
+    std::string_view lexeme = slice(start);
+    const char* first = lexeme.data();
+    const char* last = first + lexeme.size();
+    if (*first == '+') ++first;  // from_chars only accepts a leading '-'
+
+    Token token{type, lexeme};
+    std::from_chars_result result = type == Token::FloatLiteral
+        ? std::from_chars(first, last, token.floatValue)
+        : std::from_chars(first, last, token.intValue);
+    if (result.ec == std::errc::result_out_of_range) {
+        error("Number literal out of range: " + std::string(lexeme));
     }
-
-    if (c == '^') {
-        pos++;
-        column++;
-        return {Token::Xor, "^", line, column};
+    if (result.ec != std::errc() || result.ptr != last) {
+        error("Malformed number literal: " + std::string(lexeme));
     }
+    return token;
+}
 
-    if (c == '|') {
-        pos++; column++;
-        if (peek() == '|') {
-            pos++; column++;
-            return {Token::Or, "", line, column};
-        }
-        // not defined yet. in case of use will return error
+SymbolId Lexer::symbolFor(std::string_view word) {
+    uint32_t hash = Interner::hash(word);
+    CachedSymbol& cached = symbolCache[hash % symbolCache.size()];
+    if (cached.text != word) {
+        cached = {word, globalInterner().intern(word, hash)};
     }
+    return cached.id;
+}
 
-    if (c == ',') {
-        pos++;
-        column++;
-        return {Token::Comma, "", line, column};
-    }
+void Lexer::error(const std::string& msg) {
+    SourceLocation loc = LineIndex(source).locate(uint32_t(pos));
+    throw std::runtime_error(msg + " at line " + std::to_string(loc.line) + 
+                            ", column " + std::to_string(loc.column));
+}
 
-    if (c == '.') {
-        pos++;
-        column++;
-        return {Token::Dot, "", line, column};
-    }
+std::string_view Lexer::slice(size_t start) const {
+    return std::string_view(source.data() + start, pos - start);
+}
 
-    if (c == '(') {
-        pos++;
-        column++;
-        return {Token::LeftParen, "", line, column};
-    }
-    
-    if (c == ')') {
-        pos++;
-        column++;
-        return {Token::RightParen, "", line, column};
-    }
+char Lexer::peek() const {
+    return pos < source.size() ? source[pos] : '\0';
+}
 
-    if (c == '{') {
-        pos++;
-        column++;
-        return {Token::LeftBrace, "", line, column};
+TokenBuffer Lexer::tokenize() {
+    if (source.size() > UINT32_MAX) {
+        throw std::runtime_error("Source too large: token offsets are 32-bit");
     }
+    TokenBuffer tokens;
+    tokens.source = source;
+    size_t estimate = source.size() / 4 + 1;
+    tokens.types.reserve(estimate);
+    tokens.offsets.reserve(estimate);
+    tokens.lengths.reserve(estimate);
+    tokens.values.reserve(estimate);
+    appendTokens(tokens);
+    return tokens;
+}
 
-    if (c == '}') {
-        pos++;
-        column++;
-        return {Token::RightBrace, "", line, column};
-    }
+void Lexer::appendTokens(TokenBuffer& tokens) {
+    Token token;
+    do {
+        token = nextToken();
+        tokens.types.push_back(uint8_t(token.type));
+        tokens.offsets.push_back(token.offset);
+        tokens.lengths.push_back(uint32_t(token.lexeme.size()));
+        tokens.values.push_back(valueBits(token));
+    } while (token.type != Token::Eof);
+}
 
-    if (c == ';') {
-        pos++;
-        column++;
-        return {Token::Semicolon, "", line, column};
+TokenBuffer Lexer::tokenizeParallel(unsigned threads, size_t minParallelBytes) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> bounds;
+    if (threads > 1 && source.size() >= minParallelBytes && pos == 0) {
+        bounds = findSplitPoints(source, threads);
     }
-    
-    if (c == '"') {
-        pos++;
-        column++;
-        size_t start = pos;
-        while (pos < source.size() && source[pos] != '"') {
-            if (source[pos] == '\n') {
-                line++;
-                column = 1;
-            } else {
-                column++;
-            }
-            pos++;
-        }
-        
-        
-        if (pos >= source.size()) return {Token::Error, "Unterminated string", line, column};
-        std::string value = source.substr(start, pos - start);
-        pos++;
-        column++;
-        return {Token::StrLiteral, value, line, column};
-    }
-    
-    if (c == ':') {
-        pos++;
-        column++;
-        return {Token::Colon, "", line, column};
+    if (bounds.empty()) return tokenize();
+    if (source.size() > UINT32_MAX) {
+        throw std::runtime_error("Source too large: token offsets are 32-bit");
     }
-
-    if (c == '_') {
-        pos++;
-        column++;
-        return {Token::Underscore, "", line, column};
+    bounds.insert(bounds.begin(), 0);
+    bounds.push_back(source.size());
+
+    // Each chunk is lexed by a Lexer that sees the source up to the chunk's
+    // end and starts at its beginning, so offsets come out absolute and
+    // diagnostics still report the right line.
+    std::vector<std::future<TokenBuffer>> chunks;
+    for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+        chunks.push_back(std::async(std::launch::async, [this, begin = bounds[i], end = bounds[i + 1]] {
+            Lexer chunk(source.substr(0, end));
+            chunk.pos = begin;
+            TokenBuffer tokens;
+            size_t estimate = (end - begin) / 4 + 1;
+            tokens.types.reserve(estimate);
+            tokens.offsets.reserve(estimate);
+            tokens.lengths.reserve(estimate);
+            tokens.values.reserve(estimate);
+            chunk.appendTokens(tokens);
+            return tokens;
+        }));
     }
 
-    if (c == '?') {
-        pos++;
-        column++;
-        return {Token::Question, "", line, column};
-    }
-    // std::cout << "reached here ...\n";
-    if (c == '+') {
-        pos++; column++;
-        if (peek() == '=') {
-            pos++; column++;
-            return {Token::PlusEqual, "", line, column};
-        }
-        return {Token::Plus, "", line, column};
-    }
-    
-    if (c == '*') {
-        pos++; column++;
-        if (peek() == '=') {
-            pos++; column++;
-            return {Token::StarEqual, "", line, column};
-        }
-        return {Token::Star, "", line, column};
+    // Collect in order so the first error in the source is the one reported.
+    std::vector<TokenBuffer> parts;
+    size_t total = 0;
+    for (auto& chunk : chunks) {
+        parts.push_back(chunk.get());
+        total += parts.back().size();
     }
-    
-    if (c == '/') {
-        pos++; column++;
-        if (peek() == '=') {
-            pos++; column++;
-            return {Token::SlashEqual, "", line, column};
-        }
-        return {Token::Slash, "", line, column};
+    TokenBuffer tokens;
+    tokens.source = source;
+    tokens.types.reserve(total);
+    tokens.offsets.reserve(total);
+    tokens.lengths.reserve(total);
+    tokens.values.reserve(total);
+    for (size_t i = 0; i < parts.size(); ++i) {
+        // every chunk but the last ends in an Eof that is really a split point
+        size_t count = parts[i].size() - (i + 1 < parts.size());
+        tokens.types.insert(tokens.types.end(), parts[i].types.begin(), parts[i].types.begin() + count);
+        tokens.offsets.insert(tokens.offsets.end(), parts[i].offsets.begin(), parts[i].offsets.begin() + count);
+        tokens.lengths.insert(tokens.lengths.end(), parts[i].lengths.begin(), parts[i].lengths.begin() + count);
+        tokens.values.insert(tokens.values.end(), parts[i].values.begin(), parts[i].values.begin() + count);
     }
-    //        add other operators or anything needed like these           //
-
-    pos++;
-    column++;
-    return {Token::Error, "Unexpected character", line, column};
+    pos = source.size();
+    return tokens;
 }
 
-Token Lexer::peekToken() {
-    size_t saved_pos = pos;
-    int saved_line = line;
-    int saved_column = column;
-    
-    Token token = nextToken();
-    
-    pos = saved_pos;
-    line = saved_line;
-    column = saved_column;
-    
+Token TokenBuffer::operator[](size_t i) const {
+    if (i >= types.size()) i = types.size() - 1; // reads past the end see Eof
+    Token token{Token::Type(types[i]), source.substr(offsets[i], lengths[i]), offsets[i]};
+    if (token.type == Token::FloatLiteral) {
+        std::memcpy(&token.floatValue, &values[i], sizeof(float));
+    } else if (token.type == Token::Ident) {
+        token.symbol = values[i];
+    } else {
+        token.intValue = int32_t(values[i]);
+    }
     return token;
 }
 
-void Lexer::error(const std::string& msg) {
-    // You can implement error reporting here
-    throw std::runtime_error(msg + " at line " + std::to_string(line) + 
-                            ", column " + std::to_string(column));
+LineIndex::LineIndex(std::string_view source) {
+    const char* begin = source.data();
+    const char* end = begin + source.size();
+    lineStarts.push_back(0);
+    for (const char* p = scan::find(begin, end, '\n'); p != end; p = scan::find(p + 1, end, '\n')) {
+        lineStarts.push_back(uint32_t(p - begin + 1));
+    }
 }
 
-char Lexer::peek() const {
-    return pos < source.size() ? source[pos] : '\0';
+SourceLocation LineIndex::locate(uint32_t offset) const {
+    // Last line start at or before offset; lineStarts[0] == 0 so it always exists.
+    auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - 1;
+    return {int(it - lineStarts.begin()) + 1, int(offset - *it) + 1};
 }
-
-char Lexer::advance() {
-    if (pos >= source.size()) return '\0';
-    char c = source[pos++];
-    if (c == '\n') {
-        line++;
-        column = 1;
-    } else {
-        column++;
-    }
-    return c;
-}
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
+#include "interner.h"
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <variant>
+#include <vector>
 
 struct Token {
     enum Type {
@@ -83,28 +88,80 @@ struct Token {
     };
     
     Type type;
-    std::string lexeme;
-    int line;
-    int column;  // ← New: Character position in line
+    std::string_view lexeme;  // view into the lexer's source buffer; valid while the Lexer lives
+    uint32_t offset;  // byte offset of the token in the source; see LineIndex
+    union {           // decoded once by the lexer
+        int32_t intValue;  // IntLiteral, SignedIntLiteral
+        float floatValue;  // FloatLiteral
+        SymbolId symbol;   // Ident
+    };
+};
+
+static_assert(Token::Error <= UINT8_MAX, "token types must fit in a byte");
+
+// Struct-of-arrays token stream built by Lexer::tokenize(). Token i is
+// (types[i], source[offsets[i], offsets[i] + lengths[i]), offsets[i], values[i]);
+// the stream always ends with an Eof token.
+struct TokenBuffer {
+    std::string_view source;
+    std::vector<uint8_t> types;     // Token::Type
+    std::vector<uint32_t> offsets;  // lexeme start, or token start when the lexeme is empty
+    std::vector<uint32_t> lengths;  // lexeme length
+    std::vector<uint32_t> values;   // bits of intValue/floatValue/symbol, 0 for other tokens
+
+    size_t size() const { return types.size(); }
+    Token operator[](size_t i) const;  // indexes past the end return the Eof token
+};
+
+struct SourceLocation {
+    int line;    // 1-based
+    int column;  // 1-based, in bytes
+};
+
+// Maps byte offsets back to line/column. Tokens only carry an offset, so this
+// is built on demand when a diagnostic actually needs a location.
+class LineIndex {
+public:
+    explicit LineIndex(std::string_view source);
+    SourceLocation locate(uint32_t offset) const;
+
+private:
+    std::vector<uint32_t> lineStarts;  // offset of the first byte of each line
 };
 
 class Lexer {
 public:
-    Lexer(const std::string& source);
+    // The lexer does not copy the program text; `source` must outlive the
+    // lexer and every token it hands out.
+    Lexer(std::string_view source);
     
     Token nextToken();
-    Token peekToken();  // ← New: LL(1) lookahead
+    TokenBuffer tokenize();  // lexes the whole source in one pass
+    // Splits sources of at least minParallelBytes into chunks that start
+    // outside strings and comments and lexes them on `threads` workers
+    // (0 = one per core). Smaller sources fall back to tokenize().
+    TokenBuffer tokenizeParallel(unsigned threads = 0, size_t minParallelBytes = 1 << 20);
     
     void error(const std::string& msg);
 
 private:
-    std::string source;
+    std::string_view source;
     size_t pos = 0;
-    int line = 1;
-    int column = 1;
+    size_t tokenStart = 0;  // where the token being lexed begins
+
+    // Recently seen identifiers, so repeats skip the shared interner's lock.
+    struct CachedSymbol {
+        std::string_view text;
+        SymbolId id;
+    };
+    std::array<CachedSymbol, 256> symbolCache{};
     
+    Token lexToken();  // lexes one token at pos; nextToken() fills in its offset
+    void appendTokens(TokenBuffer& tokens);  // lexes from pos to the end, Eof included
+    Token number(Token::Type type, size_t start);  // decodes source[start, pos)
+    SymbolId symbolFor(std::string_view word);
     void skipWhitespace();
-    void skipComments();
+    bool skipComments();  // true if a comment was skipped
+    std::string_view slice(size_t start) const;  // source[start, pos)
     char peek() const;
-    char advance();
-};
\ No newline at end of file
+};
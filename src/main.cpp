@@ -1,7 +1,10 @@
 #include "lexer.h"
 #include "parser.h"
+#include "semantic.h"
 #include "optimizer.h"
 #include "codegen.h"
+#include "source.h"
+#include <cstring>
 #include <iostream>
 /*
     to run it in lli:
@@ -16,18 +19,43 @@
 // for and foreach (mostly for) has some problems, check its abilities and fix them
 // try-catch might have problems on hadeling exceptions
 // equality for array elements
+/*
+    input modes:
+       ./compiler '<code>'      program text as the argument
+       ./compiler -f <file>     source file, memory-mapped and lexed in place
+       ./compiler -             program text from stdin
+    a leading --unroll-report also lists the loop unroller's decisions on stderr
+*/
 int main(int argc, char* argv[]) {
-    std::string source = argv[1];  // Changed this line only
+    bool unrollReport = argc > 1 && std::strcmp(argv[1], "--unroll-report") == 0;
+    if (unrollReport) {
+        --argc;
+        ++argv;
+    }
+    if (argc < 2 || (std::strcmp(argv[1], "-f") == 0 && argc < 3)) {
+        std::cerr << "Usage: " << argv[0] << " [--unroll-report] '<code>' | -f <file> | -" << std::endl;
+        return 1;
+    }
     
     try {
-        Lexer lexer(source);
+        SourceBuffer source = std::strcmp(argv[1], "-f") == 0 ? SourceBuffer::fromFile(argv[2])
+                            : std::strcmp(argv[1], "-") == 0  ? SourceBuffer::fromStdin()
+                                                              : SourceBuffer::fromArgument(argv[1]);
+        Lexer lexer(source.text());
         Parser parser(lexer);
         auto ast = parser.parseProgram();
-        
+
+        // Annotates every expression with its type; CodeGen depends on it.
+        SemanticAnalyzer analyzer;
+        analyzer.analyze(ast.get());
+
     // std::cout << "Before Optimization:\n" << ast->toString() << "\n";
     // std::cout << "\nBefore Optimization: " << optimizer.printNode(*ast) << "\n\n";
     Optimizer optimizer;
     optimizer.optimize(*ast);
+    if (unrollReport) {
+        optimizer.printUnrollReport(std::cerr);
+    }
     // optimizer.printModifiedNodes();
     // std::cout << "\nAfter Optimization: " << optimizer.printNode(*ast) << "\n\n";
 
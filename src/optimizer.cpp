@@ -1,153 +1,145 @@
 #include "optimizer.h"
+#include "constant_fold.h"
+#include "dead_code.h"
+#include "interner.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
 #include <optional>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <type_traits>
 
 void Optimizer::optimize(ProgramNode& program) {
     modifiedNodes.clear();
+    unrollReport.clear();
+    unrolledAny = false;
+    arena = &program.arena;
+    this->program = &program;
+    // Folding first turns constant loop bounds and if conditions into the
+    // literals the rewrites below look for.
+    ConstantFolder folder(program.arena);
+    folder.fold(program);
     for (size_t i = 0; i < program.statements.size(); ++i) {
-        if (auto* loop = dynamic_cast<LoopNode*>(program.statements[i].get())) {
-            if (loop->type == LoopType::For) {
-                auto original = cloneNode(*loop);
-                auto unrolled = unrollForLoop(*loop);
-                if (unrolled) {
-                    modifiedNodes.push_back({std::move(original), cloneNode(*unrolled)});
-                    program.statements[i] = std::move(unrolled);
-                }
-            }
-        } else if (auto* ifElse = dynamic_cast<IfElseNode*>(program.statements[i].get())) {
+        if (auto* ifElse = node_cast<IfElseNode>(program.statements[i].get())) {
             auto result = evaluateConstantCondition(*ifElse->condition);
             if (result.has_value()) {
                 auto original = cloneNode(*ifElse);
-                auto newBlock = std::make_unique<BlockNode>();
+                auto newBlock = arena->make<BlockNode>();
                 if (*result) {
-                    newBlock->statements = std::move(dynamic_cast<BlockNode&>(*ifElse->then_block).statements);
+                    newBlock->statements = std::move(node_cast<BlockNode>(ifElse->then_block.get())->statements);
+                } else if (auto* elseBlock = node_cast<BlockNode>(ifElse->else_block.get())) {
+                    newBlock->statements = std::move(elseBlock->statements);
                 } else if (ifElse->else_block) {
-                    newBlock->statements = std::move(dynamic_cast<BlockNode&>(*ifElse->else_block).statements);
+                    newBlock->statements.push_back(std::move(ifElse->else_block)); // else-if chain
                 }
                 modifiedNodes.push_back({std::move(original), cloneNode(*newBlock)});
                 program.statements[i] = std::move(newBlock);
-            } else {
-                optimizeNode(*program.statements[i]);
             }
-        } else {
-            optimizeNode(*program.statements[i]);
         }
+        optimizeNode(*program.statements[i]);
+        unrollLoop(program.statements[i]);
+    }
+    if (unrolledAny) {
+        folder.fold(program); // the unrolled copies now use literals for the loop variable
+    }
+    for (auto& stmt : program.statements) {
+        reduceStrength(stmt);
+    }
+    exclusiveBuffers.assign(program.slotCount, false);
+    for (auto& stmt : program.statements) {
+        noteExclusiveBuffers(*stmt);
+    }
+    for (auto& stmt : program.statements) {
+        hoistLoops(stmt);
     }
+    for (auto& stmt : program.statements) {
+        eliminateCommonSubexpressions(*stmt);
+    }
+    shareExpressions(program.statements);
+    // Folding and unrolling leave declarations nothing reads and branches
+    // behind constant conditions; clear them out before CodeGen sees them.
+    DeadCodeEliminator(program.arena).eliminate(program);
 }
 
+// Unrolls loops bottom-up, so an outer loop is costed with its inner loops
+// already expanded.
 void Optimizer::optimizeNode(ASTNode& node) {
-    if (auto* block = dynamic_cast<BlockNode*>(&node)) {
-        for (auto& stmt : block->statements) {
-            optimizeNode(*stmt);
-        }
-    } else if (auto* match = dynamic_cast<MatchNode*>(&node)) {
-        optimizeNode(*match->expression);
-        for (auto& caseNode : match->cases) {
-            optimizeNode(*caseNode->body);
-            if (caseNode->value) {
-                optimizeNode(*caseNode->value);
-            }
+    forEachChild(node, [&](auto& child) {
+        optimizeNode(*child);
+        if constexpr (std::is_same_v<std::decay_t<decltype(child)>, NodePtr<ASTNode>>) {
+            unrollLoop(child);
         }
-    } else if (auto* print = dynamic_cast<PrintNode*>(&node)) {
-        optimizeNode(*print->expr);
-    } else if (auto* assign = dynamic_cast<AssignNode*>(&node)) {
-        optimizeNode(*assign->value);
-    } else if (auto* compound = dynamic_cast<CompoundAssignNode*>(&node)) {
-        optimizeNode(*compound->value);
-    } else if (auto* unary = dynamic_cast<UnaryOpNode*>(&node)) {
-        optimizeNode(*unary->operand);
-    } else if (auto* binary = dynamic_cast<BinaryOpNode*>(&node)) {
-        optimizeNode(*binary->left);
-        if (binary->right) optimizeNode(*binary->right);
-    } else if (auto* varDecl = dynamic_cast<VarDeclNode*>(&node)) {
-        if (varDecl->value) {
-            optimizeNode(*varDecl->value);
-        }
-    } else if (auto* concat = dynamic_cast<ConcatNode*>(&node)) {
-        optimizeNode(*concat->left);
-        optimizeNode(*concat->right);
-    } else if (auto* tryCatch = dynamic_cast<TryCatchNode*>(&node)) {
-        optimizeNode(*tryCatch->tryBlock);
-        optimizeNode(*tryCatch->catchBlock);
+    });
+}
+
+// Replaces stmt with its unrolled form when it is a for loop worth unrolling.
+void Optimizer::unrollLoop(NodePtr<ASTNode>& stmt) {
+    auto* loop = node_cast<LoopNode>(stmt.get());
+    if (!loop || loop->type != LoopType::For) {
+        return;
+    }
+    auto original = cloneNode(*loop);
+    if (auto unrolled = unrollForLoop(*loop)) {
+        modifiedNodes.push_back({std::move(original), cloneNode(*unrolled)});
+        stmt = std::move(unrolled);
+        unrolledAny = true;
     }
 }
 
+// ConstantFolder has already reduced any constant condition to a literal.
 std::optional<bool> Optimizer::evaluateConstantCondition(const ASTNode& condition) const {
-    if (auto* boolLit = dynamic_cast<const BoolLiteral*>(&condition)) {
+    if (auto* boolLit = node_cast<const BoolLiteral>(&condition)) {
         return boolLit->value;
     }
-    if (auto* binary = dynamic_cast<const BinaryOpNode*>(&condition)) {
-        if (binary->op == BinaryOp::AND || binary->op == BinaryOp::OR) {
-            auto left = evaluateConstantCondition(*binary->left);
-            auto right = evaluateConstantCondition(*binary->right);
-            if (left.has_value() && right.has_value()) {
-                if (binary->op == BinaryOp::AND) {
-                    return *left && *right;
-                } else {
-                    return *left || *right;
-                }
-            }
-        } else if (auto* leftLit = dynamic_cast<const IntLiteral*>(binary->left.get())) {
-            if (auto* rightLit = dynamic_cast<const IntLiteral*>(binary->right.get())) {
-                switch (binary->op) {
-                    case BinaryOp::LESS: return leftLit->value < rightLit->value;
-                    case BinaryOp::LESS_EQUAL: return leftLit->value <= rightLit->value;
-                    case BinaryOp::GREATER: return leftLit->value > rightLit->value;
-                    case BinaryOp::GREATER_EQUAL: return leftLit->value >= rightLit->value;
-                    case BinaryOp::EQUAL: return leftLit->value == rightLit->value;
-                    case BinaryOp::NOT_EQUAL: return leftLit->value != rightLit->value;
-                    default: return std::nullopt;
-                }
-            }
-        }
-    }
     return std::nullopt;
 }
 
 std::string Optimizer::printNode(const ASTNode& node) const {
-    if (auto* loop = dynamic_cast<const LoopNode*>(&node)) {
+    if (auto* loop = node_cast<const LoopNode>(&node)) {
         if (loop->type == LoopType::For) {
             std::string result = "for (";
-            if (auto* varDecl = dynamic_cast<VarDeclNode*>(loop->init.get())) {
-                result += varDecl->name + " = " + printNode(*varDecl->value);
-            } else if (auto* assign = dynamic_cast<AssignNode*>(loop->init.get())) {
-                result += assign->name + " = " + printNode(*assign->value);
+            if (auto* varDecl = node_cast<VarDeclNode>(loop->init.get())) {
+                result += symbolName(varDecl->symbol) + " = " + printNode(*varDecl->value);
+            } else if (auto* assign = node_cast<AssignNode>(loop->init.get())) {
+                result += symbolName(assign->symbol) + " = " + printNode(*assign->value);
             }
             result += "; " + printNode(*loop->condition) + "; ";
-            if (auto* unary = dynamic_cast<UnaryOpNode*>(loop->update.get())) {
+            if (auto* unary = node_cast<UnaryOpNode>(loop->update.get())) {
                 result += (unary->op == UnaryOp::INCREMENT) ? "++" : "--";
-                result += dynamic_cast<VarRefNode*>(unary->operand.get())->name;
+                result += symbolName(node_cast<VarRefNode>(unary->operand.get())->symbol);
             }
             result += ") { ";
             result += printNode(*loop->body) + " }";
             return result;
         }
         return "[foreach loop]";
-    } else if (auto* block = dynamic_cast<const BlockNode*>(&node)) {
+    } else if (auto* block = node_cast<const BlockNode>(&node)) {
         std::string result = "{ ";
         for (const auto& stmt : block->statements) {
-            result += printNode(*stmt) + "; ";
+            result += (stmt ? printNode(*stmt) : "[unknown]") + "; ";
         }
         result += "}";
         return result;
-    } else if (auto* print = dynamic_cast<const PrintNode*>(&node)) {
+    } else if (auto* print = node_cast<const PrintNode>(&node)) {
         return "print(" + printNode(*print->expr) + ")";
-    } else if (auto* intLit = dynamic_cast<const IntLiteral*>(&node)) {
+    } else if (auto* intLit = node_cast<const IntLiteral>(&node)) {
         return std::to_string(intLit->value);
-    } else if (auto* strLit = dynamic_cast<const StrLiteral*>(&node)) {
+    } else if (auto* strLit = node_cast<const StrLiteral>(&node)) {
         return "\"" + strLit->value + "\"";
-    } else if (auto* boolLit = dynamic_cast<const BoolLiteral*>(&node)) {
+    } else if (auto* boolLit = node_cast<const BoolLiteral>(&node)) {
         return boolLit->value ? "true" : "false";
-    } else if (auto* floatLit = dynamic_cast<const FloatLiteral*>(&node)) {
+    } else if (auto* floatLit = node_cast<const FloatLiteral>(&node)) {
         return std::to_string(floatLit->value);
-    } else if (auto* charLit = dynamic_cast<const CharLiteral*>(&node)) {
+    } else if (auto* charLit = node_cast<const CharLiteral>(&node)) {
         return "'" + std::string(1, charLit->value) + "'";
-    } else if (auto* varRef = dynamic_cast<const VarRefNode*>(&node)) {
-        return varRef->name;
-    } else if (auto* assign = dynamic_cast<const AssignNode*>(&node)) {
-        return assign->name + " = " + printNode(*assign->value);
-    } else if (auto* binary = dynamic_cast<const BinaryOpNode*>(&node)) {
+    } else if (auto* varRef = node_cast<const VarRefNode>(&node)) {
+        return symbolName(varRef->symbol);
+    } else if (auto* assign = node_cast<const AssignNode>(&node)) {
+        return symbolName(assign->symbol) + " = " + printNode(*assign->value);
+    } else if (auto* binary = node_cast<const BinaryOpNode>(&node)) {
         std::string opStr;
         switch (binary->op) {
             case BinaryOp::ADD: opStr = "+"; break;
@@ -167,7 +159,7 @@ std::string Optimizer::printNode(const ASTNode& node) const {
             default: opStr = "?"; break;
         }
         return printNode(*binary->left) + " " + opStr + " " + (binary->right ? printNode(*binary->right) : "");
-    } else if (auto* varDecl = dynamic_cast<const VarDeclNode*>(&node)) {
+    } else if (auto* varDecl = node_cast<const VarDeclNode>(&node)) {
         std::string typeStr;
         switch (varDecl->type) {
             case VarType::INT: typeStr = "int"; break;
@@ -178,8 +170,8 @@ std::string Optimizer::printNode(const ASTNode& node) const {
             case VarType::ARRAY: typeStr = "array"; break;
             default: typeStr = "unknown"; break;
         }
-        return typeStr + " " + varDecl->name + " = " + (varDecl->value ? printNode(*varDecl->value) : "");
-    } else if (auto* ternary = dynamic_cast<const TernaryExprNode*>(&node)) {
+        return typeStr + " " + symbolName(varDecl->symbol) + " = " + (varDecl->value ? printNode(*varDecl->value) : "");
+    } else if (auto* ternary = node_cast<const TernaryExprNode>(&node)) {
         return printNode(*ternary->condition) + " ? " + printNode(*ternary->trueBranch) + " : " + printNode(*ternary->falseBranch);
     }
     return "[unknown]";
@@ -195,268 +187,1115 @@ void Optimizer::printModifiedNodes() const {
     }
 }
 
-std::unique_ptr<ASTNode> Optimizer::unrollForLoop(LoopNode& loop) {
-    auto bounds = getLoopBounds(loop);
-    if (!bounds) {
-        return nullptr;
+void Optimizer::printUnrollReport(std::ostream& out) const {
+    for (const auto& decision : unrollReport) {
+        out << "for " << symbolName(decision.variable) << ": ";
+        if (decision.trips < 0) {
+            out << "unknown trip count";
+        } else {
+            out << decision.trips << " trips";
+        }
+        out << " x " << decision.bodySize << " nodes: ";
+        switch (decision.kind) {
+            case UnrollDecision::Full:
+                out << "fully unrolled";
+                break;
+            case UnrollDecision::Partial:
+                out << "unrolled by " << decision.factor << ", " << decision.trips % decision.factor << " left over";
+                break;
+            case UnrollDecision::Kept:
+                out << "kept, " << decision.reason;
+                break;
+        }
+        out << "\n";
     }
+}
 
-    auto [start, end, step] = *bounds;
-    auto* cond = dynamic_cast<BinaryOpNode*>(loop.condition.get());
-    if (!cond) {
-        return nullptr;
-    }
-    int iterations = computeIterations(start, end, step, cond->op);
-    if (iterations < 0) {
-        return nullptr;
+static size_t countNodes(ASTNode& node) {
+    size_t count = 1;
+    forEachChild(node, [&](auto& child) { count += countNodes(*child); });
+    return count;
+}
+
+static bool writesVariable(ASTNode& node, SlotId slot) {
+    if (auto* assign = node_cast<AssignNode>(&node)) {
+        if (assign->slot == slot) return true;
+    } else if (auto* compound = node_cast<CompoundAssignNode>(&node)) {
+        if (compound->slot == slot) return true;
+    } else if (auto* unary = node_cast<UnaryOpNode>(&node)) {
+        auto* operand = node_cast<VarRefNode>(unary->operand.get());
+        if (operand && operand->slot == slot && (unary->op == UnaryOp::INCREMENT || unary->op == UnaryOp::DECREMENT)) {
+            return true;
+        }
     }
+    bool writes = false;
+    forEachChild(node, [&](auto& child) { writes = writes || writesVariable(*child, slot); });
+    return writes;
+}
 
-    std::string loopVar = getLoopVariable(loop);
-    if (loopVar.empty()) {
-        return nullptr;
+static SlotId loopSlot(const LoopNode& loop) {
+    if (auto* varDecl = node_cast<VarDeclNode>(loop.init.get())) {
+        return varDecl->slot;
+    } else if (auto* assign = node_cast<AssignNode>(loop.init.get())) {
+        return assign->slot;
     }
+    return NoSlot;
+}
 
-    auto* body = dynamic_cast<BlockNode*>(loop.body.get());
-    if (!body) {
+// Cost model: a loop is fully unrolled when all its copies together stay
+// within FullUnrollBudget nodes. Otherwise the body is repeated as many
+// times (a power of two up to MaxUnrollFactor) as fits PartialUnrollBudget,
+// and the iterations that do not fill a whole group run as straight-line
+// copies after the loop. Every loop considered gets an entry in unrollReport.
+NodePtr<ASTNode> Optimizer::unrollForLoop(LoopNode& loop) {
+    UnrollDecision decision;
+    decision.variable = getLoopVariable(loop);
+    auto* body = node_cast<BlockNode>(loop.body.get());
+    decision.bodySize = body ? countNodes(*body) : 0;
+    auto keep = [&](const char* reason) -> NodePtr<ASTNode> {
+        decision.reason = reason;
+        unrollReport.push_back(decision);
         return nullptr;
+    };
+
+    auto bounds = getLoopBounds(loop);
+    if (!bounds || !body) {
+        return keep("bounds or step not constant");
+    }
+    auto [start, end, step] = *bounds;
+    decision.trips = computeIterations(start, end, step, static_cast<BinaryOpNode&>(*loop.condition).op);
+    if (decision.trips < 0) {
+        return keep("not a finite counted loop");
+    }
+    SlotId slot = loopSlot(loop);
+    if (writesVariable(*body, slot)) {
+        return keep("body writes the loop variable");
     }
-    auto unrolled = std::make_unique<BlockNode>();
-    for (int j = 0; j < iterations; ++j) {
-        int value = (step > 0) ? start + j * step : start - j * (-step);
-        for (const auto& stmt : body->statements) {
-            auto clonedStmt = cloneNode(*stmt);
-            substituteVariable(*clonedStmt, loopVar, value);
-            unrolled->statements.push_back(std::move(clonedStmt));
+
+    long long cost = std::max<long long>(decision.bodySize, 1);
+    if (decision.trips * cost <= FullUnrollBudget) {
+        decision.kind = UnrollDecision::Full;
+        unrollReport.push_back(decision);
+        auto unrolled = arena->make<BlockNode>();
+        for (long long j = 0; j < decision.trips; ++j) {
+            appendBodyCopy(*unrolled, *body, slot, literalValue(int(start + j * step)));
+        }
+        if (auto store = storeExitValue(loop, int(start + decision.trips * step))) {
+            unrolled->statements.push_back(std::move(store));
         }
+        return unrolled;
+    }
+
+    int factor = MaxUnrollFactor;
+    while (factor > 1 && (factor * cost > PartialUnrollBudget || factor > decision.trips)) {
+        factor /= 2;
+    }
+    if (factor < 2) {
+        return keep("body too large to unroll");
+    }
+    decision.kind = UnrollDecision::Partial;
+    decision.factor = factor;
+    unrollReport.push_back(decision);
+    return partiallyUnroll(loop, start, step, decision.trips, factor);
+}
+
+// for (v = start; v < mainEnd; v += factor * step) { body[v]; body[v + step]; ... }
+// followed by the leftover iterations with v known.
+NodePtr<ASTNode> Optimizer::partiallyUnroll(LoopNode& loop, int start, int step, long long trips, int factor) {
+    auto& body = static_cast<BlockNode&>(*loop.body);
+    SymbolId symbol = getLoopVariable(loop);
+    SlotId slot = loopSlot(loop);
+    long long mainTrips = trips - trips % factor;
+    int exitValue = int(start + trips * step);
+    auto varRef = [&] {
+        auto ref = arena->make<VarRefNode>(symbol);
+        ref->slot = slot;
+        ref->valueType = VarType::INT;
+        return ref;
+    };
+
+    auto mainBody = arena->make<BlockNode>();
+    for (int k = 0; k < factor; ++k) {
+        int offset = k * step;
+        appendBodyCopy(*mainBody, body, slot, [&]() -> NodePtr<ASTNode> {
+            if (offset == 0) {
+                return varRef();
+            }
+            NodePtr<ASTNode> sum = arena->make<BinaryOpNode>(BinaryOp::ADD, varRef(), arena->make<IntLiteral>(offset));
+            sum->valueType = VarType::INT;
+            return sum;
+        });
+    }
+    NodePtr<ASTNode> condition = arena->make<BinaryOpNode>(step > 0 ? BinaryOp::LESS : BinaryOp::GREATER, varRef(),
+                                                           arena->make<IntLiteral>(int(start + mainTrips * step)));
+    condition->valueType = VarType::BOOL;
+    auto update = arena->make<CompoundAssignNode>(symbol, BinaryOp::ADD, arena->make<IntLiteral>(factor * step));
+    update->slot = slot;
+
+    NodePtr<ASTNode> store = storeExitValue(loop, exitValue);
+    auto unrolled = arena->make<BlockNode>();
+    unrolled->statements.push_back(
+        arena->make<LoopNode>(std::move(loop.init), std::move(condition), std::move(update), std::move(mainBody)));
+    for (long long j = mainTrips; j < trips; ++j) {
+        appendBodyCopy(*unrolled, body, slot, literalValue(int(start + j * step)));
+    }
+    if (store) {
+        unrolled->statements.push_back(std::move(store));
     }
     return unrolled;
 }
 
-std::optional<std::tuple<int, int, int>> Optimizer::getLoopBounds(const LoopNode& loop) {
-    int start = 0;
-    std::string varName;
-    if (auto* varDecl = dynamic_cast<VarDeclNode*>(loop.init.get())) {
-        if (auto* initLit = dynamic_cast<IntLiteral*>(varDecl->value.get())) {
-            start = initLit->value;
-            varName = varDecl->name;
-        } else {
-            return std::nullopt;
-        }
-    } else if (auto* assign = dynamic_cast<AssignNode*>(loop.init.get())) {
-        if (auto* initLit = dynamic_cast<IntLiteral*>(assign->value.get())) {
-            start = initLit->value;
-            varName = assign->name;
-        } else {
-            return std::nullopt;
+std::function<NodePtr<ASTNode>()> Optimizer::literalValue(int value) {
+    return [this, value]() -> NodePtr<ASTNode> { return arena->make<IntLiteral>(value); };
+}
+
+void Optimizer::appendBodyCopy(BlockNode& out, const BlockNode& body, SlotId slot,
+                               const std::function<NodePtr<ASTNode>()>& value) {
+    for (const auto& stmt : body.statements) {
+        if (!stmt) {
+            continue;
         }
-    } else {
+        auto copy = cloneNode(*stmt);
+        substituteVariable(*copy, slot, value);
+        out.statements.push_back(std::move(copy));
+    }
+}
+
+// A loop over an existing variable leaves it at the value that ended the
+// loop; the unrolled form has to store that value itself. Null when the
+// loop declares its variable.
+NodePtr<ASTNode> Optimizer::storeExitValue(const LoopNode& loop, int exitValue) {
+    auto* assign = node_cast<AssignNode>(loop.init.get());
+    if (!assign) {
+        return nullptr;
+    }
+    auto store = arena->make<AssignNode>(assign->symbol, arena->make<IntLiteral>(exitValue));
+    store->slot = assign->slot;
+    return store;
+}
+
+// Bounds of a counted loop: `v = start; v <op> end; v++` (or v--, v += c,
+// v -= c) with int literals for start, end and c.
+std::optional<std::tuple<int, int, int>> Optimizer::getLoopBounds(const LoopNode& loop) {
+    SymbolId varName = getLoopVariable(loop);
+    const ASTNode* initValue = nullptr;
+    if (auto* varDecl = node_cast<VarDeclNode>(loop.init.get())) {
+        initValue = varDecl->value.get();
+    } else if (auto* assign = node_cast<AssignNode>(loop.init.get())) {
+        initValue = assign->value.get();
+    }
+    auto* initLit = initValue ? node_cast<const IntLiteral>(initValue) : nullptr;
+    if (!initLit) {
         return std::nullopt;
     }
+    int start = initLit->value;
 
-    int end = 0;
-    auto* cond = dynamic_cast<BinaryOpNode*>(loop.condition.get());
+    auto* cond = node_cast<BinaryOpNode>(loop.condition.get());
     if (!cond || !(cond->op == BinaryOp::LESS || cond->op == BinaryOp::LESS_EQUAL ||
                    cond->op == BinaryOp::GREATER || cond->op == BinaryOp::GREATER_EQUAL)) {
         return std::nullopt;
     }
-    if (auto* leftVar = dynamic_cast<VarRefNode*>(cond->left.get())) {
-        if (leftVar->name != varName) {
+    auto* leftVar = node_cast<VarRefNode>(cond->left.get());
+    auto* rightLit = node_cast<IntLiteral>(cond->right.get());
+    if (!leftVar || leftVar->symbol != varName || !rightLit) {
+        return std::nullopt;
+    }
+    int end = rightLit->value;
+
+    int step = 0;
+    if (auto* unary = node_cast<UnaryOpNode>(loop.update.get())) {
+        auto* operand = node_cast<VarRefNode>(unary->operand.get());
+        if (!operand || operand->symbol != varName) {
             return std::nullopt;
         }
-        if (auto* rightLit = dynamic_cast<IntLiteral*>(cond->right.get())) {
-            end = rightLit->value;
-        } else {
+        step = unary->op == UnaryOp::INCREMENT ? 1 : unary->op == UnaryOp::DECREMENT ? -1 : 0;
+    } else if (auto* compound = node_cast<CompoundAssignNode>(loop.update.get())) {
+        auto* stepLit = node_cast<IntLiteral>(compound->value.get());
+        if (compound->symbol != varName || !stepLit || stepLit->value == INT_MIN) {
             return std::nullopt;
         }
-    } else {
+        if (compound->op == BinaryOp::ADD) {
+            step = stepLit->value;
+        } else if (compound->op == BinaryOp::SUBTRACT) {
+            step = -stepLit->value;
+        }
+    }
+    if (step == 0) {
         return std::nullopt;
     }
+    return std::make_tuple(start, end, step);
+}
 
-    int step = 0;
-    if (auto* unary = dynamic_cast<UnaryOpNode*>(loop.update.get())) {
-        if (unary->op == UnaryOp::INCREMENT && dynamic_cast<VarRefNode*>(unary->operand.get())->name == varName) {
-            step = 1;
-        } else if (unary->op == UnaryOp::DECREMENT && dynamic_cast<VarRefNode*>(unary->operand.get())->name == varName) {
-            step = -1;
+// How many times the body runs, or -1 when the loop counts away from its
+// bound or would wrap around before reaching it.
+long long Optimizer::computeIterations(int start, int end, int step, BinaryOp op) {
+    long long span = 0;
+    if (step > 0 && (op == BinaryOp::LESS || op == BinaryOp::LESS_EQUAL)) {
+        span = (long long)end - start + (op == BinaryOp::LESS_EQUAL);
+    } else if (step < 0 && (op == BinaryOp::GREATER || op == BinaryOp::GREATER_EQUAL)) {
+        span = (long long)start - end + (op == BinaryOp::GREATER_EQUAL);
+    } else {
+        return -1;
+    }
+    long long stride = step > 0 ? step : -(long long)step;
+    long long trips = span > 0 ? (span + stride - 1) / stride : 0;
+    long long exitValue = start + trips * step;
+    if (exitValue < INT_MIN || exitValue > INT_MAX) {
+        return -1;
+    }
+    return trips;
+}
+
+SymbolId Optimizer::getLoopVariable(const LoopNode& loop) {
+    if (auto* varDecl = node_cast<VarDeclNode>(loop.init.get())) {
+        return varDecl->symbol;
+    } else if (auto* assign = node_cast<AssignNode>(loop.init.get())) {
+        return assign->symbol;
+    }
+    return NoSymbol;
+}
+
+// Loop-invariant code motion. CodeGen lowers min, max, length, pow,
+// concatenation and the array ops to a loop or a malloc of their own; when
+// nothing such an expression reads changes inside a loop, it is computed
+// once into a temporary declared just before the loop. Loops are visited
+// outermost first, so an expression invariant in a whole nest leaves all
+// of it.
+void Optimizer::hoistLoops(NodePtr<ASTNode>& stmt) {
+    ASTNode& node = *stmt;
+    if (node.kind == NodeKind::Loop) {
+        hoistInvariants(stmt); // may wrap the loop in a block; node stays the loop
+    }
+    hoistLoopsBelow(node);
+}
+
+void Optimizer::hoistLoopsBelow(ASTNode& node) {
+    forEachChild(node, [&](auto& child) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(child)>, NodePtr<ASTNode>>) {
+            hoistLoops(child);
         } else {
-            return std::nullopt;
-        }
-    } else if (auto* assign = dynamic_cast<AssignNode*>(loop.update.get())) {
-        if (assign->name != varName) {
-            return std::nullopt;
+            hoistLoopsBelow(*child);
         }
-        if (auto* binOp = dynamic_cast<BinaryOpNode*>(assign->value.get())) {
-            if (binOp->op == BinaryOp::ADD && dynamic_cast<VarRefNode*>(binOp->left.get())->name == varName) {
-                if (auto* stepLit = dynamic_cast<IntLiteral*>(binOp->right.get())) {
-                    step = stepLit->value;
-                }
-            } else if (binOp->op == BinaryOp::SUBTRACT && dynamic_cast<VarRefNode*>(binOp->left.get())->name == varName) {
-                if (auto* stepLit = dynamic_cast<IntLiteral*>(binOp->right.get())) {
-                    step = -stepLit->value;
+    });
+}
+
+void Optimizer::hoistInvariants(NodePtr<ASTNode>& stmt) {
+    auto& loop = static_cast<LoopNode&>(*stmt);
+    LoopEffects effects;
+    effects.written.assign(program->slotCount, false);
+    collectEffects(loop, effects);
+
+    std::vector<NodePtr<ASTNode>> preheader;
+    if (loop.condition) hoistFrom(loop.condition, false, effects, preheader);
+    if (loop.update) hoistFrom(loop.update, false, effects, preheader);
+    hoistFrom(loop.body, false, effects, preheader);
+    if (preheader.empty()) {
+        return;
+    }
+    // The block scopes the temporaries, so any buffers they hold are freed
+    // as soon as the loop is done.
+    auto block = arena->make<BlockNode>();
+    block->statements = std::move(preheader);
+    block->statements.push_back(std::move(stmt));
+    stmt = std::move(block);
+}
+
+void Optimizer::noteExclusiveBuffers(ASTNode& node) {
+    if (auto* decl = node_cast<VarDeclNode>(&node)) {
+        exclusiveBuffers[decl->slot] = decl->ownsBuffer;
+    }
+    forEachChild(node, [&](auto& child) { noteExclusiveBuffers(*child); });
+}
+
+// Which variables node may change: every store, every declaration in it
+// (in a loop, a fresh variable each iteration), and loop and catch
+// variables. An increment of an array element changes only that array when
+// its variable owns the buffer; otherwise it may change any array sharing
+// the buffer, reported as NoSlot.
+template <typename F>
+void Optimizer::forEachWrite(ASTNode& node, F&& onWrite) {
+    switch (node.kind) {
+        case NodeKind::VarDecl: onWrite(static_cast<VarDeclNode&>(node).slot); break;
+        case NodeKind::Assign: onWrite(static_cast<AssignNode&>(node).slot); break;
+        case NodeKind::CompoundAssign: onWrite(static_cast<CompoundAssignNode&>(node).slot); break;
+        case NodeKind::UnaryOp: {
+            auto& unary = static_cast<UnaryOpNode&>(node);
+            if (unary.op == UnaryOp::INCREMENT || unary.op == UnaryOp::DECREMENT) {
+                auto* element = node_cast<BinaryOpNode>(unary.operand.get());
+                auto* array = element ? node_cast<VarRefNode>(element->left.get()) : nullptr;
+                if (auto* varRef = node_cast<VarRefNode>(unary.operand.get())) {
+                    onWrite(varRef->slot);
+                } else if (array && array->slot < exclusiveBuffers.size() && exclusiveBuffers[array->slot]) {
+                    onWrite(array->slot);
+                } else {
+                    onWrite(NoSlot);
                 }
             }
+            break;
         }
-    } else {
-        return std::nullopt;
+        case NodeKind::Loop: {
+            auto& loop = static_cast<LoopNode&>(node);
+            if (loop.varSlot != NoSlot) onWrite(loop.varSlot);
+            break;
+        }
+        case NodeKind::TryCatch: {
+            auto& tryCatch = static_cast<TryCatchNode&>(node);
+            if (tryCatch.errorSlot != NoSlot) onWrite(tryCatch.errorSlot);
+            break;
+        }
+        default:
+            break;
     }
+    forEachChild(node, [&](auto& child) { forEachWrite(*child, onWrite); });
+}
 
-    return std::make_tuple(start, end, step);
+void Optimizer::collectEffects(ASTNode& node, LoopEffects& effects) {
+    forEachWrite(node, [&](SlotId slot) {
+        if (slot == NoSlot) {
+            effects.writesElements = true;
+        } else {
+            effects.written[slot] = true;
+        }
+    });
+}
+
+static bool isExpensive(const ASTNode& node) {
+    if (auto* unary = node_cast<const UnaryOpNode>(&node)) {
+        return unary->op == UnaryOp::MIN || unary->op == UnaryOp::MAX || unary->op == UnaryOp::LENGTH;
+    }
+    if (auto* binary = node_cast<const BinaryOpNode>(&node)) {
+        return binary->op == BinaryOp::POW || binary->valueType.isArray();
+    }
+    return node.kind == NodeKind::Concat;
+}
+
+// Whether two expressions are built the same way from the same variables
+// and literals, and so evaluate to the same value at the same point.
+static bool sameExpression(ASTNode& a, ASTNode& b) {
+    if (a.kind != b.kind) {
+        return false;
+    }
+    switch (a.kind) {
+        case NodeKind::VarRef:
+            if (static_cast<VarRefNode&>(a).slot != static_cast<VarRefNode&>(b).slot) return false;
+            break;
+        case NodeKind::IntLiteral:
+            if (static_cast<IntLiteral&>(a).value != static_cast<IntLiteral&>(b).value) return false;
+            break;
+        case NodeKind::FloatLiteral:
+            if (static_cast<FloatLiteral&>(a).value != static_cast<FloatLiteral&>(b).value) return false;
+            break;
+        case NodeKind::BoolLiteral:
+            if (static_cast<BoolLiteral&>(a).value != static_cast<BoolLiteral&>(b).value) return false;
+            break;
+        case NodeKind::CharLiteral:
+            if (static_cast<CharLiteral&>(a).value != static_cast<CharLiteral&>(b).value) return false;
+            break;
+        case NodeKind::StrLiteral:
+            if (static_cast<StrLiteral&>(a).value != static_cast<StrLiteral&>(b).value) return false;
+            break;
+        case NodeKind::BinaryOp:
+            if (static_cast<BinaryOpNode&>(a).op != static_cast<BinaryOpNode&>(b).op) return false;
+            break;
+        case NodeKind::UnaryOp:
+            if (static_cast<UnaryOpNode&>(a).op != static_cast<UnaryOpNode&>(b).op) return false;
+            break;
+        case NodeKind::Concat:
+        case NodeKind::ArrayLiteral:
+        case NodeKind::Ternary:
+            break;
+        default:
+            return false; // statements
+    }
+    std::vector<ASTNode*> left, right;
+    forEachChild(a, [&](auto& child) { left.push_back(child.get()); });
+    forEachChild(b, [&](auto& child) { right.push_back(child.get()); });
+    if (left.size() != right.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < left.size(); ++i) {
+        if (!sameExpression(*left[i], *right[i])) return false;
+    }
+    return true;
+}
+
+static bool isInvariant(ASTNode& node, const Optimizer::LoopEffects& effects) {
+    if (auto* varRef = node_cast<VarRefNode>(&node)) {
+        return !effects.written[varRef->slot] && !(effects.writesElements && varRef->valueType.isArray());
+    }
+    bool invariant = true;
+    forEachChild(node, [&](auto& child) { invariant = invariant && isInvariant(*child, effects); });
+    return invariant;
+}
+
+// Hoists the largest invariant expensive expressions under node, one
+// temporary per distinct expression. A fresh buffer stored straight into a
+// variable stays put: the variable may own it, or change its elements, so
+// every iteration needs its own.
+void Optimizer::hoistFrom(NodePtr<ASTNode>& expr, bool stored, const LoopEffects& effects,
+                          std::vector<NodePtr<ASTNode>>& preheader) {
+    const ValueType& type = expr->valueType;
+    bool heapValue = type.isArray() || type.kind == VarType::STRING;
+    if (isExpensive(*expr) && !(stored && heapValue) && isInvariant(*expr, effects) && !hasSideEffects(*expr)) {
+        for (auto& earlier : preheader) {
+            auto& decl = static_cast<VarDeclNode&>(*earlier);
+            if (sameExpression(*decl.value, *expr)) {
+                expr = readTemporary(decl);
+                return;
+            }
+        }
+        preheader.push_back(makeTemporary(expr, "hoisted"));
+        return;
+    }
+    hoistFromChildren(*expr, stored, effects, preheader);
 }
 
-int Optimizer::computeIterations(int start, int end, int step, BinaryOp op) {
-    if (step == 0) return 0;
-    if (step > 0) {
-        if (op == BinaryOp::LESS) {
-            return (end - start) / step;
-        } else if (op == BinaryOp::LESS_EQUAL) {
-            return (end - start + step) / step;
+void Optimizer::hoistFromChildren(ASTNode& node, bool stored, const LoopEffects& effects,
+                                  std::vector<NodePtr<ASTNode>>& preheader) {
+    // What a declaration or assignment stores, or either branch of a
+    // ternary that is itself stored.
+    bool storesChild = node.kind == NodeKind::VarDecl || node.kind == NodeKind::Assign ||
+                       (node.kind == NodeKind::Ternary && stored);
+    forEachChild(node, [&](auto& child) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(child)>, NodePtr<ASTNode>>) {
+            hoistFrom(child, storesChild, effects, preheader);
+        } else {
+            hoistFromChildren(*child, false, effects, preheader);
         }
-    } else if (step < 0) {
-        if (op == BinaryOp::GREATER) {
-            return (start - end) / (-step);
-        } else if (op == BinaryOp::GREATER_EQUAL) {
-            return (start - end - step) / (-step);
+    });
+}
+
+// Strength reduction. Arithmetic with an identity operand is dropped,
+// float division by a power of two becomes an exact multiplication, and an
+// induction expression i * k in a loop becomes a variable that is added to
+// on every iteration. Multiplication, division and modulo of an int by a
+// power of two are left to CodeGen, which emits them as shifts. Bottom-up,
+// so an inner loop is rewritten before the loop around it.
+void Optimizer::reduceStrength(NodePtr<ASTNode>& node) {
+    reduceStrengthBelow(*node);
+    if (auto* binary = node_cast<BinaryOpNode>(node.get())) {
+        if (NodePtr<ASTNode> simpler = simplifyArithmetic(*binary)) {
+            node = std::move(simpler);
         }
+    } else if (node->kind == NodeKind::Loop) {
+        reduceInductions(node);
     }
-    return 0;
 }
 
-std::string Optimizer::getLoopVariable(const LoopNode& loop) {
-    if (auto* varDecl = dynamic_cast<VarDeclNode*>(loop.init.get())) {
-        return varDecl->name;
-    } else if (auto* assign = dynamic_cast<AssignNode*>(loop.init.get())) {
-        return assign->name;
+void Optimizer::reduceStrengthBelow(ASTNode& node) {
+    forEachChild(node, [&](auto& child) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(child)>, NodePtr<ASTNode>>) {
+            reduceStrength(child);
+        } else {
+            reduceStrengthBelow(*child);
+        }
+    });
+}
+
+// Whether node is the literal value; an int literal counts where a float
+// is expected, as CodeGen promotes it.
+static bool isLiteral(const ASTNode& node, int value) {
+    if (auto* intLit = node_cast<const IntLiteral>(&node)) return intLit->value == value;
+    if (auto* floatLit = node_cast<const FloatLiteral>(&node)) return floatLit->value == float(value);
+    return false;
+}
+
+// The simpler expression binary reduces to, or null. Only rewrites that
+// give the same result for every operand value: for floats, -0.0 + 0 is
+// +0.0 and NaN * 0 is NaN, so dropping + 0 or an operand multiplied by zero
+// is for ints only. An operand that is dropped must not have effects, and
+// one that stands in for the whole expression must already have its type.
+NodePtr<ASTNode> Optimizer::simplifyArithmetic(BinaryOpNode& binary) {
+    VarType type = binary.valueType.kind;
+    if (!binary.right || (type != VarType::INT && type != VarType::FLOAT)) {
+        return nullptr;
+    }
+    bool isInt = type == VarType::INT;
+    auto keep = [&](NodePtr<ASTNode>& operand) -> NodePtr<ASTNode> {
+        return operand->valueType.kind == type ? std::move(operand) : nullptr;
+    };
+    auto negate = [&](NodePtr<ASTNode>& operand) -> NodePtr<ASTNode> {
+        if (operand->valueType.kind != type) {
+            return nullptr;
+        }
+        auto negated = arena->make<UnaryOpNode>(UnaryOp::NEGATE, std::move(operand));
+        negated->valueType = binary.valueType;
+        return negated;
+    };
+    auto zero = [&](NodePtr<ASTNode>& dropped) -> NodePtr<ASTNode> {
+        if (hasSideEffects(*dropped)) {
+            return nullptr;
+        }
+        auto literal = arena->make<IntLiteral>(0);
+        literal->valueType = binary.valueType;
+        return literal;
+    };
+    NodePtr<ASTNode>& left = binary.left;
+    NodePtr<ASTNode>& right = binary.right;
+    switch (binary.op) {
+        case BinaryOp::ADD:
+            if (isInt && isLiteral(*right, 0)) return keep(left);
+            if (isInt && isLiteral(*left, 0)) return keep(right);
+            break;
+        case BinaryOp::SUBTRACT:
+            if (isLiteral(*right, 0)) return keep(left);
+            break;
+        case BinaryOp::MULTIPLY:
+            if (isLiteral(*right, 1)) return keep(left);
+            if (isLiteral(*left, 1)) return keep(right);
+            if (isLiteral(*right, -1)) return negate(left);
+            if (isLiteral(*left, -1)) return negate(right);
+            if (isInt && isLiteral(*right, 0)) return zero(left);
+            if (isInt && isLiteral(*left, 0)) return zero(right);
+            break;
+        case BinaryOp::DIVIDE:
+            if (isLiteral(*right, 1)) return keep(left);
+            if (!isInt) {
+                // 1 / 2^k is exact, so multiplying by it rounds the same way
+                auto* divisor = node_cast<FloatLiteral>(right.get());
+                int exponent = 0;
+                if (divisor && std::isfinite(divisor->value) && std::frexp(divisor->value, &exponent) == 0.5f &&
+                    std::isnormal(1.0f / divisor->value)) {
+                    auto reciprocal = arena->make<FloatLiteral>(1.0f / divisor->value);
+                    reciprocal->valueType = right->valueType;
+                    binary.op = BinaryOp::MULTIPLY;
+                    right = std::move(reciprocal);
+                }
+            }
+            break;
+        case BinaryOp::MODULO:
+            if (isInt && isLiteral(*right, 1)) return zero(left);
+            break;
+        default:
+            break;
     }
-    return "";
+    return nullptr;
 }
 
-std::unique_ptr<ASTNode> Optimizer::cloneNode(const ASTNode& node) {
-    if (auto* block = dynamic_cast<const BlockNode*>(&node)) {
-        auto newBlock = std::make_unique<BlockNode>();
-        for (const auto& stmt : block->statements) {
-            newBlock->statements.push_back(cloneNode(*stmt));
+// The constant the loop's update adds to its variable each iteration, or
+// nothing.
+static std::optional<int32_t> loopStep(const LoopNode& loop, SlotId slot) {
+    if (auto* unary = node_cast<UnaryOpNode>(loop.update.get())) {
+        auto* operand = node_cast<VarRefNode>(unary->operand.get());
+        if (operand && operand->slot == slot) {
+            if (unary->op == UnaryOp::INCREMENT) return 1;
+            if (unary->op == UnaryOp::DECREMENT) return -1;
         }
-        return newBlock;
-    } else if (auto* loop = dynamic_cast<const LoopNode*>(&node)) {
-        if (loop->type == LoopType::For) {
-            return std::make_unique<LoopNode>(
-                cloneNode(*loop->init), cloneNode(*loop->condition),
-                cloneNode(*loop->update), cloneNode(*loop->body));
+    } else if (auto* compound = node_cast<CompoundAssignNode>(loop.update.get())) {
+        auto* stepLit = node_cast<IntLiteral>(compound->value.get());
+        if (compound->slot == slot && stepLit) {
+            if (compound->op == BinaryOp::ADD) return stepLit->value;
+            if (compound->op == BinaryOp::SUBTRACT) return int32_t(0u - uint32_t(stepLit->value));
         }
+    }
+    return std::nullopt;
+}
+
+// The other factor when expr is an int product of the loop variable and a
+// literal or a variable the loop leaves alone, or null.
+static ASTNode* inductionFactor(ASTNode& expr, SlotId slot, const Optimizer::LoopEffects& effects) {
+    auto* product = node_cast<BinaryOpNode>(&expr);
+    if (!product || product->op != BinaryOp::MULTIPLY || product->valueType.kind != VarType::INT) {
         return nullptr;
-    } else if (auto* print = dynamic_cast<const PrintNode*>(&node)) {
-        return std::make_unique<PrintNode>(cloneNode(*print->expr));
-    } else if (auto* varRef = dynamic_cast<const VarRefNode*>(&node)) {
-        return std::make_unique<VarRefNode>(varRef->name);
-    } else if (auto* intLit = dynamic_cast<const IntLiteral*>(&node)) {
-        return std::make_unique<IntLiteral>(intLit->value);
-    } else if (auto* strLit = dynamic_cast<const StrLiteral*>(&node)) {
-        return std::make_unique<StrLiteral>(strLit->value);
-    } else if (auto* boolLit = dynamic_cast<const BoolLiteral*>(&node)) {
-        return std::make_unique<BoolLiteral>(boolLit->value);
-    } else if (auto* floatLit = dynamic_cast<const FloatLiteral*>(&node)) {
-        return std::make_unique<FloatLiteral>(floatLit->value);
-    } else if (auto* charLit = dynamic_cast<const CharLiteral*>(&node)) {
-        return std::make_unique<CharLiteral>(charLit->value);
-    } else if (auto* binary = dynamic_cast<const BinaryOpNode*>(&node)) {
-        return std::make_unique<BinaryOpNode>(binary->op, cloneNode(*binary->left),
-                                             binary->right ? cloneNode(*binary->right) : nullptr);
-    } else if (auto* unary = dynamic_cast<const UnaryOpNode*>(&node)) {
-        return std::make_unique<UnaryOpNode>(unary->op, cloneNode(*unary->operand));
-    } else if (auto* assign = dynamic_cast<const AssignNode*>(&node)) {
-        return std::make_unique<AssignNode>(assign->name, cloneNode(*assign->value));
-    } else if (auto* arrayLit = dynamic_cast<const ArrayLiteralNode*>(&node)) {
-        std::vector<std::unique_ptr<ASTNode>> elements;
-        for (const auto& elem : arrayLit->elements) {
-            elements.push_back(cloneNode(*elem));
-        }
-        return std::make_unique<ArrayLiteralNode>(std::move(elements));
-    } else if (auto* concat = dynamic_cast<const ConcatNode*>(&node)) {
-        return std::make_unique<ConcatNode>(cloneNode(*concat->left), cloneNode(*concat->right));
-    } else if (auto* varDecl = dynamic_cast<const VarDeclNode*>(&node)) {
-        return std::make_unique<VarDeclNode>(varDecl->type, varDecl->name,
-                                             varDecl->value ? cloneNode(*varDecl->value) : nullptr);
-    } else if (auto* ternary = dynamic_cast<const TernaryExprNode*>(&node)) {
-        return std::make_unique<TernaryExprNode>(cloneNode(*ternary->condition),
-                                                 cloneNode(*ternary->trueBranch), cloneNode(*ternary->falseBranch));
     }
+    auto isLoopVariable = [&](const ASTNode& node) {
+        auto* varRef = node_cast<const VarRefNode>(&node);
+        return varRef && varRef->slot == slot;
+    };
+    auto isFactor = [&](ASTNode& node) {
+        if (node.valueType.kind != VarType::INT) return false;
+        if (node.kind == NodeKind::IntLiteral) return true;
+        auto* varRef = node_cast<VarRefNode>(&node);
+        return varRef && varRef->slot != slot && !effects.written[varRef->slot];
+    };
+    if (isLoopVariable(*product->left) && isFactor(*product->right)) return product->right.get();
+    if (isLoopVariable(*product->right) && isFactor(*product->left)) return product->left.get();
     return nullptr;
 }
 
-void Optimizer::substituteVariable(ASTNode& node, const std::string& var, int value) {
-    if (auto* block = dynamic_cast<BlockNode*>(&node)) {
-        for (auto& stmt : block->statements) {
-            substituteVariable(*stmt, var, value);
+// In a for loop whose variable i starts at some value, steps by a constant
+// s and is not written in the body, i * k for an invariant k is kept in a
+// variable of its own: it starts at start * k and the end of the body adds
+// s * k, so it equals i * k wherever the body or the condition reads it.
+// Int arithmetic wraps, so this holds even when i * k overflows.
+void Optimizer::reduceInductions(NodePtr<ASTNode>& stmt) {
+    auto& loop = static_cast<LoopNode&>(*stmt);
+    auto* init = node_cast<VarDeclNode>(loop.init.get());
+    auto* body = node_cast<BlockNode>(loop.body.get());
+    if (loop.type != LoopType::For || !init || !init->value || init->valueType.kind != VarType::INT || !body ||
+        hasSideEffects(*init->value)) {
+        return;
+    }
+    std::optional<int32_t> step = loopStep(loop, init->slot);
+    if (!step) {
+        return;
+    }
+    LoopEffects effects;
+    effects.written.assign(program->slotCount, false);
+    collectEffects(*loop.body, effects);
+    if (effects.written[init->slot]) {
+        return;
+    }
+    if (loop.condition) collectEffects(*loop.condition, effects);
+    if (loop.update) collectEffects(*loop.update, effects);
+
+    // Every product by the same factor shares one variable.
+    struct Induction {
+        ASTNode* factor;
+        std::vector<NodePtr<ASTNode>*> sites;
+    };
+    std::vector<Induction> inductions;
+    std::function<void(ASTNode&)> findBelow;
+    auto find = [&](NodePtr<ASTNode>& expr) {
+        ASTNode* factor = inductionFactor(*expr, init->slot, effects);
+        if (!factor) {
+            findBelow(*expr);
+            return;
         }
-    } else if (auto* print = dynamic_cast<PrintNode*>(&node)) {
-        if (auto* exprVar = dynamic_cast<VarRefNode*>(print->expr.get())) {
-            if (exprVar->name == var) {
-                print->expr = std::make_unique<IntLiteral>(value);
+        for (auto& induction : inductions) {
+            if (sameExpression(*induction.factor, *factor)) {
+                induction.sites.push_back(&expr);
+                return;
             }
-        } else {
-            substituteVariable(*print->expr, var, value);
         }
-    } else if (auto* binary = dynamic_cast<BinaryOpNode*>(&node)) {
-        if (auto* leftVar = dynamic_cast<VarRefNode*>(binary->left.get())) {
-            if (leftVar->name == var) {
-                binary->left = std::make_unique<IntLiteral>(value);
+        inductions.push_back({factor, {&expr}});
+    };
+    findBelow = [&](ASTNode& node) {
+        forEachChild(node, [&](auto& child) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(child)>, NodePtr<ASTNode>>) {
+                find(child);
+            } else {
+                findBelow(*child);
             }
+        });
+    };
+    if (loop.condition) find(loop.condition);
+    find(loop.body);
+    if (inductions.empty()) {
+        return;
+    }
+
+    auto intLiteral = [&](int32_t value) {
+        auto literal = arena->make<IntLiteral>(value);
+        literal->valueType = VarType::INT;
+        return literal;
+    };
+    auto product = [&](NodePtr<ASTNode> a, NodePtr<ASTNode> b) -> NodePtr<ASTNode> {
+        auto* x = node_cast<IntLiteral>(a.get());
+        auto* y = node_cast<IntLiteral>(b.get());
+        if (x && y) {
+            return intLiteral(int32_t(uint32_t(x->value) * uint32_t(y->value)));
+        }
+        auto multiply = arena->make<BinaryOpNode>(BinaryOp::MULTIPLY, std::move(a), std::move(b));
+        multiply->valueType = VarType::INT;
+        return multiply;
+    };
+    std::vector<NodePtr<ASTNode>> preheader;
+    for (auto& induction : inductions) {
+        NodePtr<ASTNode> start = product(cloneNode(*init->value), cloneNode(*induction.factor));
+        auto decl = makeTemporary(start, "scaled");
+        NodePtr<ASTNode> stride = product(cloneNode(*induction.factor), intLiteral(*step));
+        if (stride->kind != NodeKind::IntLiteral) {
+            preheader.push_back(makeTemporary(stride, "stride"));
+        }
+        auto update = arena->make<CompoundAssignNode>(decl->symbol, BinaryOp::ADD, std::move(stride));
+        update->slot = decl->slot;
+        body->statements.push_back(std::move(update));
+        for (NodePtr<ASTNode>* site : induction.sites) {
+            *site = readTemporary(*decl);
+        }
+        preheader.push_back(std::move(decl));
+    }
+    auto block = arena->make<BlockNode>();
+    block->statements = std::move(preheader);
+    block->statements.push_back(std::move(stmt));
+    stmt = std::move(block);
+}
+
+// A new variable initialized with expr, which it takes over, leaving a read
+// of the variable in expr's place. A fresh buffer is the temporary's to
+// free: nothing else points at it, and it is only ever read.
+NodePtr<VarDeclNode> Optimizer::makeTemporary(NodePtr<ASTNode>& expr, const char* name) {
+    ValueType type = expr->valueType;
+    bool fresh = expr->kind == NodeKind::Concat || (expr->kind == NodeKind::BinaryOp && type.isArray());
+    auto decl = arena->make<VarDeclNode>(type.kind, globalInterner().intern(name), std::move(expr));
+    decl->elementType = type.isArray() ? type.element : VarType::NEUTRAL;
+    decl->valueType = type;
+    decl->slot = program->slotCount++;
+    decl->ownsBuffer = fresh;
+    expr = readTemporary(*decl);
+    return decl;
+}
+
+NodePtr<ASTNode> Optimizer::readTemporary(const VarDeclNode& decl) {
+    auto ref = arena->make<VarRefNode>(decl.symbol);
+    ref->slot = decl.slot;
+    ref->valueType = decl.valueType;
+    return ref;
+}
+
+// Common subexpression elimination. Within one statement list, equal
+// expressions get equal value numbers: children are numbered first, a read
+// of a variable by its slot and the writes to it so far, and anything that
+// reads an array also by the writes so far to buffers arrays may share. A
+// value computed more than once moves into a temporary declared before the
+// statement computing it first; the later computations read the temporary.
+// Nested blocks are numbered on their own, and count as writes of
+// everything they change.
+void Optimizer::eliminateCommonSubexpressions(ASTNode& node) {
+    forEachChild(node, [&](auto& child) { eliminateCommonSubexpressions(*child); });
+    if (auto* block = node_cast<BlockNode>(&node)) {
+        shareExpressions(block->statements);
+    }
+}
+
+bool Optimizer::ExprKey::operator==(const ExprKey& other) const {
+    return kind == other.kind && op == other.op && payload == other.payload &&
+           std::equal(std::begin(operands), std::end(operands), std::begin(other.operands));
+}
+
+size_t Optimizer::ExprKeyHash::operator()(const ExprKey& key) const {
+    size_t hash = std::hash<uint64_t>()(key.payload);
+    auto mix = [&](size_t value) { hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2); };
+    mix(size_t(key.kind));
+    mix(key.op);
+    for (uint32_t operand : key.operands) {
+        mix(operand);
+    }
+    return hash;
+}
+
+static void collectNodes(ASTNode& node, std::unordered_set<const ASTNode*>& into) {
+    into.insert(&node);
+    forEachChild(node, [&](auto& child) { collectNodes(*child, into); });
+}
+
+void Optimizer::shareExpressions(std::vector<NodePtr<ASTNode>>& statements) {
+    valueNumbers.clear();
+    stringNumbers.clear();
+    occurrences.clear();
+    slotVersions.resize(program->slotCount);
+    for (size_t i = 0; i < statements.size(); ++i) {
+        numberStatement(*statements[i], i);
+        noteWrites(*statements[i]);
+    }
+
+    // Largest first: once a value is shared, the computations replaced by a
+    // read no longer evaluate what was inside them.
+    std::vector<uint32_t> shared;
+    for (uint32_t value = 0; value < occurrences.size(); ++value) {
+        if (occurrences[value].size() > 1) shared.push_back(value);
+    }
+    if (shared.empty()) {
+        return;
+    }
+    std::stable_sort(shared.begin(), shared.end(), [&](uint32_t a, uint32_t b) {
+        return occurrences[a].front().size > occurrences[b].front().size;
+    });
+    std::unordered_set<const ASTNode*> replaced;
+    std::vector<std::vector<NodePtr<ASTNode>>> temporaries(statements.size());  // by statement they precede
+    for (uint32_t value : shared) {
+        auto& sites = occurrences[value];
+        sites.erase(std::remove_if(sites.begin(), sites.end(),
+                                   [&](const Occurrence& site) { return replaced.count(site.site->get()) != 0; }),
+                    sites.end());
+        if (sites.size() < 2) {
+            continue;
+        }
+        auto decl = makeTemporary(*sites.front().site, "common");
+        for (size_t i = 1; i < sites.size(); ++i) {
+            NodePtr<ASTNode>& site = *sites[i].site;
+            collectNodes(*site, replaced);
+            site = readTemporary(*decl);
+        }
+        // Values shared inside this one come later and have to be declared
+        // before it.
+        auto& before = temporaries[sites.front().statement];
+        before.insert(before.begin(), std::move(decl));
+    }
+    std::vector<NodePtr<ASTNode>> result;
+    for (size_t i = 0; i < statements.size(); ++i) {
+        for (auto& decl : temporaries[i]) {
+            result.push_back(std::move(decl));
+        }
+        result.push_back(std::move(statements[i]));
+    }
+    statements = std::move(result);
+}
+
+void Optimizer::noteWrites(ASTNode& node) {
+    forEachWrite(node, [&](SlotId slot) {
+        if (slot == NoSlot) {
+            ++memoryVersion;
         } else {
-            substituteVariable(*binary->left, var, value);
+            ++slotVersions[slot];
         }
-        if (binary->right) {
-            if (auto* rightVar = dynamic_cast<VarRefNode*>(binary->right.get())) {
-                if (rightVar->name == var) {
-                    binary->right = std::make_unique<IntLiteral>(value);
-                }
-            } else {
-                substituteVariable(*binary->right, var, value);
+    });
+}
+
+// Numbers what the statement computes before it writes anything: the value
+// stored or printed, or the condition of an if or match. Loop headers are
+// evaluated again on every iteration and stay out.
+void Optimizer::numberStatement(ASTNode& stmt, size_t index) {
+    auto number = [&](NodePtr<ASTNode>& value, bool stored) {
+        if (value && !hasSideEffects(*value)) valueNumber(value, index, stored);
+    };
+    switch (stmt.kind) {
+        case NodeKind::VarDecl: number(static_cast<VarDeclNode&>(stmt).value, true); break;
+        case NodeKind::MultiVarDecl:
+            // later declarations may read earlier ones
+            for (auto& decl : static_cast<MultiVarDeclNode&>(stmt).declarations) {
+                numberStatement(*decl, index);
+                noteWrites(*decl);
             }
+            break;
+        case NodeKind::Assign: number(static_cast<AssignNode&>(stmt).value, true); break;
+        case NodeKind::CompoundAssign: number(static_cast<CompoundAssignNode&>(stmt).value, false); break;
+        case NodeKind::Print: number(static_cast<PrintNode&>(stmt).expr, false); break;
+        case NodeKind::IfElse: number(static_cast<IfElseNode&>(stmt).condition, false); break;
+        case NodeKind::Match: number(static_cast<MatchNode&>(stmt).expression, false); break;
+        default: break;
+    }
+}
+
+uint32_t Optimizer::freshValue() {
+    occurrences.emplace_back();
+    return uint32_t(occurrences.size() - 1);
+}
+
+// Only values CodeGen can read back from a variable exactly where the
+// expression stood are shared: a bool or char temporary would not convert
+// where an int is expected. A buffer that gets stored keeps being built
+// where it is, as the variable or array storing it may come to own it.
+static bool isShareable(const ASTNode& node, bool stored) {
+    VarType type = node.valueType.kind;
+    bool heapValue = type == VarType::ARRAY || type == VarType::STRING;
+    return (type == VarType::INT || type == VarType::FLOAT || heapValue) && !(stored && heapValue);
+}
+
+Optimizer::Numbered Optimizer::valueNumber(NodePtr<ASTNode>& site, size_t statement, bool stored) {
+    ASTNode& node = *site;
+    ExprKey key{node.kind};
+    size_t size = 1, arity = 0;
+    bool readsArray = false;
+    // Array elements are stored, and so is either branch of a stored ternary.
+    bool storesChild = node.kind == NodeKind::ArrayLiteral || (node.kind == NodeKind::Ternary && stored);
+    forEachChild(node, [&](auto& child) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(child)>, NodePtr<ASTNode>>) {
+            Numbered operand = valueNumber(child, statement, storesChild);
+            if (arity < 3) key.operands[arity] = operand.value;
+            ++arity;
+            size += operand.size;
+            readsArray = readsArray || child->valueType.isArray();
+        }
+    });
+    switch (node.kind) {
+        case NodeKind::VarRef: {
+            SlotId slot = static_cast<VarRefNode&>(node).slot;
+            key.payload = uint64_t(slot) << 32 | slotVersions[slot];
+            return {lookupValue(key), size};
+        }
+        case NodeKind::IntLiteral:
+            key.payload = uint32_t(static_cast<IntLiteral&>(node).value);
+            return {lookupValue(key), size};
+        case NodeKind::FloatLiteral: {
+            uint32_t bits;
+            std::memcpy(&bits, &static_cast<FloatLiteral&>(node).value, sizeof bits);
+            key.payload = bits;
+            return {lookupValue(key), size};
+        }
+        case NodeKind::BoolLiteral:
+            key.payload = static_cast<BoolLiteral&>(node).value;
+            return {lookupValue(key), size};
+        case NodeKind::CharLiteral:
+            key.payload = uint8_t(static_cast<CharLiteral&>(node).value);
+            return {lookupValue(key), size};
+        case NodeKind::StrLiteral: {
+            auto [it, inserted] = stringNumbers.try_emplace(static_cast<StrLiteral&>(node).value, NoValue);
+            if (inserted) it->second = freshValue();
+            return {it->second, size};
         }
-    } else if (auto* unary = dynamic_cast<UnaryOpNode*>(&node)) {
-        if (auto* operandVar = dynamic_cast<VarRefNode*>(unary->operand.get())) {
-            if (operandVar->name == var) {
-                unary->operand = std::make_unique<IntLiteral>(value);
+        case NodeKind::BinaryOp: {
+            BinaryOp op = static_cast<BinaryOpNode&>(node).op;
+            if (op == BinaryOp::METHOD_CALL) {
+                return {freshValue(), size};
             }
-        } else {
-            substituteVariable(*unary->operand, var, value);
+            key.op = uint8_t(op);
+            break;
         }
-    } else if (auto* assign = dynamic_cast<AssignNode*>(&node)) {
-        if (auto* valueVar = dynamic_cast<VarRefNode*>(assign->value.get())) {
-            if (valueVar->name == var) {
-                assign->value = std::make_unique<IntLiteral>(value);
+        case NodeKind::UnaryOp: {
+            UnaryOp op = static_cast<UnaryOpNode&>(node).op;
+            if (op == UnaryOp::INCREMENT || op == UnaryOp::DECREMENT) {
+                return {freshValue(), size};
             }
-        } else {
-            substituteVariable(*assign->value, var, value);
+            key.op = uint8_t(op);
+            break;
         }
-    } else if (auto* arrayLit = dynamic_cast<ArrayLiteralNode*>(&node)) {
-        for (auto& elem : arrayLit->elements) {
-            substituteVariable(*elem, var, value);
+        case NodeKind::Concat:
+        case NodeKind::Ternary:
+            break;
+        default:
+            return {freshValue(), size}; // an array literal is a new buffer each time
+    }
+    if (readsArray) {
+        key.payload = memoryVersion;
+    }
+    uint32_t value = lookupValue(key);
+    if (isShareable(node, stored)) {
+        occurrences[value].push_back({&site, statement, size});
+    }
+    return {value, size};
+}
+
+uint32_t Optimizer::lookupValue(const ExprKey& key) {
+    auto [it, inserted] = valueNumbers.try_emplace(key, NoValue);
+    if (inserted) it->second = freshValue();
+    return it->second;
+}
+
+// Copies carry the analyzer's type annotations, so CodeGen can still read
+// them off unrolled loop bodies.
+NodePtr<ASTNode> Optimizer::cloneNode(const ASTNode& node) {
+    NodePtr<ASTNode> copy = cloneShape(node);
+    if (copy) {
+        copy->valueType = node.valueType;
+    }
+    return copy;
+}
+
+NodePtr<ASTNode> Optimizer::cloneShape(const ASTNode& node) {
+    switch (node.kind) {
+        case NodeKind::Block: {
+            auto newBlock = arena->make<BlockNode>();
+            for (const auto& stmt : static_cast<const BlockNode&>(node).statements) {
+                newBlock->statements.push_back(stmt ? cloneNode(*stmt) : nullptr);
+            }
+            return newBlock;
         }
-    } else if (auto* concat = dynamic_cast<ConcatNode*>(&node)) {
-        if (auto* leftVar = dynamic_cast<VarRefNode*>(concat->left.get())) {
-            if (leftVar->name == var) {
-                concat->left = std::make_unique<IntLiteral>(value);
+        case NodeKind::Loop: {
+            auto& loop = static_cast<const LoopNode&>(node);
+            if (loop.type == LoopType::For) {
+                return arena->make<LoopNode>(
+                    loop.init ? cloneNode(*loop.init) : nullptr,
+                    loop.condition ? cloneNode(*loop.condition) : nullptr,
+                    loop.update ? cloneNode(*loop.update) : nullptr,
+                    cloneNode(*loop.body));
             }
-        } else {
-            substituteVariable(*concat->left, var, value);
+            auto copy = arena->make<LoopNode>(loop.varSymbol, cloneNode(*loop.collection), cloneNode(*loop.body));
+            copy->varSlot = loop.varSlot;
+            return copy;
+        }
+        case NodeKind::IfElse: {
+            auto& ifElse = static_cast<const IfElseNode&>(node);
+            return arena->make<IfElseNode>(cloneNode(*ifElse.condition), cloneNode(*ifElse.then_block),
+                                           ifElse.else_block ? cloneNode(*ifElse.else_block) : nullptr);
+        }
+        case NodeKind::TryCatch: {
+            auto& tryCatch = static_cast<const TryCatchNode&>(node);
+            auto copy = arena->make<TryCatchNode>(cloneAs(*tryCatch.tryBlock), cloneAs(*tryCatch.catchBlock),
+                                                  tryCatch.errorSymbol);
+            copy->errorSlot = tryCatch.errorSlot;
+            return copy;
         }
-        if (auto* rightVar = dynamic_cast<VarRefNode*>(concat->right.get())) {
-            if (rightVar->name == var) {
-                concat->right = std::make_unique<IntLiteral>(value);
+        case NodeKind::Match: {
+            auto& match = static_cast<const MatchNode&>(node);
+            std::vector<NodePtr<MatchCaseNode>> cases;
+            for (const auto& caseNode : match.cases) {
+                cases.push_back(cloneAs(*caseNode));
             }
-        } else {
-            substituteVariable(*concat->right, var, value);
+            return arena->make<MatchNode>(cloneNode(*match.expression), std::move(cases));
         }
-    } else if (auto* varDecl = dynamic_cast<VarDeclNode*>(&node)) {
-        if (varDecl->value) {
-            if (auto* valueVar = dynamic_cast<VarRefNode*>(varDecl->value.get())) {
-                if (valueVar->name == var) {
-                    varDecl->value = std::make_unique<IntLiteral>(value);
-                }
-            } else {
-                substituteVariable(*varDecl->value, var, value);
+        case NodeKind::MatchCase: {
+            auto& matchCase = static_cast<const MatchCaseNode&>(node);
+            return arena->make<MatchCaseNode>(matchCase.value ? cloneNode(*matchCase.value) : nullptr,
+                                              cloneNode(*matchCase.body));
+        }
+        case NodeKind::Print:
+            return arena->make<PrintNode>(cloneNode(*static_cast<const PrintNode&>(node).expr));
+        case NodeKind::VarRef: {
+            auto& varRef = static_cast<const VarRefNode&>(node);
+            auto copy = arena->make<VarRefNode>(varRef.symbol);
+            copy->slot = varRef.slot;
+            return copy;
+        }
+        case NodeKind::IntLiteral:
+            return arena->make<IntLiteral>(static_cast<const IntLiteral&>(node).value);
+        case NodeKind::StrLiteral:
+            return arena->make<StrLiteral>(static_cast<const StrLiteral&>(node).value);
+        case NodeKind::BoolLiteral:
+            return arena->make<BoolLiteral>(static_cast<const BoolLiteral&>(node).value);
+        case NodeKind::FloatLiteral:
+            return arena->make<FloatLiteral>(static_cast<const FloatLiteral&>(node).value);
+        case NodeKind::CharLiteral:
+            return arena->make<CharLiteral>(static_cast<const CharLiteral&>(node).value);
+        case NodeKind::BinaryOp: {
+            auto& binary = static_cast<const BinaryOpNode&>(node);
+            return arena->make<BinaryOpNode>(binary.op, cloneNode(*binary.left),
+                                             binary.right ? cloneNode(*binary.right) : nullptr);
+        }
+        case NodeKind::UnaryOp: {
+            auto& unary = static_cast<const UnaryOpNode&>(node);
+            return arena->make<UnaryOpNode>(unary.op, cloneNode(*unary.operand));
+        }
+        case NodeKind::Assign: {
+            auto& assign = static_cast<const AssignNode&>(node);
+            auto copy = arena->make<AssignNode>(assign.symbol, cloneNode(*assign.value));
+            copy->slot = assign.slot;
+            return copy;
+        }
+        case NodeKind::CompoundAssign: {
+            auto& compound = static_cast<const CompoundAssignNode&>(node);
+            auto copy = arena->make<CompoundAssignNode>(compound.symbol, compound.op, cloneNode(*compound.value));
+            copy->slot = compound.slot;
+            return copy;
+        }
+        case NodeKind::ArrayLiteral: {
+            std::vector<NodePtr<ASTNode>> elements;
+            for (const auto& elem : static_cast<const ArrayLiteralNode&>(node).elements) {
+                elements.push_back(cloneNode(*elem));
             }
+            return arena->make<ArrayLiteralNode>(std::move(elements));
+        }
+        case NodeKind::Concat: {
+            auto& concat = static_cast<const ConcatNode&>(node);
+            return arena->make<ConcatNode>(cloneNode(*concat.left), cloneNode(*concat.right));
         }
+        case NodeKind::VarDecl: {
+            auto& varDecl = static_cast<const VarDeclNode&>(node);
+            auto copy = arena->make<VarDeclNode>(varDecl.type, varDecl.symbol,
+                                                 varDecl.value ? cloneNode(*varDecl.value) : nullptr);
+            copy->elementType = varDecl.elementType;
+            copy->slot = varDecl.slot;
+            copy->ownsBuffer = varDecl.ownsBuffer;
+            return copy;
+        }
+        case NodeKind::MultiVarDecl: {
+            std::vector<NodePtr<VarDeclNode>> declarations;
+            for (const auto& decl : static_cast<const MultiVarDeclNode&>(node).declarations) {
+                declarations.push_back(cloneAs(*decl));
+            }
+            return arena->make<MultiVarDeclNode>(std::move(declarations));
+        }
+        case NodeKind::Ternary: {
+            auto& ternary = static_cast<const TernaryExprNode&>(node);
+            return arena->make<TernaryExprNode>(cloneNode(*ternary.condition),
+                                                cloneNode(*ternary.trueBranch), cloneNode(*ternary.falseBranch));
+        }
+        default:
+            return nullptr;
     }
-}
\ No newline at end of file
+}
+
+// Replaces every read of the variable in `slot` below node with value().
+void Optimizer::substituteVariable(ASTNode& node, SlotId slot, const std::function<NodePtr<ASTNode>()>& value) {
+    forEachChild(node, [&](auto& child) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(child)>, NodePtr<ASTNode>>) {
+            auto* varRef = node_cast<VarRefNode>(child.get());
+            if (varRef && varRef->slot == slot) {
+                child = value();
+                return;
+            }
+        }
+        substituteVariable(*child, slot, value);
+    });
+}
@@ -2,29 +2,123 @@
 #define OPTIMIZER_H
 
 #include "ast.h"
-#include <vector>
+#include <functional>
+#include <iosfwd>
 #include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 class Optimizer {
 public:
     void optimize(ProgramNode& program);
     void printModifiedNodes() const;
+    void printUnrollReport(std::ostream& out) const;
+
+    // Unrolling budgets, in AST nodes of loop body.
+    static constexpr long long FullUnrollBudget = 256;    // body size x trip count
+    static constexpr long long PartialUnrollBudget = 64;  // body size x unroll factor
+    static constexpr int MaxUnrollFactor = 8;
 
 // private:
     struct ModifiedNode {
-        std::unique_ptr<ASTNode> original;
-        std::unique_ptr<ASTNode> modified;
+        NodePtr<ASTNode> original;
+        NodePtr<ASTNode> modified;
     };
     std::vector<ModifiedNode> modifiedNodes;
+    // What the unroller decided for each for loop it looked at.
+    struct UnrollDecision {
+        enum Kind { Kept, Full, Partial };
+        Kind kind = Kept;
+        SymbolId variable = NoSymbol;
+        long long trips = -1;  // -1 when not a constant
+        size_t bodySize = 0;
+        int factor = 1;        // body copies per iteration when Partial
+        std::string reason;    // why the loop was kept
+    };
+    std::vector<UnrollDecision> unrollReport;
+    bool unrolledAny = false;
+    AstArena* arena = nullptr;  // the optimized program's; clones go there too
+    ProgramNode* program = nullptr;  // hands out slots for hoisted temporaries
     std::optional<bool> evaluateConstantCondition(const ASTNode& condition) const; ////
     void optimizeNode(ASTNode& node);
     std::string printNode(const ASTNode& node) const;
-    std::unique_ptr<ASTNode> unrollForLoop(LoopNode& loop);
+    void unrollLoop(NodePtr<ASTNode>& stmt);
+    NodePtr<ASTNode> unrollForLoop(LoopNode& loop);
+    NodePtr<ASTNode> partiallyUnroll(LoopNode& loop, int start, int step, long long trips, int factor);
+    std::function<NodePtr<ASTNode>()> literalValue(int value);
+    void appendBodyCopy(BlockNode& out, const BlockNode& body, SlotId slot,
+                        const std::function<NodePtr<ASTNode>()>& value);
+    NodePtr<ASTNode> storeExitValue(const LoopNode& loop, int exitValue);
     std::optional<std::tuple<int, int, int>> getLoopBounds(const LoopNode& loop);
-    int computeIterations(int start, int end, int step, BinaryOp op);
-    std::string getLoopVariable(const LoopNode& loop);
-    std::unique_ptr<ASTNode> cloneNode(const ASTNode& node);
-    void substituteVariable(ASTNode& node, const std::string& var, int value);
+    long long computeIterations(int start, int end, int step, BinaryOp op);
+    SymbolId getLoopVariable(const LoopNode& loop);
+    struct LoopEffects {
+        std::vector<bool> written;    // by slot
+        bool writesElements = false;  // some a[i]++ or a[i]-- on a shared buffer
+    };
+    void reduceStrength(NodePtr<ASTNode>& node);
+    void reduceStrengthBelow(ASTNode& node);
+    NodePtr<ASTNode> simplifyArithmetic(BinaryOpNode& binary);
+    void reduceInductions(NodePtr<ASTNode>& stmt);
+    std::vector<bool> exclusiveBuffers;  // by slot: the variable's buffer is its alone
+    void noteExclusiveBuffers(ASTNode& node);
+    template <typename F>
+    void forEachWrite(ASTNode& node, F&& onWrite);  // onWrite(NoSlot): some shared buffer
+    void hoistLoops(NodePtr<ASTNode>& stmt);
+    void hoistLoopsBelow(ASTNode& node);
+    void hoistInvariants(NodePtr<ASTNode>& stmt);
+    void collectEffects(ASTNode& node, LoopEffects& effects);
+    void hoistFrom(NodePtr<ASTNode>& expr, bool stored, const LoopEffects& effects,
+                   std::vector<NodePtr<ASTNode>>& preheader);
+    void hoistFromChildren(ASTNode& node, bool stored, const LoopEffects& effects,
+                           std::vector<NodePtr<ASTNode>>& preheader);
+    NodePtr<VarDeclNode> makeTemporary(NodePtr<ASTNode>& expr, const char* name);
+    NodePtr<ASTNode> readTemporary(const VarDeclNode& decl);
+    // Common subexpression elimination: expressions are hash-consed into
+    // value numbers, one table per statement list.
+    static constexpr uint32_t NoValue = UINT32_MAX;
+    struct ExprKey {
+        NodeKind kind;
+        uint8_t op = 0;  // of a BinaryOp or UnaryOp
+        uint32_t operands[3] = {NoValue, NoValue, NoValue};  // value numbers of the children
+        uint64_t payload = 0;  // literal bits, slot and version, or memory version
+        bool operator==(const ExprKey& other) const;
+    };
+    struct ExprKeyHash {
+        size_t operator()(const ExprKey& key) const;
+    };
+    struct Occurrence {
+        NodePtr<ASTNode>* site;
+        size_t statement;  // index in the statement list
+        size_t size;       // in AST nodes
+    };
+    struct Numbered {
+        uint32_t value;
+        size_t size;
+    };
+    std::unordered_map<ExprKey, uint32_t, ExprKeyHash> valueNumbers;
+    std::unordered_map<std::string, uint32_t> stringNumbers;
+    std::vector<std::vector<Occurrence>> occurrences;  // by value number: where it may be shared
+    std::vector<uint32_t> slotVersions;                // by slot: bumped by every write
+    uint32_t memoryVersion = 0;                        // bumped by writes to shared buffers
+    void eliminateCommonSubexpressions(ASTNode& node);
+    void shareExpressions(std::vector<NodePtr<ASTNode>>& statements);
+    void noteWrites(ASTNode& node);
+    void numberStatement(ASTNode& stmt, size_t index);
+    Numbered valueNumber(NodePtr<ASTNode>& site, size_t statement, bool stored);
+    uint32_t lookupValue(const ExprKey& key);
+    uint32_t freshValue();
+    NodePtr<ASTNode> cloneNode(const ASTNode& node);
+    NodePtr<ASTNode> cloneShape(const ASTNode& node);  // cloneNode without the annotations
+    template <typename T>
+    NodePtr<T> cloneAs(const T& node) {
+        return NodePtr<T>(static_cast<T*>(cloneNode(node).release()));
+    }
+    void substituteVariable(ASTNode& node, SlotId slot, const std::function<NodePtr<ASTNode>()>& value);
 };
 
 #endif
\ No newline at end of file
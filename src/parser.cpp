@@ -1,19 +1,37 @@
 #include "parser.h"
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
-Parser::Parser(Lexer& lexer) : lexer(lexer) {
-    currentToken = lexer.nextToken();
-    peekToken = lexer.nextToken();
+Parser::Parser(Lexer& lexer) : tokens(lexer.tokenizeParallel()) {
+    currentToken = tokens[0];
 }
  
 void Parser::advance() {
-    currentToken = peekToken;
-    peekToken = lexer.nextToken();
+    currentToken = tokens[++index];
+}
+
+Token::Type Parser::peekType(size_t k) const {
+    return Token::Type(tokens.types[std::min(index + k, tokens.size() - 1)]);
+}
+
+float Parser::floatValue(const Token& token) {
+    return token.type == Token::FloatLiteral ? token.floatValue : float(token.intValue);
+}
+
+SymbolId Parser::symbolOf(const Token& token) {
+    // identifiers were interned by the lexer; anything else is interned here
+    return token.type == Token::Ident ? token.symbol : globalInterner().intern(token.lexeme);
+}
+
+int Parser::currentLine() const {
+    // Only reached on the error path, so the line index is built on demand.
+    return LineIndex(tokens.source).locate(currentToken.offset).line;
 }
 
 std::unique_ptr<ProgramNode> Parser::parseProgram() {
     auto program = std::make_unique<ProgramNode>();
+    arena = &program->arena;
     
     while (currentToken.type != Token::Eof) {
         auto stmt = parseStatement();
@@ -26,7 +44,7 @@ std::unique_ptr<ProgramNode> Parser::parseProgram() {
     return program;
 }
 
-std::unique_ptr<ASTNode> Parser::parseStatement() {
+NodePtr<ASTNode> Parser::parseStatement() {
     if (currentToken.type == Token::Int || currentToken.type == Token::StringType
         || currentToken.type == Token::Bool || currentToken.type == Token::Float
         || currentToken.type == Token::Char || currentToken.type == Token::Array) {
@@ -59,7 +77,7 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
             throw std::runtime_error("Expected ';' after print statement");
         }
         advance(); // Consume ';'
-        return std::make_unique<PrintNode>(std::move(expr));
+        return arena->make<PrintNode>(std::move(expr));
     }
     if (currentToken.type == Token::For || currentToken.type == Token::Foreach) {
         return parseLoop();
@@ -85,7 +103,7 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
         if (currentToken.type != Token::Ident) {
             throw std::runtime_error("Expected identifier after 'Error'");
         }
-        std::string errorVar = currentToken.lexeme;
+        SymbolId errorVar = symbolOf(currentToken);
         advance(); // Consume ident (e)
         if (currentToken.type != Token::RightParen) {
             throw std::runtime_error("Expected ')' after catch variable");
@@ -95,7 +113,7 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
             throw std::runtime_error("Expected '{' after 'catch'");
         }
         auto catchBlock = parseBlock();
-        return std::make_unique<TryCatchNode>(std::move(tryBlock), 
+        return arena->make<TryCatchNode>(std::move(tryBlock), 
                                              std::move(catchBlock), 
                                              errorVar);
     }
@@ -108,7 +126,7 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
     throw std::runtime_error("Unexpected token in statement");
 }
 
-std::unique_ptr<ASTNode> Parser::parseVarDecl() {
+NodePtr<ASTNode> Parser::parseVarDecl() {
     VarType type;
     if (currentToken.type == Token::Int) type = VarType::INT;
     else if (currentToken.type == Token::StringType) type = VarType::STRING;
@@ -118,19 +136,42 @@ std::unique_ptr<ASTNode> Parser::parseVarDecl() {
     else if (currentToken.type == Token::Array) type = VarType::ARRAY;
     else throw std::runtime_error("Unknown type in variable declaration");
     advance(); // Consume type
-    
+
+    // array<T>: optional element type
+    VarType elementType = VarType::NEUTRAL;
+    if (type == VarType::ARRAY && currentToken.type == Token::Less) {
+        advance(); // Consume '<'
+        if (currentToken.type == Token::Int) elementType = VarType::INT;
+        else if (currentToken.type == Token::StringType) elementType = VarType::STRING;
+        else if (currentToken.type == Token::Bool) elementType = VarType::BOOL;
+        else if (currentToken.type == Token::Float) elementType = VarType::FLOAT;
+        else if (currentToken.type == Token::Char) elementType = VarType::CHAR;
+        else throw std::runtime_error("Expected element type in array<...> at line " + std::to_string(currentLine()));
+        advance(); // Consume element type
+        if (currentToken.type != Token::Greater) {
+            throw std::runtime_error("Expected '>' after array element type at line " + std::to_string(currentLine()));
+        }
+        advance(); // Consume '>'
+    }
+
     if (currentToken.type != Token::Ident) {
         throw std::runtime_error("Expected identifier after type");
     }
-    std::string name = currentToken.lexeme;
+    SymbolId name = symbolOf(currentToken);
     advance(); // Consume ident
 
     if (currentToken.type == Token::Comma) {
-        return parseVarDeclMultiVariable(type, name);
+        auto multi = parseVarDeclMultiVariable(type, name);
+        if (auto* decls = node_cast<MultiVarDeclNode>(multi.get())) {
+            for (const auto& decl : decls->declarations) decl->elementType = elementType;
+        }
+        return multi;
     }
     if (currentToken.type == Token::Semicolon) {
         advance();
-        return std::make_unique<VarDeclNode>(type, name, nullptr);
+        auto decl = arena->make<VarDeclNode>(type, name, nullptr);
+        decl->elementType = elementType;
+        return decl;
     }
     if (currentToken.type != Token::Equal) {
         throw std::runtime_error("Expected '=' in variable declaration");
@@ -138,27 +179,29 @@ std::unique_ptr<ASTNode> Parser::parseVarDecl() {
     advance(); // Consume '='
 
     // Parse expression for value
-    std::unique_ptr<ASTNode> value = parseExpression();
+    NodePtr<ASTNode> value = parseExpression();
 
     if (currentToken.type != Token::Semicolon) {
         throw std::runtime_error("Expected ';' after variable declaration");
     }
     advance(); // Consume ';'
-    
-    return std::make_unique<VarDeclNode>(type, name, std::move(value));
+
+    auto decl = arena->make<VarDeclNode>(type, name, std::move(value));
+    decl->elementType = elementType;
+    return decl;
 }
 
-std::unique_ptr<ASTNode> Parser::parseExpression() {
+NodePtr<ASTNode> Parser::parseExpression() {
     if (currentToken.type == Token::LeftParen || currentToken.type == Token::negLeftParen) {
         auto pervType = currentToken.type;
         advance(); // consume '('
         auto left = parseExpression();
         if (currentToken.type != Token::RightParen) {
-            throw std::runtime_error("Expected ')' at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ')' at line " + std::to_string(currentLine()));
         }
         advance(); // consume ')'
         if(currentToken.type != Token::Semicolon){
-            // std::unique_ptr<ASTNode> left;
+            // NodePtr<ASTNode> left;
             while (currentToken.type == Token::Plus || currentToken.type == Token::Minus ||
                 currentToken.type == Token::Star || currentToken.type == Token::Slash || 
                 currentToken.type == Token::EqualEqual || currentToken.type == Token::LessEqual ||
@@ -173,17 +216,17 @@ std::unique_ptr<ASTNode> Parser::parseExpression() {
                  auto right = parsePrimary();
                  // Handle string concatenation
                  if (op == BinaryOp::XOR) {
-                     if (!dynamic_cast<BoolLiteral*>(left.get()) && !dynamic_cast<VarRefNode*>(left.get()) &&
-                         !dynamic_cast<BoolLiteral*>(right.get()) && !dynamic_cast<VarRefNode*>(right.get())) {
-                         throw std::runtime_error("XOR requires boolean operands at line " + std::to_string(currentToken.line));
+                     if (!node_cast<BoolLiteral>(left.get()) && !node_cast<VarRefNode>(left.get()) &&
+                         !node_cast<BoolLiteral>(right.get()) && !node_cast<VarRefNode>(right.get())) {
+                         throw std::runtime_error("XOR requires boolean operands at line " + std::to_string(currentLine()));
                      }
                  }
-                 if (dynamic_cast<StrLiteral*>(left.get()) || dynamic_cast<StrLiteral*>(right.get()) ||
-                     dynamic_cast<VarRefNode*>(left.get()) || dynamic_cast<VarRefNode*>(right.get())) {    //   needs to be corrected
-                     left = std::make_unique<ConcatNode>(std::move(left), std::move(right));
+                 if (node_cast<StrLiteral>(left.get()) || node_cast<StrLiteral>(right.get()) ||
+                     node_cast<VarRefNode>(left.get()) || node_cast<VarRefNode>(right.get())) {    //   needs to be corrected
+                     left = arena->make<ConcatNode>(std::move(left), std::move(right));
                  } else {
                      op = BinaryOp::ADD;
-                     left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+                     left = arena->make<BinaryOpNode>(op, std::move(left), std::move(right));
                  }
              } else
              if (currentToken.type != Token::SignedIntLiteral){
@@ -209,44 +252,44 @@ std::unique_ptr<ASTNode> Parser::parseExpression() {
                  auto right = parsePrimary();
      
                  if(op == BinaryOp::ADD && currentToken.type == Token::StrLiteral){
-                     if (dynamic_cast<StrLiteral*>(left.get()) || dynamic_cast<StrLiteral*>(right.get()) ||
-                     dynamic_cast<VarRefNode*>(left.get()) || dynamic_cast<VarRefNode*>(right.get())) {    //   needs to be corrected
-                     left = std::make_unique<ConcatNode>(std::move(left), std::move(right));
+                     if (node_cast<StrLiteral>(left.get()) || node_cast<StrLiteral>(right.get()) ||
+                     node_cast<VarRefNode>(left.get()) || node_cast<VarRefNode>(right.get())) {    //   needs to be corrected
+                     left = arena->make<ConcatNode>(std::move(left), std::move(right));
                      } else {
                          // error : NOT-string + string -- semantics
                      }
                  }else 
                  
-                 left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+                 left = arena->make<BinaryOpNode>(op, std::move(left), std::move(right));
              }else{
-                 auto right = std::make_unique<IntLiteral>(std::stoi(currentToken.lexeme));
-                 left = std::make_unique<BinaryOpNode>(BinaryOp::ADD, std::move(left), std::move(right));
+                 auto right = arena->make<IntLiteral>(currentToken.intValue);
+                 left = arena->make<BinaryOpNode>(BinaryOp::ADD, std::move(left), std::move(right));
                  advance(); // consume operator
      
                  // op = BinaryOp::ADD;
-                 // auto right = std::make_unique<IntLiteral>(std::stoi(currentToken.lexeme));
+                 // auto right = arena->make<IntLiteral>(std::stoi(std::string(currentToken.lexeme)));
                  // advance(); // consume the int literal
-                 // left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+                 // left = arena->make<BinaryOpNode>(op, std::move(left), std::move(right));
              }
          }
          if (currentToken.type == Token::PlusPlus || currentToken.type == Token::MinusMinus) {
              UnaryOp op = (currentToken.type == Token::PlusPlus) ? UnaryOp::INCREMENT : UnaryOp::DECREMENT;
              advance(); // Consume '++' or '--'
-             if (!dynamic_cast<VarRefNode*>(left.get()) && !dynamic_cast<BinaryOpNode*>(left.get())) {
+             if (!node_cast<VarRefNode>(left.get()) && !node_cast<BinaryOpNode>(left.get())) {
                  throw std::runtime_error("Increment/decrement can only be applied to variables or array elements");
              }
-             if (auto* binOp = dynamic_cast<BinaryOpNode*>(left.get())) {
+             if (auto* binOp = node_cast<BinaryOpNode>(left.get())) {
                  if (binOp->op != BinaryOp::INDEX) {
                      throw std::runtime_error("Increment/decrement can only be applied to array elements with index");
                  }
              }
-             left = std::make_unique<UnaryOpNode>(op, std::move(left));
+             left = arena->make<UnaryOpNode>(op, std::move(left));
          }
      
          return parseTernary(std::move(left));
         }
         if (pervType == Token::LeftParen) return left;
-        else return std::make_unique<UnaryOpNode>(UnaryOp::NEGATE, std::move(left));
+        else return arena->make<UnaryOpNode>(UnaryOp::NEGATE, std::move(left));
     }
     auto left = parsePrimary();
     while (currentToken.type == Token::Plus || currentToken.type == Token::Minus ||
@@ -263,17 +306,17 @@ std::unique_ptr<ASTNode> Parser::parseExpression() {
             auto right = parsePrimary();
             // Handle string concatenation
             if (op == BinaryOp::XOR) {
-                if (!dynamic_cast<BoolLiteral*>(left.get()) && !dynamic_cast<VarRefNode*>(left.get()) &&
-                    !dynamic_cast<BoolLiteral*>(right.get()) && !dynamic_cast<VarRefNode*>(right.get())) {
-                    throw std::runtime_error("XOR requires boolean operands at line " + std::to_string(currentToken.line));
+                if (!node_cast<BoolLiteral>(left.get()) && !node_cast<VarRefNode>(left.get()) &&
+                    !node_cast<BoolLiteral>(right.get()) && !node_cast<VarRefNode>(right.get())) {
+                    throw std::runtime_error("XOR requires boolean operands at line " + std::to_string(currentLine()));
                 }
             }
-            if (dynamic_cast<StrLiteral*>(left.get()) || dynamic_cast<StrLiteral*>(right.get()) ||
-                dynamic_cast<VarRefNode*>(left.get()) || dynamic_cast<VarRefNode*>(right.get())) {    //   needs to be corrected
-                left = std::make_unique<ConcatNode>(std::move(left), std::move(right));
+            if (node_cast<StrLiteral>(left.get()) || node_cast<StrLiteral>(right.get()) ||
+                node_cast<VarRefNode>(left.get()) || node_cast<VarRefNode>(right.get())) {    //   needs to be corrected
+                left = arena->make<ConcatNode>(std::move(left), std::move(right));
             } else {
                 op = BinaryOp::ADD;
-                left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+                left = arena->make<BinaryOpNode>(op, std::move(left), std::move(right));
             }
         } else
         if (currentToken.type != Token::SignedIntLiteral){
@@ -299,92 +342,92 @@ std::unique_ptr<ASTNode> Parser::parseExpression() {
             auto right = parsePrimary();
 
             if(op == BinaryOp::ADD && currentToken.type == Token::StrLiteral){
-                if (dynamic_cast<StrLiteral*>(left.get()) || dynamic_cast<StrLiteral*>(right.get()) ||
-                dynamic_cast<VarRefNode*>(left.get()) || dynamic_cast<VarRefNode*>(right.get())) {    //   needs to be corrected
-                left = std::make_unique<ConcatNode>(std::move(left), std::move(right));
+                if (node_cast<StrLiteral>(left.get()) || node_cast<StrLiteral>(right.get()) ||
+                node_cast<VarRefNode>(left.get()) || node_cast<VarRefNode>(right.get())) {    //   needs to be corrected
+                left = arena->make<ConcatNode>(std::move(left), std::move(right));
                 } else {
                     // error : NOT-string + string -- semantics
                 }
             }else 
             
-            left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+            left = arena->make<BinaryOpNode>(op, std::move(left), std::move(right));
         }else{
-            auto right = std::make_unique<IntLiteral>(std::stoi(currentToken.lexeme));
-            left = std::make_unique<BinaryOpNode>(BinaryOp::ADD, std::move(left), std::move(right));
+            auto right = arena->make<IntLiteral>(currentToken.intValue);
+            left = arena->make<BinaryOpNode>(BinaryOp::ADD, std::move(left), std::move(right));
             advance(); // consume operator
 
             // op = BinaryOp::ADD;
-            // auto right = std::make_unique<IntLiteral>(std::stoi(currentToken.lexeme));
+            // auto right = arena->make<IntLiteral>(std::stoi(std::string(currentToken.lexeme)));
             // advance(); // consume the int literal
-            // left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+            // left = arena->make<BinaryOpNode>(op, std::move(left), std::move(right));
         }
     }
     if (currentToken.type == Token::PlusPlus || currentToken.type == Token::MinusMinus) {
         UnaryOp op = (currentToken.type == Token::PlusPlus) ? UnaryOp::INCREMENT : UnaryOp::DECREMENT;
         advance(); // Consume '++' or '--'
-        if (!dynamic_cast<VarRefNode*>(left.get()) && !dynamic_cast<BinaryOpNode*>(left.get())) {
+        if (!node_cast<VarRefNode>(left.get()) && !node_cast<BinaryOpNode>(left.get())) {
             throw std::runtime_error("Increment/decrement can only be applied to variables or array elements");
         }
-        if (auto* binOp = dynamic_cast<BinaryOpNode*>(left.get())) {
+        if (auto* binOp = node_cast<BinaryOpNode>(left.get())) {
             if (binOp->op != BinaryOp::INDEX) {
                 throw std::runtime_error("Increment/decrement can only be applied to array elements with index");
             }
         }
-        left = std::make_unique<UnaryOpNode>(op, std::move(left));
+        left = arena->make<UnaryOpNode>(op, std::move(left));
     }
 
     return parseTernary(std::move(left));
 // }
 }
 
-std::unique_ptr<ASTNode> Parser::parsePrimary() {
+NodePtr<ASTNode> Parser::parsePrimary() {
     if (currentToken.type == Token::LeftParen) {
         advance(); // consume '('
         auto expr = parseExpression();
         if (currentToken.type != Token::RightParen) {
-            throw std::runtime_error("Expected ')' at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ')' at line " + std::to_string(currentLine()));
         }
         advance(); // consume ')'
         return expr;
     } else if (currentToken.type == Token::IntLiteral || currentToken.type == Token::SignedIntLiteral) {
-        auto node = std::make_unique<IntLiteral>(std::stoi(currentToken.lexeme));
+        auto node = arena->make<IntLiteral>(currentToken.intValue);
         advance();
         return node;
     } else if (currentToken.type == Token::StrLiteral) {
-        auto node = std::make_unique<StrLiteral>(currentToken.lexeme);
+        auto node = arena->make<StrLiteral>(std::string(currentToken.lexeme));
         advance();
         return node;
     } else if (currentToken.type == Token::BoolLiteral) {
-        auto node = std::make_unique<BoolLiteral>(currentToken.lexeme == "true");
+        auto node = arena->make<BoolLiteral>(currentToken.lexeme == "true");
         advance();
         return node;
     } else if (currentToken.type == Token::FloatLiteral) {
-        auto node = std::make_unique<FloatLiteral>(std::stof(currentToken.lexeme));
+        auto node = arena->make<FloatLiteral>(floatValue(currentToken));
         advance();
         return node;
     } else if (currentToken.type == Token::CharLiteral) {
-        auto node = std::make_unique<CharLiteral>(currentToken.lexeme[0]);
+        auto node = arena->make<CharLiteral>(currentToken.lexeme[0]);
         advance();
         return node;
     } else if (currentToken.type == Token::Ident) {
-        std::string name = currentToken.lexeme;
+        SymbolId name = symbolOf(currentToken);
         advance();
-        auto varRef = std::make_unique<VarRefNode>(name);
+        auto varRef = arena->make<VarRefNode>(name);
         // Support arr[i] syntax
         if (currentToken.type == Token::LeftBracket) {
             advance(); // Consume '['
             auto index = parseExpression(); // Parse index expression (e.g., i or 5)
             if (!index) {
-                throw std::runtime_error("Expected index expression in array access at line " + std::to_string(currentToken.line));
+                throw std::runtime_error("Expected index expression in array access at line " + std::to_string(currentLine()));
             }
-            if (!dynamic_cast<IntLiteral*>(index.get()) && !dynamic_cast<VarRefNode*>(index.get())) {
-                throw std::runtime_error("Array index must be an integer or identifier at line " + std::to_string(currentToken.line));
+            if (!node_cast<IntLiteral>(index.get()) && !node_cast<VarRefNode>(index.get())) {
+                throw std::runtime_error("Array index must be an integer or identifier at line " + std::to_string(currentLine()));
             }
             if (currentToken.type != Token::RightBracket) {
-                throw std::runtime_error("Expected ']' after array index at line " + std::to_string(currentToken.line));
+                throw std::runtime_error("Expected ']' after array index at line " + std::to_string(currentLine()));
             }
             advance(); // Consume ']'
-            return std::make_unique<BinaryOpNode>(BinaryOp::INDEX, std::move(varRef), std::move(index));
+            return arena->make<BinaryOpNode>(BinaryOp::INDEX, std::move(varRef), std::move(index));
         }
         // NEW: Support for method calls (e.g., e.toString()) using BinaryOpNode
         if (currentToken.type == Token::Dot) {
@@ -392,7 +435,7 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
             if (currentToken.type != Token::Ident) {
                 throw std::runtime_error("Expected method name after '.'");
             }
-            std::string methodName = currentToken.lexeme; // e.g., "toString"
+            std::string methodName(currentToken.lexeme); // e.g., "toString"
             advance();
             if (currentToken.type != Token::LeftParen) {
                 throw std::runtime_error("Expected '(' after method name");
@@ -402,21 +445,21 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
                 throw std::runtime_error("Expected ')' after method call");
             }
             advance(); // Consume ')'
-            auto methodNode = std::make_unique<StrLiteral>(methodName);
-            return std::make_unique<BinaryOpNode>(BinaryOp::METHOD_CALL, std::move(varRef), std::move(methodNode));
+            auto methodNode = arena->make<StrLiteral>(methodName);
+            return arena->make<BinaryOpNode>(BinaryOp::METHOD_CALL, std::move(varRef), std::move(methodNode));
         }
         // END NEW
         return varRef;
     } else if (currentToken.type == Token::LeftBracket) { // NEW: Array literal
         advance(); // Consume '['
-        std::vector<std::unique_ptr<ASTNode>> elements;
+        std::vector<NodePtr<ASTNode>> elements;
         if (currentToken.type != Token::RightBracket) {
             do {
                 auto expr = parseExpression();
-                if (!expr || (!dynamic_cast<IntLiteral*>(expr.get()) && !dynamic_cast<VarRefNode*>(expr.get()) &&
-                !dynamic_cast<StrLiteral*>(expr.get()) && !dynamic_cast<BoolLiteral*>(expr.get()) &&
-                !dynamic_cast<CharLiteral*>(expr.get()))) {
-                    throw std::runtime_error("Array elements must be integers or identifiers");
+                if (!expr || (!node_cast<IntLiteral>(expr.get()) && !node_cast<VarRefNode>(expr.get()) &&
+                !node_cast<StrLiteral>(expr.get()) && !node_cast<BoolLiteral>(expr.get()) &&
+                !node_cast<CharLiteral>(expr.get()) && !node_cast<FloatLiteral>(expr.get()))) {
+                    throw std::runtime_error("Array elements must be literals or identifiers");
                 }
                 elements.push_back(std::move(expr));
                 if (currentToken.type == Token::Comma) {
@@ -430,7 +473,7 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
             throw std::runtime_error("Expected ']' after array literal");
         }
         advance(); // Consume ']'
-        return std::make_unique<ArrayLiteralNode>(std::move(elements));
+        return arena->make<ArrayLiteralNode>(std::move(elements));
     } else if (currentToken.type == Token::Concat) {
         advance();
         if (currentToken.type != Token::LeftParen) {
@@ -453,7 +496,7 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
             throw std::runtime_error("Expected ')' after concat arguments");
         }
         advance();
-        return std::make_unique<ConcatNode>(std::move(left), std::move(right));
+        return arena->make<ConcatNode>(std::move(left), std::move(right));
     } else if (currentToken.type == Token::Abs) {
             advance(); // Consume 'abs'
         if (currentToken.type != Token::LeftParen) {
@@ -464,43 +507,43 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
         if (!expr) {
             throw std::runtime_error("Expected expression in abs");
         }
-        if (!dynamic_cast<IntLiteral*>(expr.get()) && !dynamic_cast<VarRefNode*>(expr.get())) {
+        if (!node_cast<IntLiteral>(expr.get()) && !node_cast<VarRefNode>(expr.get())) {
             throw std::runtime_error("abs argument must be an integer literal or identifier");
         }
         if (currentToken.type != Token::RightParen) {
             throw std::runtime_error("Expected ')' after abs argument");
         }
         advance(); // Consume ')'
-        return std::make_unique<BinaryOpNode>(BinaryOp::ABS, std::move(expr), nullptr);
+        return arena->make<BinaryOpNode>(BinaryOp::ABS, std::move(expr), nullptr);
     } else if (currentToken.type == Token::Pow) { // New
         advance();
         if (currentToken.type != Token::LeftParen) {
-            throw std::runtime_error("Expected '(' after 'pow' at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected '(' after 'pow' at line " + std::to_string(currentLine()));
         }
         advance();
         auto base = parseExpression();
         if (!base) {
-            throw std::runtime_error("Expected base expression in pow at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected base expression in pow at line " + std::to_string(currentLine()));
         }
-        if (!dynamic_cast<IntLiteral*>(base.get()) && !dynamic_cast<VarRefNode*>(base.get())) {
-            throw std::runtime_error("pow base must be an integer literal or identifier at line " + std::to_string(currentToken.line));
+        if (!node_cast<IntLiteral>(base.get()) && !node_cast<VarRefNode>(base.get())) {
+            throw std::runtime_error("pow base must be an integer literal or identifier at line " + std::to_string(currentLine()));
         }
         if (currentToken.type != Token::Comma) {
-            throw std::runtime_error("Expected ',' after pow base at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ',' after pow base at line " + std::to_string(currentLine()));
         }
         advance();
         auto exp = parseExpression();
         if (!exp) {
-            throw std::runtime_error("Expected exponent expression in pow at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected exponent expression in pow at line " + std::to_string(currentLine()));
         }
-        if (!dynamic_cast<IntLiteral*>(exp.get()) && !dynamic_cast<VarRefNode*>(exp.get())) {
-            throw std::runtime_error("pow exponent must be an integer literal or identifier at line " + std::to_string(currentToken.line));
+        if (!node_cast<IntLiteral>(exp.get()) && !node_cast<VarRefNode>(exp.get())) {
+            throw std::runtime_error("pow exponent must be an integer literal or identifier at line " + std::to_string(currentLine()));
         }
         if (currentToken.type != Token::RightParen) {
-            throw std::runtime_error("Expected ')' after pow arguments at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ')' after pow arguments at line " + std::to_string(currentLine()));
         }
         advance();
-        return std::make_unique<BinaryOpNode>(BinaryOp::POW, std::move(base), std::move(exp));
+        return arena->make<BinaryOpNode>(BinaryOp::POW, std::move(base), std::move(exp));
     } else if (currentToken.type == Token::Length || currentToken.type == Token::Min || currentToken.type == Token::Max) { // NEW: length, min, max
         UnaryOp op;
         std::string opName;
@@ -516,50 +559,50 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
         }
         advance(); // Consume 'length', 'min', or 'max'
         if (currentToken.type != Token::LeftParen) {
-            throw std::runtime_error("Expected '(' after '" + opName + "' at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected '(' after '" + opName + "' at line " + std::to_string(currentLine()));
         }
         advance(); // Consume '('
         auto operand = parseExpression();
         if (!operand) {
-            throw std::runtime_error("Expected array expression in " + opName + " at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected array expression in " + opName + " at line " + std::to_string(currentLine()));
         }
-        if (!dynamic_cast<VarRefNode*>(operand.get()) && !dynamic_cast<ArrayLiteralNode*>(operand.get())) {
-            throw std::runtime_error(opName + " argument must be an array or identifier at line " + std::to_string(currentToken.line));
+        if (!node_cast<VarRefNode>(operand.get()) && !node_cast<ArrayLiteralNode>(operand.get())) {
+            throw std::runtime_error(opName + " argument must be an array or identifier at line " + std::to_string(currentLine()));
         }
         if (currentToken.type != Token::RightParen) {
-            throw std::runtime_error("Expected ')' after " + opName + " argument at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ')' after " + opName + " argument at line " + std::to_string(currentLine()));
         }
         advance(); // Consume ')'
-        return std::make_unique<UnaryOpNode>(op, std::move(operand));
+        return arena->make<UnaryOpNode>(op, std::move(operand));
     } else if (currentToken.type == Token::Index) { // NEW: index
         advance(); // Consume 'index'
         if (currentToken.type != Token::LeftParen) {
-            throw std::runtime_error("Expected '(' after 'index' at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected '(' after 'index' at line " + std::to_string(currentLine()));
         }
         advance(); // Consume '('
         auto arr = parseExpression();
         if (!arr) {
-            throw std::runtime_error("Expected array expression in index at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected array expression in index at line " + std::to_string(currentLine()));
         }
-        if (!dynamic_cast<VarRefNode*>(arr.get()) && !dynamic_cast<ArrayLiteralNode*>(arr.get())) {
-            throw std::runtime_error("index first argument must be an array or identifier at line " + std::to_string(currentToken.line));
+        if (!node_cast<VarRefNode>(arr.get()) && !node_cast<ArrayLiteralNode>(arr.get())) {
+            throw std::runtime_error("index first argument must be an array or identifier at line " + std::to_string(currentLine()));
         }
         if (currentToken.type != Token::Comma) {
-            throw std::runtime_error("Expected ',' after index array at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ',' after index array at line " + std::to_string(currentLine()));
         }
         advance(); // Consume ','
         auto idx = parseExpression();
         if (!idx) {
-            throw std::runtime_error("Expected index expression in index at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected index expression in index at line " + std::to_string(currentLine()));
         }
-        if (!dynamic_cast<IntLiteral*>(idx.get()) && !dynamic_cast<VarRefNode*>(idx.get())) {
-            throw std::runtime_error("index second argument must be an integer or identifier at line " + std::to_string(currentToken.line));
+        if (!node_cast<IntLiteral>(idx.get()) && !node_cast<VarRefNode>(idx.get())) {
+            throw std::runtime_error("index second argument must be an integer or identifier at line " + std::to_string(currentLine()));
         }
         if (currentToken.type != Token::RightParen) {
-            throw std::runtime_error("Expected ')' after index arguments at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ')' after index arguments at line " + std::to_string(currentLine()));
         }
         advance(); // Consume ')'
-        return std::make_unique<BinaryOpNode>(BinaryOp::INDEX, std::move(arr), std::move(idx));
+        return arena->make<BinaryOpNode>(BinaryOp::INDEX, std::move(arr), std::move(idx));
     } else if (currentToken.type == Token::Multiply || currentToken.type == Token::Add ||
                currentToken.type == Token::Subtract || currentToken.type == Token::Divide) { // NEW: array operations
         BinaryOp op;
@@ -579,47 +622,47 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
         }
         advance(); // Consume 'multiply', 'add', 'subtract', or 'divide'
         if (currentToken.type != Token::LeftParen) {
-            throw std::runtime_error("Expected '(' after '" + opName + "' at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected '(' after '" + opName + "' at line " + std::to_string(currentLine()));
         }
         advance(); // Consume '('
         auto arr1 = parseExpression();
         if (!arr1) {
-            throw std::runtime_error("Expected first array in " + opName + " at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected first array in " + opName + " at line " + std::to_string(currentLine()));
         }
-        if (!dynamic_cast<VarRefNode*>(arr1.get()) && !dynamic_cast<ArrayLiteralNode*>(arr1.get())) {
-            throw std::runtime_error(opName + " first argument must be an array or identifier at line " + std::to_string(currentToken.line));
+        if (!node_cast<VarRefNode>(arr1.get()) && !node_cast<ArrayLiteralNode>(arr1.get())) {
+            throw std::runtime_error(opName + " first argument must be an array or identifier at line " + std::to_string(currentLine()));
         }
         if (currentToken.type != Token::Comma) {
-            throw std::runtime_error("Expected ',' after first array in " + opName + " at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ',' after first array in " + opName + " at line " + std::to_string(currentLine()));
         }
         advance(); // Consume ','
         auto arr2 = parseExpression();
         if (!arr2) {
-            throw std::runtime_error("Expected second array in " + opName + " at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected second array in " + opName + " at line " + std::to_string(currentLine()));
         }
-        if (!dynamic_cast<VarRefNode*>(arr2.get()) && !dynamic_cast<ArrayLiteralNode*>(arr2.get())) {
-            throw std::runtime_error(opName + " second argument must be an array or identifier at line " + std::to_string(currentToken.line));
+        if (!node_cast<VarRefNode>(arr2.get()) && !node_cast<ArrayLiteralNode>(arr2.get())) {
+            throw std::runtime_error(opName + " second argument must be an array or identifier at line " + std::to_string(currentLine()));
         }
         if (currentToken.type != Token::RightParen) {
-            throw std::runtime_error("Expected ')' after " + opName + " arguments at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ')' after " + opName + " arguments at line " + std::to_string(currentLine()));
         }
         advance(); // Consume ')'
-        return std::make_unique<BinaryOpNode>(op, std::move(arr1), std::move(arr2));
+        return arena->make<BinaryOpNode>(op, std::move(arr1), std::move(arr2));
     }else {
         throw std::runtime_error("Expected primary expression");
     }
 }
 
-std::unique_ptr<ASTNode> Parser::parseVarDeclMultiVariable(VarType type, std::string name) {
+NodePtr<ASTNode> Parser::parseVarDeclMultiVariable(VarType type, SymbolId name) {
     int counter = 1; // might not be neccesary
-    std::vector<std::string> IdentNames;
+    std::vector<SymbolId> IdentNames;
     IdentNames.push_back(name);
     while(true){
         advance();
         if (currentToken.type != Token::Ident) {
             throw std::runtime_error("Expected identifier after Comma");
         }
-        name = currentToken.lexeme;
+        name = symbolOf(currentToken);
         IdentNames.push_back(name);
         advance();
         if(currentToken.type == Token::Equal) break;
@@ -629,37 +672,37 @@ std::unique_ptr<ASTNode> Parser::parseVarDeclMultiVariable(VarType type, std::st
     }
     // now the current token is = 
     advance();
-    std::unique_ptr<ASTNode> value;
+    NodePtr<ASTNode> value;
     if (type == VarType::INT && currentToken.type == Token::IntLiteral) {
-        value = std::make_unique<IntLiteral>(std::stoi(currentToken.lexeme));
+        value = arena->make<IntLiteral>(currentToken.intValue);
         advance();
         if(currentToken.type == Token::Comma) return parseVarDeclMultiBoth(type, std::move(value), IdentNames);
     } 
     else if (type == VarType::STRING && currentToken.type == Token::StrLiteral) {
-        value = std::make_unique<StrLiteral>(currentToken.lexeme);
+        value = arena->make<StrLiteral>(std::string(currentToken.lexeme));
         advance();
         if(currentToken.type == Token::Comma) return parseVarDeclMultiBoth(type, std::move(value), IdentNames);
     } 
     else if (type == VarType::ARRAY && currentToken.type == Token::LeftBracket) { // NEW: Array multi-variable
         value = parsePrimary(); // Parse array literal
-        if (!dynamic_cast<ArrayLiteralNode*>(value.get())) {
+        if (!node_cast<ArrayLiteralNode>(value.get())) {
             throw std::runtime_error("Array initializer must be an array literal");
         }
         advance();
         if (currentToken.type == Token::Comma) return parseVarDeclMultiBoth(type, std::move(value), IdentNames);
     }
     else if (type == VarType::FLOAT && (currentToken.type == Token::FloatLiteral || currentToken.type == Token::IntLiteral)) {
-        value = std::make_unique<FloatLiteral>(std::stof(currentToken.lexeme));
+        value = arena->make<FloatLiteral>(floatValue(currentToken));
         advance();
         if(currentToken.type == Token::Comma) return parseVarDeclMultiBoth(type, std::move(value), IdentNames);
     }
     else if (type == VarType::BOOL && currentToken.type == Token::BoolLiteral) {
-        value = std::make_unique<BoolLiteral>(currentToken.lexeme == "true");
+        value = arena->make<BoolLiteral>(currentToken.lexeme == "true");
         advance();
         if(currentToken.type == Token::Comma) return parseVarDeclMultiBoth(type, std::move(value), IdentNames);
     }
     else if (type == VarType::CHAR && currentToken.type == Token::CharLiteral) {
-        value = std::make_unique<CharLiteral>(currentToken.lexeme[0]);
+        value = arena->make<CharLiteral>(currentToken.lexeme[0]);
         advance();
         if(currentToken.type == Token::Comma) return parseVarDeclMultiBoth(type, std::move(value), IdentNames);
     }
@@ -670,35 +713,35 @@ std::unique_ptr<ASTNode> Parser::parseVarDeclMultiVariable(VarType type, std::st
     //     throw std::runtime_error("Expected ';' after variable declaration");
     // }
     // advance(); // Consume ;
-    std::vector<std::unique_ptr<VarDeclNode>> declarations;
+    std::vector<NodePtr<VarDeclNode>> declarations;
     size_t i = 0;
 
     while (i < IdentNames.size()) {
-        std::unique_ptr<ASTNode> valueCopy; // New value for each VarDeclNode
-        if (auto* intLit = dynamic_cast<IntLiteral*>(value.get())) {
-            valueCopy = std::make_unique<IntLiteral>(intLit->value); // Deep copy for int
-        } else if (auto* strLit = dynamic_cast<StrLiteral*>(value.get())) {
-            valueCopy = std::make_unique<StrLiteral>(strLit->value); // Deep copy for string
-        } else if (auto* arrLit = dynamic_cast<ArrayLiteralNode*>(value.get())) { // NEW: Array copy
-            std::vector<std::unique_ptr<ASTNode>> elementsCopy;
+        NodePtr<ASTNode> valueCopy; // New value for each VarDeclNode
+        if (auto* intLit = node_cast<IntLiteral>(value.get())) {
+            valueCopy = arena->make<IntLiteral>(intLit->value); // Deep copy for int
+        } else if (auto* strLit = node_cast<StrLiteral>(value.get())) {
+            valueCopy = arena->make<StrLiteral>(strLit->value); // Deep copy for string
+        } else if (auto* arrLit = node_cast<ArrayLiteralNode>(value.get())) { // NEW: Array copy
+            std::vector<NodePtr<ASTNode>> elementsCopy;
             for (const auto& elem : arrLit->elements) {
-                if (auto* intLit = dynamic_cast<IntLiteral*>(elem.get())) {
-                    elementsCopy.push_back(std::make_unique<IntLiteral>(intLit->value));
+                if (auto* intLit = node_cast<IntLiteral>(elem.get())) {
+                    elementsCopy.push_back(arena->make<IntLiteral>(intLit->value));
                 } else {
                     throw std::runtime_error("Array elements must be integers");
                 }
             }
-            valueCopy = std::make_unique<ArrayLiteralNode>(std::move(elementsCopy));
-        } else if (auto* floatLit = dynamic_cast<FloatLiteral*>(value.get())) {
-            valueCopy = std::make_unique<FloatLiteral>(floatLit->value);
-        } else if (auto* boolLit = dynamic_cast<BoolLiteral*>(value.get())) {
-            valueCopy = std::make_unique<BoolLiteral>(boolLit->value);
-        } else if (auto* charLit = dynamic_cast<CharLiteral*>(value.get())) {
-            valueCopy = std::make_unique<CharLiteral>(charLit->value);
+            valueCopy = arena->make<ArrayLiteralNode>(std::move(elementsCopy));
+        } else if (auto* floatLit = node_cast<FloatLiteral>(value.get())) {
+            valueCopy = arena->make<FloatLiteral>(floatLit->value);
+        } else if (auto* boolLit = node_cast<BoolLiteral>(value.get())) {
+            valueCopy = arena->make<BoolLiteral>(boolLit->value);
+        } else if (auto* charLit = node_cast<CharLiteral>(value.get())) {
+            valueCopy = arena->make<CharLiteral>(charLit->value);
         } else {
             throw std::runtime_error("Unsupported value type in declaration");
         }
-        declarations.emplace_back(std::make_unique<VarDeclNode>(type, IdentNames[i], std::move(valueCopy)));
+        declarations.emplace_back(arena->make<VarDeclNode>(type, IdentNames[i], std::move(valueCopy)));
         i++;
     }
     
@@ -706,12 +749,12 @@ std::unique_ptr<ASTNode> Parser::parseVarDeclMultiVariable(VarType type, std::st
         throw std::runtime_error("Expected ';' after variable declaration");
     }
     advance(); // Consume ;
-return std::make_unique<MultiVarDeclNode>(std::move(declarations));
+return arena->make<MultiVarDeclNode>(std::move(declarations));
 }
 
-std::unique_ptr<ASTNode> Parser::parseVarDeclMultiBoth(VarType type, std::unique_ptr<ASTNode> value, std::vector<std::string> IdentNames) {
-    std::vector<std::unique_ptr<VarDeclNode>> declarations;
-    declarations.emplace_back(std::make_unique<VarDeclNode>(type, IdentNames[0], std::move(value)));
+NodePtr<ASTNode> Parser::parseVarDeclMultiBoth(VarType type, NodePtr<ASTNode> value, std::vector<SymbolId> IdentNames) {
+    std::vector<NodePtr<VarDeclNode>> declarations;
+    declarations.emplace_back(arena->make<VarDeclNode>(type, IdentNames[0], std::move(value)));
     int i = 1;
     while (i < IdentNames.size()) {
         if (currentToken.type != Token::Comma) {
@@ -719,25 +762,25 @@ std::unique_ptr<ASTNode> Parser::parseVarDeclMultiBoth(VarType type, std::unique
         }
         advance();
         if (type == VarType::INT && currentToken.type == Token::IntLiteral) {
-            value = std::make_unique<IntLiteral>(std::stoi(currentToken.lexeme));
+            value = arena->make<IntLiteral>(currentToken.intValue);
         } else if (type == VarType::STRING && currentToken.type == Token::StrLiteral) {
-            value = std::make_unique<StrLiteral>(currentToken.lexeme);
+            value = arena->make<StrLiteral>(std::string(currentToken.lexeme));
             
         } else if (type == VarType::ARRAY && currentToken.type == Token::LeftBracket) { // NEW: Array literal
             value = parsePrimary();
-            if (!dynamic_cast<ArrayLiteralNode*>(value.get())) {
+            if (!node_cast<ArrayLiteralNode>(value.get())) {
                 throw std::runtime_error("Array initializer must be an array literal");
             }
         } else if (type == VarType::FLOAT && (currentToken.type == Token::FloatLiteral || currentToken.type == Token::IntLiteral)) {
-            value = std::make_unique<FloatLiteral>(std::stof(currentToken.lexeme));
+            value = arena->make<FloatLiteral>(floatValue(currentToken));
         } else if (type == VarType::BOOL && currentToken.type == Token::BoolLiteral) {
-            value = std::make_unique<BoolLiteral>(currentToken.lexeme == "true");
+            value = arena->make<BoolLiteral>(currentToken.lexeme == "true");
         } else if (type == VarType::CHAR && currentToken.type == Token::CharLiteral) {
-            value = std::make_unique<CharLiteral>(currentToken.lexeme[0]);
+            value = arena->make<CharLiteral>(currentToken.lexeme[0]);
         } else {
             throw std::runtime_error("Type mismatch in variable declaration(4)");
         }
-        declarations.emplace_back(std::make_unique<VarDeclNode>(type, IdentNames[i], std::move(value)));
+        declarations.emplace_back(arena->make<VarDeclNode>(type, IdentNames[i], std::move(value)));
         advance();
         i++;
     }
@@ -745,39 +788,39 @@ std::unique_ptr<ASTNode> Parser::parseVarDeclMultiBoth(VarType type, std::unique
         throw std::runtime_error("Expected ';' after variable declaration");
     }
     advance(); // Consume ;
-    return std::make_unique<MultiVarDeclNode>(std::move(declarations));
+    return arena->make<MultiVarDeclNode>(std::move(declarations));
 }
 
-std::unique_ptr<ASTNode> Parser::parseAssignment() {
-    std::string name = currentToken.lexeme;
+NodePtr<ASTNode> Parser::parseAssignment() {
+    SymbolId name = symbolOf(currentToken);
     auto tempType = currentToken.type;
     advance(); // Consume ident
     
     // Handle array indexing: arr[i]
-    std::unique_ptr<ASTNode> left = std::make_unique<VarRefNode>(name);
+    NodePtr<ASTNode> left = arena->make<VarRefNode>(name);
     if (currentToken.type == Token::LeftBracket) {
         advance(); // Consume '['
         auto index = parseExpression();
         if (!index) {
-            throw std::runtime_error("Expected index expression in array access at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected index expression in array access at line " + std::to_string(currentLine()));
         }
-        if (!dynamic_cast<IntLiteral*>(index.get()) && !dynamic_cast<VarRefNode*>(index.get()) &&
-        !dynamic_cast<StrLiteral*>(index.get()) && !dynamic_cast<BoolLiteral*>(index.get()) &&
-        !dynamic_cast<CharLiteral*>(index.get())) {
-            throw std::runtime_error("Array index must be an integer or identifier at line " + std::to_string(currentToken.line));
+        if (!node_cast<IntLiteral>(index.get()) && !node_cast<VarRefNode>(index.get()) &&
+        !node_cast<StrLiteral>(index.get()) && !node_cast<BoolLiteral>(index.get()) &&
+        !node_cast<CharLiteral>(index.get())) {
+            throw std::runtime_error("Array index must be an integer or identifier at line " + std::to_string(currentLine()));
         }
         if (currentToken.type != Token::RightBracket) {
-            throw std::runtime_error("Expected ']' after array index at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ']' after array index at line " + std::to_string(currentLine()));
         }
         advance(); // Consume ']'
-        left = std::make_unique<BinaryOpNode>(BinaryOp::INDEX, std::move(left), std::move(index));
+        left = arena->make<BinaryOpNode>(BinaryOp::INDEX, std::move(left), std::move(index));
     }
 
     // Handle ++ or --
     if (currentToken.type == Token::PlusPlus || currentToken.type == Token::MinusMinus) {
         UnaryOp op = (currentToken.type == Token::PlusPlus) ? UnaryOp::INCREMENT : UnaryOp::DECREMENT;
         advance(); // Consume '++' or '--'
-        return std::make_unique<UnaryOpNode>(op, std::move(left));
+        return arena->make<UnaryOpNode>(op, std::move(left));
     }
 
     BinaryOp compoundOp;
@@ -818,19 +861,19 @@ std::unique_ptr<ASTNode> Parser::parseAssignment() {
     // advance(); // Consume ;
 
     if (isCompound) {
-        if (!dynamic_cast<IntLiteral*>(value.get()) && 
-            !dynamic_cast<FloatLiteral*>(value.get()) && 
-            !dynamic_cast<VarRefNode*>(value.get())) {
+        if (!node_cast<IntLiteral>(value.get()) && 
+            !node_cast<FloatLiteral>(value.get()) && 
+            !node_cast<VarRefNode>(value.get())) {
             throw std::runtime_error("Divide-equal (/=) expression must be an int or float literal or variable at line " + 
-                                    std::to_string(currentToken.line));
+                                    std::to_string(currentLine()));
         }
-        return std::make_unique<CompoundAssignNode>(name, compoundOp, std::move(value));
+        return arena->make<CompoundAssignNode>(name, compoundOp, std::move(value));
     } else {
-        return std::make_unique<AssignNode>(name, std::move(value));
+        return arena->make<AssignNode>(name, std::move(value));
     }
 }
 
-std::unique_ptr<ASTNode> Parser::parseIfStatement() {
+NodePtr<ASTNode> Parser::parseIfStatement() {
     advance(); // Consume 'if'
 
     if (currentToken.type != Token::LeftParen) {
@@ -850,7 +893,7 @@ std::unique_ptr<ASTNode> Parser::parseIfStatement() {
     }
     auto thenBlock = parseBlock(); // Parse the "then" block
 
-    std::unique_ptr<ASTNode> elseBlock = nullptr;
+    NodePtr<ASTNode> elseBlock = nullptr;
     if (currentToken.type == Token::Else) {
         advance(); // Consume 'else'
         if (currentToken.type == Token::If) {
@@ -862,16 +905,16 @@ std::unique_ptr<ASTNode> Parser::parseIfStatement() {
         }
     }
 
-    return std::make_unique<IfElseNode>(std::move(condition), std::move(thenBlock), std::move(elseBlock));
+    return arena->make<IfElseNode>(std::move(condition), std::move(thenBlock), std::move(elseBlock));
 }
 
-std::unique_ptr<BlockNode> Parser::parseBlock() {
+NodePtr<BlockNode> Parser::parseBlock() {
     if (currentToken.type != Token::LeftBrace) {
         throw std::runtime_error("Expected '{' to start block");
     }
     advance(); // consume '{'
 
-    auto block = std::make_unique<BlockNode>();
+    auto block = arena->make<BlockNode>();
 
     while (currentToken.type != Token::RightBrace) {
         block->statements.push_back(parseStatement());
@@ -881,7 +924,7 @@ std::unique_ptr<BlockNode> Parser::parseBlock() {
     return block;
 }
 
-std::unique_ptr<ASTNode> Parser::parseLoop() {
+NodePtr<ASTNode> Parser::parseLoop() {
     bool isForeach = (currentToken.type == Token::Foreach);
     advance(); // Consume 'for' or 'foreach'
     if (currentToken.type != Token::LeftParen) throw std::runtime_error("Expected '(' after loop keyword");
@@ -889,7 +932,7 @@ std::unique_ptr<ASTNode> Parser::parseLoop() {
 
     if (isForeach) {
         if (currentToken.type != Token::Ident) throw std::runtime_error("Expected identifier in foreach");
-        std::string varName = currentToken.lexeme;
+        SymbolId varName = symbolOf(currentToken);
         advance(); // Consume varName
         if (currentToken.type != Token::In) throw std::runtime_error("Expected 'in' in foreach");
         advance(); // Consume 'in'
@@ -898,9 +941,9 @@ std::unique_ptr<ASTNode> Parser::parseLoop() {
         if (currentToken.type != Token::RightParen) throw std::runtime_error("Expected ')' after foreach");
         advance(); // Consume ')'
         auto body = parseBlock();
-        return std::make_unique<LoopNode>(varName, std::move(collection), std::move(body));
+        return arena->make<LoopNode>(varName, std::move(collection), std::move(body));
     } else {
-        std::unique_ptr<ASTNode> init = nullptr;
+        NodePtr<ASTNode> init = nullptr;
         if (currentToken.type == Token::Int) {
             init = parseVarDecl(); // e.g., int i = 0
         } else if (currentToken.type == Token::Ident) {
@@ -918,11 +961,11 @@ std::unique_ptr<ASTNode> Parser::parseLoop() {
         if (currentToken.type != Token::RightParen) throw std::runtime_error("Expected ')' after update");
         advance(); // Consume ')'
         auto body = parseBlock();
-        return std::make_unique<LoopNode>(std::move(init), std::move(condition), std::move(update), std::move(body));
+        return arena->make<LoopNode>(std::move(init), std::move(condition), std::move(update), std::move(body));
     }
 }
 
-std::unique_ptr<ASTNode> Parser::parseTryCatch() {
+NodePtr<ASTNode> Parser::parseTryCatch() {
     advance(); // Consume 'try'
     if (currentToken.type != Token::LeftBrace) {
         throw std::runtime_error("Expected '{' after 'try'");
@@ -943,7 +986,7 @@ std::unique_ptr<ASTNode> Parser::parseTryCatch() {
     if (currentToken.type != Token::Ident) {
         throw std::runtime_error("Expected identifier after 'Error'");
     }
-    std::string errorVar = currentToken.lexeme; // e.g., "e"
+    SymbolId errorVar = symbolOf(currentToken); // e.g., "e"
     advance(); // Consume identifier 'e'
     if (currentToken.type != Token::RightParen) {
         throw std::runtime_error("Expected ')' after catch variable");
@@ -956,22 +999,22 @@ std::unique_ptr<ASTNode> Parser::parseTryCatch() {
     // Insert VarDeclNode for e
     catchBlock->statements.insert(
         catchBlock->statements.begin(),
-        std::make_unique<VarDeclNode>(VarType::ERROR, errorVar, nullptr)
+        arena->make<VarDeclNode>(VarType::ERROR, errorVar, nullptr)
     );
-    return std::make_unique<TryCatchNode>(std::move(tryBlock), std::move(catchBlock), errorVar);
+    return arena->make<TryCatchNode>(std::move(tryBlock), std::move(catchBlock), errorVar);
 }
 
-std::unique_ptr<ASTNode> Parser::parseTernary(std::unique_ptr<ASTNode> condition) {
+NodePtr<ASTNode> Parser::parseTernary(NodePtr<ASTNode> condition) {
     if (currentToken.type == Token::Question) {
         advance(); // Consume '?'
         auto trueBranch = parseExpression(); // Parse true branch (e.g., y)
         if (currentToken.type != Token::Colon) {
-            throw std::runtime_error("Expected ':' in ternary expression at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected ':' in ternary expression at line " + std::to_string(currentLine()));
         }
         advance(); // Consume ':'
         auto falseBranch = parseExpression(); // Parse false branch (e.g., w)
         // Inline boolean operator check
-        auto* binOp = dynamic_cast<BinaryOpNode*>(condition.get());
+        auto* binOp = node_cast<BinaryOpNode>(condition.get());
         if (!binOp || !(
             binOp->op == BinaryOp::EQUAL ||
             binOp->op == BinaryOp::NOT_EQUAL ||
@@ -982,29 +1025,29 @@ std::unique_ptr<ASTNode> Parser::parseTernary(std::unique_ptr<ASTNode> condition
             binOp->op == BinaryOp::AND ||
             binOp->op == BinaryOp::OR
         )) {
-            throw std::runtime_error("Ternary condition must be a boolean expression at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Ternary condition must be a boolean expression at line " + std::to_string(currentLine()));
         }
-        return std::make_unique<TernaryExprNode>(std::move(condition), std::move(trueBranch), std::move(falseBranch));
+        return arena->make<TernaryExprNode>(std::move(condition), std::move(trueBranch), std::move(falseBranch));
     }
     return condition;
 }
 
-std::unique_ptr<ASTNode> Parser::parseMatch() {
+NodePtr<ASTNode> Parser::parseMatch() {
     advance(); // Consume 'match'
     auto expr = parseExpression(); // Parse match expression (e.g., x)
     if (currentToken.type != Token::LeftBrace) {
-        throw std::runtime_error("Expected '{' after match expression at line " + std::to_string(currentToken.line));
+        throw std::runtime_error("Expected '{' after match expression at line " + std::to_string(currentLine()));
     }
     advance(); // Consume '{'
 
-    std::vector<std::unique_ptr<MatchCaseNode>> cases;
+    std::vector<NodePtr<MatchCaseNode>> cases;
     bool hasDefault = false;
 
     while (currentToken.type != Token::RightBrace && currentToken.type != Token::Eof) {
-        std::unique_ptr<ASTNode> value;
+        NodePtr<ASTNode> value;
         if (currentToken.type == Token::Underscore) {
             if (hasDefault) {
-                throw std::runtime_error("Multiple default cases in match at line " + std::to_string(currentToken.line));
+                throw std::runtime_error("Multiple default cases in match at line " + std::to_string(currentLine()));
             }
             hasDefault = true;
             value = nullptr; // Default case has no value
@@ -1014,11 +1057,11 @@ std::unique_ptr<ASTNode> Parser::parseMatch() {
         }
 
         if (currentToken.type != Token::Arrow) {
-            throw std::runtime_error("Expected '->' in match case at line " + std::to_string(currentToken.line));
+            throw std::runtime_error("Expected '->' in match case at line " + std::to_string(currentLine()));
         }
         advance(); // Consume '->'
 
-        std::unique_ptr<ASTNode> body;
+        NodePtr<ASTNode> body;
         if (currentToken.type == Token::LeftBrace) {
             // Parse block for multiple statements
             body = parseBlock();
@@ -1027,18 +1070,18 @@ std::unique_ptr<ASTNode> Parser::parseMatch() {
             body = parseStatement();
         }
 
-        cases.push_back(std::make_unique<MatchCaseNode>(std::move(value), std::move(body)));
+        cases.push_back(arena->make<MatchCaseNode>(std::move(value), std::move(body)));
 
         // Handle optional comma, but only if not at the end of the match
-        if (currentToken.type == Token::Comma && peekToken.type != Token::RightBrace) {
+        if (currentToken.type == Token::Comma && peekType() != Token::RightBrace) {
             advance(); // Consume ','
         }
     }
 
     if (currentToken.type != Token::RightBrace) {
-        throw std::runtime_error("Expected '}' to close match at line " + std::to_string(currentToken.line));
+        throw std::runtime_error("Expected '}' to close match at line " + std::to_string(currentLine()));
     }
     advance(); // Consume '}'
 
-    return std::make_unique<MatchNode>(std::move(expr), std::move(cases));
+    return arena->make<MatchNode>(std::move(expr), std::move(cases));
 }
@@ -12,30 +12,35 @@ public:
     std::unique_ptr<ProgramNode> parseProgram();
     
 private:
-    Lexer& lexer;
+    TokenBuffer tokens;
+    size_t index = 0;     // position of currentToken in tokens
     Token currentToken;
-    Token peekToken;
+    AstArena* arena = nullptr;  // the program being parsed owns its nodes
     
     // Core parsing
     void advance();
-    std::unique_ptr<ASTNode> parseStatement();
-    std::unique_ptr<ASTNode> parseVarDecl();
-    std::unique_ptr<ASTNode> parseExpression();
-    std::unique_ptr<ASTNode> parsePrimary();
-    std::unique_ptr<ASTNode> parseIfStatement();
-    // std::unique_ptr<ASTNode> parseLogicalExpression();
-    std::unique_ptr<ASTNode> parseTryCatch();
-    std::unique_ptr<BlockNode> parseBlock();
-    std::unique_ptr<ASTNode> parseLoop();
-    std::unique_ptr<ASTNode> parseTernary(std::unique_ptr<ASTNode> condition);
-    std::unique_ptr<ASTNode> parseMatch();
+    Token::Type peekType(size_t k = 1) const;  // type of the token k past currentToken
+    int currentLine() const;  // line of currentToken, for error messages
+    static float floatValue(const Token& token);  // FloatLiteral or IntLiteral as a float
+    static SymbolId symbolOf(const Token& token);  // the interned spelling of a name token
+    NodePtr<ASTNode> parseStatement();
+    NodePtr<ASTNode> parseVarDecl();
+    NodePtr<ASTNode> parseExpression();
+    NodePtr<ASTNode> parsePrimary();
+    NodePtr<ASTNode> parseIfStatement();
+    // NodePtr<ASTNode> parseLogicalExpression();
+    NodePtr<ASTNode> parseTryCatch();
+    NodePtr<BlockNode> parseBlock();
+    NodePtr<ASTNode> parseLoop();
+    NodePtr<ASTNode> parseTernary(NodePtr<ASTNode> condition);
+    NodePtr<ASTNode> parseMatch();
     ///////////////////////////////
     
-    std::unique_ptr<ASTNode> parseVarDeclMultiVariable(VarType type, std::string name); // int a , b = 10;
-    std::unique_ptr<ASTNode> parseVarDeclMultiBoth(VarType type, std::unique_ptr<ASTNode> value, std::vector<std::string> IdentNames);     // int a , b = 10, 12;
+    NodePtr<ASTNode> parseVarDeclMultiVariable(VarType type, SymbolId name); // int a , b = 10;
+    NodePtr<ASTNode> parseVarDeclMultiBoth(VarType type, NodePtr<ASTNode> value, std::vector<SymbolId> IdentNames);     // int a , b = 10, 12;
 
     ///////////////////////////////
-    std::unique_ptr<ASTNode> parseAssignment();
+    NodePtr<ASTNode> parseAssignment();
 
     // Critical additions
     [[noreturn]] void error(const std::string& msg, const Token& token);
@@ -44,11 +49,11 @@ private:
     // Optional future extensions
     /*
     // For expressions (when needed)
-    std::unique_ptr<ExprNode> parseExpression();
-    std::unique_ptr<ExprNode> parseAdditive();
+    NodePtr<ExprNode> parseExpression();
+    NodePtr<ExprNode> parseAdditive();
     
     // For blocks (when needed)
-    std::unique_ptr<BlockNode> parseBlock();
+    NodePtr<BlockNode> parseBlock();
     */
 };
 
@@ -0,0 +1,84 @@
+#include "scan.h"
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline bool isSpace(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+#if defined(__AVX2__)
+constexpr size_t width = 32;
+using Vec = __m256i;
+using Mask = uint32_t;
+
+inline Vec load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const Vec*>(p)); }
+inline Mask matchByte(Vec v, char c) {
+    return Mask(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))));
+}
+inline Mask matchSpace(Vec v) {
+    // '\t'..'\r' are the five bytes 9..13: (b - 9) <= 4 unsigned
+    Vec shifted = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    Vec control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+    Vec space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    return Mask(_mm256_movemask_epi8(_mm256_or_si256(control, space)));
+}
+#elif defined(__SSE2__)
+constexpr size_t width = 16;
+using Vec = __m128i;
+using Mask = uint32_t;
+
+inline Vec load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const Vec*>(p)); }
+inline Mask matchByte(Vec v, char c) {
+    return Mask(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+}
+inline Mask matchSpace(Vec v) {
+    Vec shifted = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    Vec control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+    Vec space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    return Mask(_mm_movemask_epi8(_mm_or_si128(control, space)));
+}
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+constexpr Mask fullMask = Mask((uint64_t(1) << width) - 1);
+#endif
+
+} // namespace
+
+namespace scan {
+
+const char* skipWhitespace(const char* p, const char* end) {
+    // Most runs are a single space; don't pay for a vector load on those.
+    if (p == end || !isSpace(*p)) return p;
+    ++p;
+#if defined(__AVX2__) || defined(__SSE2__)
+    while (size_t(end - p) >= width) {
+        Mask other = ~matchSpace(load(p)) & fullMask;
+        if (other) return p + __builtin_ctz(other);
+        p += width;
+    }
+#endif
+    while (p < end && isSpace(*p)) ++p;
+    return p;
+}
+
+const char* find(const char* p, const char* end, char c) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    while (size_t(end - p) >= width) {
+        Mask hits = matchByte(load(p), c);
+        if (hits) return p + __builtin_ctz(hits);
+        p += width;
+    }
+#endif
+    while (p < end && *p != c) ++p;
+    return p;
+}
+
+} // namespace scan
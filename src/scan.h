@@ -0,0 +1,19 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+
+// Bulk byte scanners used by the lexer. Each one walks [p, end) 32 bytes
+// at a time with AVX2, 16 with SSE2, or byte by byte when neither is
+// available, and returns `end` when nothing matches.
+namespace scan {
+
+// First byte that is not ' ', '\t', '\n', '\v', '\f' or '\r'.
+const char* skipWhitespace(const char* p, const char* end);
+
+// First occurrence of `c`.
+const char* find(const char* p, const char* end, char c);
+
+} // namespace scan
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef SCOPE_H
+#define SCOPE_H
+
+#include "interner.h"
+#include <cstdint>
+#include <vector>
+
+// Lexically scoped symbol table shared by SemanticAnalyzer and CodeGen.
+//
+// Bindings live on one stack in declaration order; each remembers the
+// binding it shadows. An open-addressing map takes a SymbolId to its
+// innermost binding, so lookups are one probe sequence however deep the
+// nesting. Entering a scope records the stack height; leaving it unwinds
+// only that scope's bindings, restoring whatever each one shadowed.
+// References returned by declare() and find() are invalidated by the next
+// declare().
+template <typename T>
+class ScopedTable {
+public:
+    struct Binding {
+        SymbolId symbol;
+        uint32_t shadowed;  // previous binding of the same symbol, or None
+        T value;
+    };
+
+    ScopedTable() : slots(16) {}
+
+    void pushScope() { scopeStarts.push_back(uint32_t(bindings.size())); }
+
+    // Drops the innermost scope, calling onExit(binding) for each of its
+    // bindings, most recent first.
+    template <typename F>
+    void popScope(F&& onExit) {
+        uint32_t start = scopeStarts.back();
+        scopeStarts.pop_back();
+        while (bindings.size() > start) {
+            Binding& binding = bindings.back();
+            onExit(binding);
+            slots[findSlot(binding.symbol)].binding = binding.shadowed;
+            bindings.pop_back();
+        }
+    }
+    void popScope() {
+        popScope([](Binding&) {});
+    }
+
+    // Binds symbol in the current scope, shadowing any outer binding (or an
+    // earlier one in the same scope).
+    T& declare(SymbolId symbol, T value) {
+        if ((used + 1) * 4 > slots.size() * 3) {
+            grow();
+        }
+        Slot& slot = slots[findSlot(symbol)];
+        if (slot.symbol == NoSymbol) {
+            slot.symbol = symbol;
+            ++used;
+        }
+        bindings.push_back({symbol, slot.binding, std::move(value)});
+        slot.binding = uint32_t(bindings.size() - 1);
+        return bindings.back().value;
+    }
+
+    // Innermost binding of symbol, or null when it is not in scope.
+    T* find(SymbolId symbol) {
+        uint32_t index = slots[findSlot(symbol)].binding;
+        return index == None ? nullptr : &bindings[index].value;
+    }
+
+    bool declaredInCurrentScope(SymbolId symbol) {
+        uint32_t index = slots[findSlot(symbol)].binding;
+        return index != None && (scopeStarts.empty() || index >= scopeStarts.back());
+    }
+
+    size_t depth() const { return scopeStarts.size(); }
+
+private:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    // A symbol keeps its slot once seen; going out of scope only resets
+    // `binding`, so there are no tombstones and probing never restarts.
+    struct Slot {
+        SymbolId symbol = NoSymbol;
+        uint32_t binding = None;
+    };
+
+    std::vector<Slot> slots;  // power-of-two size, linear probing
+    size_t used = 0;
+    std::vector<Binding> bindings;
+    std::vector<uint32_t> scopeStarts;
+
+    // Slot holding symbol, or the empty slot where it would go. Interned ids
+    // are dense, so a multiplicative hash spreads them well enough.
+    size_t findSlot(SymbolId symbol) const {
+        size_t mask = slots.size() - 1;
+        size_t i = (symbol * 2654435761u) & mask;
+        while (slots[i].symbol != symbol && slots[i].symbol != NoSymbol) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        for (const Slot& slot : old) {
+            if (slot.symbol != NoSymbol) {
+                slots[findSlot(slot.symbol)] = slot;
+            }
+        }
+    }
+};
+
+#endif
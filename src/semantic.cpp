@@ -1,107 +1,222 @@
 #include "semantic.h"
 #include "ast.h"
 #include <stdexcept>
-#include <map>
+#include <unordered_map>
 #include <string>
 
-SemanticAnalyzer::SemanticAnalyzer() {}
+SemanticAnalyzer::SemanticAnalyzer() {
+    symbolTable.pushScope();
+}
 
+// A store of another length makes an array variable's length unknown, but
+// reads analyzed before that store (earlier in a loop body, say) already
+// took the old one. Such a program is analyzed again with those lengths
+// unknown from the start. A pass can only forget lengths, so this ends, and
+// errors that rest on a length wait for the pass that keeps it.
 void SemanticAnalyzer::analyze(ProgramNode* program) {
-    for (const auto& stmt : program->statements) {
-        analyzeStatement(stmt.get());
+    for (;;) {
+        size_t varying = lengthsVary.size();
+        for (const auto& stmt : program->statements) {
+            analyzeStatement(stmt.get());
+        }
+        program->slotCount = nextSlot;
+        if (lengthsVary.size() == varying) {
+            if (!lengthError.empty()) {
+                throw std::runtime_error(lengthError);
+            }
+            return;
+        }
+        for (const auto& stmt : program->statements) {
+            forgetTypes(*stmt);
+        }
+        symbolTable = ScopedTable<Symbol>();
+        symbolTable.pushScope();
+        nextSlot = 0;
+        lengthError.clear();
+    }
+}
+
+// Clears what a pass inferred; literals keep the types they were built with.
+void SemanticAnalyzer::forgetTypes(ASTNode& node) {
+    switch (node.kind) {
+        case NodeKind::IntLiteral:
+        case NodeKind::FloatLiteral:
+        case NodeKind::StrLiteral:
+        case NodeKind::BoolLiteral:
+        case NodeKind::CharLiteral:
+            return;
+        default:
+            node.valueType = ValueType();
     }
+    forEachChild(node, [](auto& child) { forgetTypes(*child); });
+}
+
+void SemanticAnalyzer::noteLengthError(const std::string& message) {
+    if (lengthError.empty()) {
+        lengthError = message;
+    }
+}
+
+SlotId SemanticAnalyzer::declare(SymbolId symbol, Symbol info) {
+    info.slot = nextSlot++;
+    symbolTable.declare(symbol, info);
+    return info.slot;
 }
 
 void SemanticAnalyzer::analyzeStatement(ASTNode* node) {
-    if (auto* varDecl = dynamic_cast<VarDeclNode*>(node)) {
-        analyzeVarDecl(varDecl);
-    } else if (auto* assign = dynamic_cast<AssignNode*>(node)) {
-        analyzeAssign(assign);
-    } else if (auto* compoundAssign = dynamic_cast<CompoundAssignNode*>(node)) {
-        analyzeCompoundAssign(compoundAssign);
-    } else if (auto* binaryOp = dynamic_cast<BinaryOpNode*>(node)) {
-        throw std::runtime_error("Standalone binary operation is not allowed as a statement");
-    } else if (auto* unaryOp = dynamic_cast<UnaryOpNode*>(node)) {
-        throw std::runtime_error("Standalone unary operation is not allowed as a statement");
-    } else if (auto* print = dynamic_cast<PrintNode*>(node)) {
-        getExpressionType(print->expr.get()); // Any type is valid for print
-    } else if (auto* ifElse = dynamic_cast<IfElseNode*>(node)) {
-        analyzeIfElse(ifElse);
-    } else if (auto* loop = dynamic_cast<LoopNode*>(node)) {
-        analyzeLoop(loop);
-    } else if (auto* tryCatch = dynamic_cast<TryCatchNode*>(node)) {
-        analyzeTryCatch(tryCatch);
-    } else if (auto* match = dynamic_cast<MatchNode*>(node)) {
-        analyzeMatch(match);
-    } else if (auto* multiVarDecl = dynamic_cast<MultiVarDeclNode*>(node)) {
-        for (const auto& decl : multiVarDecl->declarations) {
-            analyzeVarDecl(decl.get());
-        }
-    } else if (auto* block = dynamic_cast<BlockNode*>(node)) {
-        for (const auto& stmt : block->statements) {
-            analyzeStatement(stmt.get());
+    switch (node->kind) {
+        case NodeKind::VarDecl:
+            analyzeVarDecl(static_cast<VarDeclNode*>(node));
+            return;
+        case NodeKind::Assign:
+            analyzeAssign(static_cast<AssignNode*>(node));
+            return;
+        case NodeKind::CompoundAssign:
+            analyzeCompoundAssign(static_cast<CompoundAssignNode*>(node));
+            return;
+        case NodeKind::BinaryOp:
+            throw std::runtime_error("Standalone binary operation is not allowed as a statement");
+        case NodeKind::UnaryOp: {
+            auto* unaryOp = static_cast<UnaryOpNode*>(node);
+            if (unaryOp->op != UnaryOp::INCREMENT && unaryOp->op != UnaryOp::DECREMENT) {
+                throw std::runtime_error("Standalone unary operation is not allowed as a statement");
+            }
+            analyzeUnaryOp(unaryOp); // x++ / x--, e.g. a for-loop update
+            return;
         }
-    } else {
-        throw std::runtime_error("Unknown statement type in semantic analysis");
+        case NodeKind::Print:
+            getExpressionType(static_cast<PrintNode*>(node)->expr.get()); // Any type is valid for print
+            return;
+        case NodeKind::IfElse:
+            analyzeIfElse(static_cast<IfElseNode*>(node));
+            return;
+        case NodeKind::Loop:
+            analyzeLoop(static_cast<LoopNode*>(node));
+            return;
+        case NodeKind::TryCatch:
+            analyzeTryCatch(static_cast<TryCatchNode*>(node));
+            return;
+        case NodeKind::Match:
+            analyzeMatch(static_cast<MatchNode*>(node));
+            return;
+        case NodeKind::MultiVarDecl:
+            for (const auto& decl : static_cast<MultiVarDeclNode*>(node)->declarations) {
+                analyzeVarDecl(decl.get());
+            }
+            return;
+        case NodeKind::Block:
+            symbolTable.pushScope();
+            for (const auto& stmt : static_cast<BlockNode*>(node)->statements) {
+                analyzeStatement(stmt.get());
+            }
+            symbolTable.popScope();
+            return;
+        default:
+            throw std::runtime_error("Unknown statement type in semantic analysis");
+    }
+}
+
+// A value that CodeGen has just malloc'ed: nothing else can point at it yet.
+static bool isFreshBuffer(const ASTNode* value) {
+    return value->kind == NodeKind::ArrayLiteral || value->kind == NodeKind::Concat ||
+           (value->kind == NodeKind::BinaryOp && value->valueType.isArray());
+}
+
+static bool isNumeric(VarType type) {
+    return type == VarType::INT || type == VarType::FLOAT;
+}
+
+// Whether a value of type `from` may be stored in a variable of type `to`.
+// Lengths never decide it; an empty literal fits any element type.
+static bool isAssignable(const ValueType& to, const ValueType& from) {
+    if (to.kind == VarType::FLOAT && from.kind == VarType::INT) {
+        return true;
+    }
+    if (to.kind != from.kind) {
+        return false;
+    }
+    if (!to.isArray()) {
+        return true;
     }
+    return from.length == 0 || from.element == to.element;
 }
 
 void SemanticAnalyzer::analyzeVarDecl(VarDeclNode* node) {
-    if (symbolTable.find(node->name) != symbolTable.end()) {
-        throw std::runtime_error("Variable '" + node->name + "' already declared");
+    if (symbolTable.declaredInCurrentScope(node->symbol)) {
+        throw std::runtime_error("Variable '" + symbolName(node->symbol) + "' already declared");
+    }
+    ValueType type = node->type;
+    if (node->type == VarType::ARRAY) {
+        type = ValueType::array(node->elementType != VarType::NEUTRAL ? node->elementType : VarType::INT);
     }
     if (node->value) {
-        VarType valueType = getExpressionType(node->value.get());
-        if (valueType != node->type && !(node->type == VarType::FLOAT && valueType == VarType::INT)) {
-            throw std::runtime_error("Type mismatch in declaration of '" + node->name + "': expected " + typeToString(node->type) + ", got " + typeToString(valueType));
+        ValueType valueType = getExpressionType(node->value.get());
+        if (type.isArray() && valueType.isArray()) {
+            // `array` alone takes its element type from the initializer
+            type.element = node->elementType != VarType::NEUTRAL ? node->elementType : valueType.element;
+            type.length = lengthsVary.count(node) ? UnknownLength : valueType.length;
         }
-        if (node->type == VarType::ARRAY) {
-            if (auto* arrayLit = dynamic_cast<ArrayLiteralNode*>(node->value.get())) {
-                for (const auto& elem : arrayLit->elements) {
-                    VarType elemType = getExpressionType(elem.get());
-                    if (elemType != VarType::INT) { // Assuming array elements are INT; adjust if needed
-                        throw std::runtime_error("Array elements must be integers, got " + typeToString(elemType));
-                    }
-                }
-            } else {
-                throw std::runtime_error("Array declaration requires array literal");
-            }
+        if (!isAssignable(type, valueType)) {
+            throw std::runtime_error("Type mismatch in declaration of '" + symbolName(node->symbol) + "': expected " + typeToString(type) + ", got " + typeToString(valueType));
         }
+        noteStoredValue(node->value.get());
+        node->ownsBuffer = isFreshBuffer(node->value.get());
     }
-    symbolTable[node->name] = node->type;
+    node->valueType = type;
+    node->slot = declare(node->symbol, {type, node});
 }
 
 void SemanticAnalyzer::analyzeAssign(AssignNode* node) {
-    auto it = symbolTable.find(node->name);
-    if (it == symbolTable.end()) {
-        throw std::runtime_error("Undefined variable '" + node->name + "' in assignment");
+    Symbol* symbol = symbolTable.find(node->symbol);
+    if (!symbol) {
+        throw std::runtime_error("Undefined variable '" + symbolName(node->symbol) + "' in assignment");
     }
-    VarType varType = it->second;
-    VarType valueType = getExpressionType(node->value.get());
-    if (valueType != varType && !(varType == VarType::FLOAT && valueType == VarType::INT)) {
-        throw std::runtime_error("Type mismatch in assignment to '" + node->name + "': expected " + typeToString(varType) + ", got " + typeToString(valueType));
+    node->slot = symbol->slot;
+    ValueType varType = symbol->type;
+    ValueType valueType = getExpressionType(node->value.get());
+    if (!isAssignable(varType, valueType)) {
+        throw std::runtime_error("Type mismatch in assignment to '" + symbolName(node->symbol) + "': expected " + typeToString(varType) + ", got " + typeToString(valueType));
     }
-    if (varType == VarType::ARRAY) {
-        if (auto* arrayLit = dynamic_cast<ArrayLiteralNode*>(node->value.get())) {
-            for (const auto& elem : arrayLit->elements) {
-                VarType elemType = getExpressionType(elem.get());
-                if (elemType != VarType::INT) {
-                    throw std::runtime_error("Array elements must be integers, got " + typeToString(elemType));
-                }
-            }
-        } else {
-            throw std::runtime_error("Array assignment requires array literal");
+    if (varType.hasLength() && valueType.length != varType.length) {
+        // the length is only a hint; stores that disagree on it leave it unknown
+        symbol->type.length = UnknownLength;
+        if (symbol->decl) {
+            lengthsVary.insert(symbol->decl);
+        }
+    }
+    noteStoredValue(node->value.get());
+    if (symbol->decl && !isFreshBuffer(node->value.get())) {
+        symbol->decl->ownsBuffer = false;
+    }
+}
+
+// A variable read as the whole value of a store, or as an element of a
+// stored array literal, now shares its buffer with the target, so neither
+// may free it.
+void SemanticAnalyzer::noteStoredValue(ASTNode* value) {
+    if (auto* varRef = node_cast<VarRefNode>(value)) {
+        Symbol* symbol = symbolTable.find(varRef->symbol);
+        if (symbol && symbol->decl) {
+            symbol->decl->ownsBuffer = false;
+        }
+    } else if (auto* ternary = node_cast<TernaryExprNode>(value)) {
+        noteStoredValue(ternary->trueBranch.get());
+        noteStoredValue(ternary->falseBranch.get());
+    } else if (auto* arrayLit = node_cast<ArrayLiteralNode>(value)) {
+        for (const auto& element : arrayLit->elements) {
+            noteStoredValue(element.get());
         }
     }
 }
 
 void SemanticAnalyzer::analyzeCompoundAssign(CompoundAssignNode* node) {
-    auto it = symbolTable.find(node->name);
-    if (it == symbolTable.end()) {
-        throw std::runtime_error("Undefined variable '" + node->name + "' in compound assignment");
+    Symbol* symbol = symbolTable.find(node->symbol);
+    if (!symbol) {
+        throw std::runtime_error("Undefined variable '" + symbolName(node->symbol) + "' in compound assignment");
     }
-    VarType varType = it->second;
-    VarType valueType = getExpressionType(node->value.get());
+    node->slot = symbol->slot;
+    VarType varType = symbol->type.kind;
+    VarType valueType = getExpressionType(node->value.get()).kind;
     if (varType != VarType::INT && varType != VarType::FLOAT) {
         throw std::runtime_error("Compound assignment requires numeric variable, got " + typeToString(varType));
     }
@@ -110,64 +225,93 @@ void SemanticAnalyzer::analyzeCompoundAssign(CompoundAssignNode* node) {
     }
 }
 
-VarType SemanticAnalyzer::getExpressionType(ASTNode* node) {
-    if (auto* intLit = dynamic_cast<IntLiteral*>(node)) {
-        return VarType::INT;
-    } else if (auto* floatLit = dynamic_cast<FloatLiteral*>(node)) {
-        return VarType::FLOAT;
-    } else if (auto* strLit = dynamic_cast<StrLiteral*>(node)) {
-        return VarType::STRING;
-    } else if (auto* boolLit = dynamic_cast<BoolLiteral*>(node)) {
-        return VarType::BOOL;
-    } else if (auto* charLit = dynamic_cast<CharLiteral*>(node)) {
-        return VarType::CHAR;
-    } else if (auto* arrayLit = dynamic_cast<ArrayLiteralNode*>(node)) {
-        if (arrayLit->elements.empty()) {
-            return VarType::ARRAY; // Empty array
-        }
-        VarType elemType = getExpressionType(arrayLit->elements[0].get());
-        for (const auto& elem : arrayLit->elements) {
-            if (getExpressionType(elem.get()) != elemType) {
-                throw std::runtime_error("Array elements must have consistent types");
+// valueType doubles as the memo: literals are born typed, and every other
+// node is inferred once, bottom-up, so analysis stays linear in tree size.
+ValueType SemanticAnalyzer::getExpressionType(ASTNode* node) {
+    if (node->valueType.kind == VarType::NEUTRAL) {
+        node->valueType = inferType(node);
+    }
+    return node->valueType;
+}
+
+ValueType SemanticAnalyzer::inferType(ASTNode* node) {
+    switch (node->kind) {
+        case NodeKind::IntLiteral:
+            return VarType::INT;
+        case NodeKind::FloatLiteral:
+            return VarType::FLOAT;
+        case NodeKind::StrLiteral:
+            return VarType::STRING;
+        case NodeKind::BoolLiteral:
+            return VarType::BOOL;
+        case NodeKind::CharLiteral:
+            return VarType::CHAR;
+        case NodeKind::ArrayLiteral: {
+            auto* arrayLit = static_cast<ArrayLiteralNode*>(node);
+            uint32_t length = uint32_t(arrayLit->elements.size());
+            if (length == 0) {
+                return ValueType::array(VarType::INT, 0); // Empty array
             }
+            VarType elemType = getExpressionType(arrayLit->elements[0].get()).kind;
+            if (elemType == VarType::ARRAY || elemType == VarType::ERROR) {
+                throw std::runtime_error("Array elements must be int, float, bool, char or string, got " + typeToString(elemType));
+            }
+            for (size_t i = 1; i < arrayLit->elements.size(); ++i) {
+                if (getExpressionType(arrayLit->elements[i].get()).kind != elemType) {
+                    throw std::runtime_error("Array elements must have consistent types");
+                }
+            }
+            return ValueType::array(elemType, length);
         }
-        return VarType::ARRAY;
-    } else if (auto* varRef = dynamic_cast<VarRefNode*>(node)) {
-        auto it = symbolTable.find(varRef->name);
-        if (it == symbolTable.end()) {
-            throw std::runtime_error("Undefined variable '" + varRef->name + "'");
-        }
-        return it->second;
-    } else if (auto* binaryOp = dynamic_cast<BinaryOpNode*>(node)) {
-        return analyzeBinaryOp(binaryOp);
-    } else if (auto* unaryOp = dynamic_cast<UnaryOpNode*>(node)) {
-        return analyzeUnaryOp(unaryOp);
-    } else if (auto* concat = dynamic_cast<ConcatNode*>(node)) {
-        VarType leftType = getExpressionType(concat->left.get());
-        VarType rightType = getExpressionType(concat->right.get());
-        if ((leftType == VarType::STRING || leftType == VarType::CHAR || dynamic_cast<VarRefNode*>(concat->left.get())) &&
-            (rightType == VarType::STRING || rightType == VarType::CHAR || dynamic_cast<VarRefNode*>(concat->right.get()))) {
-            return VarType::STRING;
+        case NodeKind::VarRef: {
+            auto* varRef = static_cast<VarRefNode*>(node);
+            Symbol* symbol = symbolTable.find(varRef->symbol);
+            if (!symbol) {
+                throw std::runtime_error("Undefined variable '" + symbolName(varRef->symbol) + "'");
+            }
+            varRef->slot = symbol->slot;
+            return symbol->type;
         }
-        throw std::runtime_error("Concat requires string or char operands");
-    } else if (auto* ternary = dynamic_cast<TernaryExprNode*>(node)) {
-        VarType condType = getExpressionType(ternary->condition.get());
-        if (condType != VarType::BOOL) {
-            throw std::runtime_error("Ternary condition must be boolean");
+        case NodeKind::BinaryOp:
+            return analyzeBinaryOp(static_cast<BinaryOpNode*>(node));
+        case NodeKind::UnaryOp:
+            return analyzeUnaryOp(static_cast<UnaryOpNode*>(node));
+        case NodeKind::Concat: {
+            auto* concat = static_cast<ConcatNode*>(node);
+            VarType leftType = getExpressionType(concat->left.get()).kind;
+            VarType rightType = getExpressionType(concat->right.get()).kind;
+            if ((leftType == VarType::STRING || leftType == VarType::CHAR) &&
+                (rightType == VarType::STRING || rightType == VarType::CHAR)) {
+                return VarType::STRING;
+            }
+            throw std::runtime_error("Concat requires string or char operands");
         }
-        VarType trueType = getExpressionType(ternary->trueBranch.get());
-        VarType falseType = getExpressionType(ternary->falseBranch.get());
-        if (trueType != falseType) {
-            throw std::runtime_error("Ternary branches must have the same type");
+        case NodeKind::Ternary: {
+            auto* ternary = static_cast<TernaryExprNode*>(node);
+            VarType condType = getExpressionType(ternary->condition.get()).kind;
+            if (condType != VarType::BOOL) {
+                throw std::runtime_error("Ternary condition must be boolean");
+            }
+            ValueType trueType = getExpressionType(ternary->trueBranch.get());
+            ValueType falseType = getExpressionType(ternary->falseBranch.get());
+            if (trueType.kind != falseType.kind || trueType.element != falseType.element) {
+                throw std::runtime_error("Ternary branches must have the same type");
+            }
+            if (trueType.length != falseType.length) {
+                trueType.length = UnknownLength;
+            }
+            return trueType;
         }
-        return trueType;
+        default:
+            throw std::runtime_error("Unknown expression type in semantic analysis");
     }
-    throw std::runtime_error("Unknown expression type in semantic analysis");
 }
 
-VarType SemanticAnalyzer::analyzeBinaryOp(BinaryOpNode* node) {
-    VarType leftType = getExpressionType(node->left.get());
-    VarType rightType = node->right ? getExpressionType(node->right.get()) : leftType; // For ABS, right may be nullptr
+ValueType SemanticAnalyzer::analyzeBinaryOp(BinaryOpNode* node) {
+    ValueType left = getExpressionType(node->left.get());
+    ValueType right = node->right ? getExpressionType(node->right.get()) : left; // For ABS, right may be nullptr
+    VarType leftType = left.kind;
+    VarType rightType = right.kind;
     switch (node->op) {
         case BinaryOp::ADD:
         case BinaryOp::SUBTRACT:
@@ -210,7 +354,15 @@ VarType SemanticAnalyzer::analyzeBinaryOp(BinaryOpNode* node) {
             if (rightType != VarType::INT) {
                 throw std::runtime_error("Array index must be integer");
             }
-            return VarType::INT; // Assuming array elements are INT; adjust if needed
+            if (auto* index = node_cast<IntLiteral>(node->right.get())) {
+                if (index->value < 0) {
+                    throw std::runtime_error("Array index " + std::to_string(index->value) + " is out of range");
+                }
+                if (left.hasLength() && uint32_t(index->value) >= left.length) {
+                    noteLengthError("Array index " + std::to_string(index->value) + " is out of range for " + typeToString(left));
+                }
+            }
+            return left.element;
         case BinaryOp::METHOD_CALL:
             if (leftType != VarType::ERROR || rightType != VarType::STRING) {
                 throw std::runtime_error("Method call requires Error type and string method name");
@@ -228,14 +380,21 @@ VarType SemanticAnalyzer::analyzeBinaryOp(BinaryOpNode* node) {
             if (leftType != VarType::ARRAY || rightType != VarType::ARRAY) {
                 throw std::runtime_error("Array operation requires array operands");
             }
-            return VarType::ARRAY;
+            if (left.element != right.element || !isNumeric(left.element)) {
+                throw std::runtime_error("Array operation requires numeric arrays of one element type, got " + typeToString(left) + " and " + typeToString(right));
+            }
+            if (left.hasLength() && right.hasLength() && left.length != right.length) {
+                noteLengthError("Array operation requires arrays of the same length, got " + typeToString(left) + " and " + typeToString(right));
+            }
+            return left; // as long as its left operand
         default:
             throw std::runtime_error("Unknown binary operator in semantic analysis");
     }
 }
 
-VarType SemanticAnalyzer::analyzeUnaryOp(UnaryOpNode* node) {
-    VarType operandType = getExpressionType(node->operand.get());
+ValueType SemanticAnalyzer::analyzeUnaryOp(UnaryOpNode* node) {
+    ValueType operand = getExpressionType(node->operand.get());
+    VarType operandType = operand.kind;
     switch (node->op) {
         case UnaryOp::INCREMENT:
         case UnaryOp::DECREMENT:
@@ -243,20 +402,34 @@ VarType SemanticAnalyzer::analyzeUnaryOp(UnaryOpNode* node) {
                 throw std::runtime_error("Increment/decrement requires numeric operand");
             }
             return operandType;
+        case UnaryOp::NEGATE:
+            if (operandType != VarType::INT && operandType != VarType::FLOAT) {
+                throw std::runtime_error("Negation requires numeric operand");
+            }
+            return operandType;
         case UnaryOp::LENGTH:
         case UnaryOp::MIN:
         case UnaryOp::MAX:
             if (operandType != VarType::ARRAY) {
                 throw std::runtime_error("Length/min/max requires array operand");
             }
-            return (node->op == UnaryOp::LENGTH) ? VarType::INT : VarType::INT; // Adjust if elements are not INT
+            if (node->op == UnaryOp::LENGTH) {
+                return VarType::INT;
+            }
+            if (!isNumeric(operand.element)) {
+                throw std::runtime_error("Min/max requires a numeric array, got " + typeToString(operand));
+            }
+            if (operand.length == 0) {
+                noteLengthError("Min/max requires a non-empty array, got " + typeToString(operand));
+            }
+            return operand.element;
         default:
             throw std::runtime_error("Unknown unary operator in semantic analysis");
     }
 }
 
 void SemanticAnalyzer::analyzeIfElse(IfElseNode* node) {
-    VarType condType = getExpressionType(node->condition.get());
+    VarType condType = getExpressionType(node->condition.get()).kind;
     if (condType != VarType::BOOL) {
         throw std::runtime_error("If condition must be boolean");
     }
@@ -266,13 +439,15 @@ void SemanticAnalyzer::analyzeIfElse(IfElseNode* node) {
     }
 }
 
+// The loop variable is scoped to the loop, around the body's own scope.
 void SemanticAnalyzer::analyzeLoop(LoopNode* node) {
-    if (node->varName.empty()) { // Traditional for loop
+    symbolTable.pushScope();
+    if (node->type == LoopType::For) { // Traditional for loop
         if (node->init) {
             analyzeStatement(node->init.get());
         }
         if (node->condition) {
-            VarType condType = getExpressionType(node->condition.get());
+            VarType condType = getExpressionType(node->condition.get()).kind;
             if (condType != VarType::BOOL) {
                 throw std::runtime_error("Loop condition must be boolean");
             }
@@ -281,27 +456,39 @@ void SemanticAnalyzer::analyzeLoop(LoopNode* node) {
             analyzeStatement(node->update.get());
         }
     } else { // Foreach loop
-        VarType collType = getExpressionType(node->collection.get());
-        if (collType != VarType::ARRAY) {
+        ValueType collType = getExpressionType(node->collection.get());
+        if (!collType.isArray()) {
             throw std::runtime_error("Foreach collection must be array");
         }
-        symbolTable[node->varName] = VarType::INT; // Assuming array elements are INT
+        node->varSlot = declare(node->varSymbol, {collType.element});
     }
     analyzeStatement(node->body.get());
+    symbolTable.popScope();
 }
 
 void SemanticAnalyzer::analyzeTryCatch(TryCatchNode* node) {
     analyzeStatement(node->tryBlock.get());
-    symbolTable[node->errorVar] = VarType::ERROR;
+    symbolTable.pushScope();
+    node->errorSlot = declare(node->errorSymbol, {VarType::ERROR});
     analyzeStatement(node->catchBlock.get());
-    symbolTable.erase(node->errorVar); // Remove errorVar from scope
+    symbolTable.popScope();
+    // The parser opens the catch block with an Error declaration of the
+    // variable, which shadows the binding above; the caught exception goes
+    // in that declaration's slot.
+    const auto& statements = node->catchBlock->statements;
+    if (!statements.empty()) {
+        auto* decl = node_cast<VarDeclNode>(statements.front().get());
+        if (decl && decl->symbol == node->errorSymbol && !decl->value) {
+            node->errorSlot = decl->slot;
+        }
+    }
 }
 
 void SemanticAnalyzer::analyzeMatch(MatchNode* node) {
-    VarType exprType = getExpressionType(node->expression.get());
+    VarType exprType = getExpressionType(node->expression.get()).kind;
     for (const auto& caseNode : node->cases) {
         if (caseNode->value) {
-            VarType valueType = getExpressionType(caseNode->value.get());
+            VarType valueType = getExpressionType(caseNode->value.get()).kind;
             if (valueType != exprType) {
                 throw std::runtime_error("Match case value type must match expression type");
             }
@@ -321,4 +508,15 @@ std::string SemanticAnalyzer::typeToString(VarType type) {
         case VarType::ERROR: return "Error";
         default: return "unknown";
     }
-}
\ No newline at end of file
+}
+
+std::string SemanticAnalyzer::typeToString(const ValueType& type) {
+    if (!type.isArray()) {
+        return typeToString(type.kind);
+    }
+    std::string name = "array<" + typeToString(type.element) + ">";
+    if (type.hasLength()) {
+        name += "[" + std::to_string(type.length) + "]";
+    }
+    return name;
+}
@@ -1,24 +1,45 @@
 #ifndef SEMANTIC_H
 #define SEMANTIC_H
 #include "ast.h"
-#include <map>
+#include "scope.h"
 #include <string>
+#include <unordered_set>
 
+// Type-checks a program and annotates every expression node with its
+// valueType, including the element type and (where every store agrees on
+// it) the length of arrays; CodeGen tracks the other lengths at run time.
+// It also resolves names: each declaration gets a dense slot, recorded on
+// the declaration and on every VarRef, Assign and CompoundAssign that
+// refers to it. Required before CodeGen.
 class SemanticAnalyzer {
 private:
-    std::map<std::string, VarType> symbolTable;
+    struct Symbol {
+        ValueType type;
+        VarDeclNode* decl = nullptr;              // null for loop and catch variables
+        SlotId slot = NoSlot;
+    };
+    ScopedTable<Symbol> symbolTable;  // global scope at the bottom
+    SlotId nextSlot = 0;
+    std::unordered_set<const VarDeclNode*> lengthsVary;  // arrays stored with values of different lengths
+    std::string lengthError;  // first error that rests on a static length
     void analyzeStatement(ASTNode* node);
     void analyzeVarDecl(VarDeclNode* node);
     void analyzeAssign(AssignNode* node);
     void analyzeCompoundAssign(CompoundAssignNode* node);
-    VarType getExpressionType(ASTNode* node);
-    VarType analyzeBinaryOp(BinaryOpNode* node);
-    VarType analyzeUnaryOp(UnaryOpNode* node);
+    void noteStoredValue(ASTNode* value);
+    static void forgetTypes(ASTNode& node);
+    void noteLengthError(const std::string& message);
+    SlotId declare(SymbolId symbol, Symbol info);  // binds symbol to a new slot
+    ValueType getExpressionType(ASTNode* node);  // infers and records node->valueType
+    ValueType inferType(ASTNode* node);
+    ValueType analyzeBinaryOp(BinaryOpNode* node);
+    ValueType analyzeUnaryOp(UnaryOpNode* node);
     void analyzeIfElse(IfElseNode* node);
     void analyzeLoop(LoopNode* node);
     void analyzeTryCatch(TryCatchNode* node);
     void analyzeMatch(MatchNode* node);
     std::string typeToString(VarType type);
+    std::string typeToString(const ValueType& type);  // array<int>[4]
 
 public:
     SemanticAnalyzer();
@@ -0,0 +1,95 @@
+#include "source.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceBuffer SourceBuffer::fromFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open '" + path + "': " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot stat '" + path + "': " + std::strerror(err));
+    }
+
+    SourceBuffer buffer;
+    if (st.st_size > 0) { // mmap rejects zero-length mappings
+        void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("Cannot map '" + path + "': " + std::strerror(err));
+        }
+        ::madvise(addr, st.st_size, MADV_SEQUENTIAL); // the lexer reads front to back
+        buffer.kind = Kind::Mapped;
+        buffer.view = std::string_view(static_cast<const char*>(addr), st.st_size);
+    }
+    ::close(fd); // the mapping stays valid after close
+    return buffer;
+}
+
+SourceBuffer SourceBuffer::fromStdin() {
+    constexpr size_t chunkSize = 1 << 20;
+    SourceBuffer buffer;
+    buffer.kind = Kind::Owned;
+    size_t used = 0;
+    while (true) {
+        buffer.owned.resize(used + chunkSize);
+        ssize_t n = ::read(STDIN_FILENO, &buffer.owned[used], chunkSize);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("Cannot read stdin: ") + std::strerror(errno));
+        }
+        if (n == 0) break;
+        used += n;
+    }
+    buffer.owned.resize(used);
+    return buffer;
+}
+
+SourceBuffer SourceBuffer::fromArgument(const char* text) {
+    SourceBuffer buffer;
+    buffer.view = text;
+    return buffer;
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+    : kind(other.kind), view(other.view), owned(std::move(other.owned)) {
+    other.kind = Kind::Borrowed;
+    other.view = {};
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        kind = other.kind;
+        view = other.view;
+        owned = std::move(other.owned);
+        other.kind = Kind::Borrowed;
+        other.view = {};
+    }
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer() {
+    release();
+}
+
+void SourceBuffer::release() {
+    if (kind == Kind::Mapped) {
+        ::munmap(const_cast<char*>(view.data()), view.size());
+    }
+    kind = Kind::Borrowed;
+    view = {};
+}
+
+std::string_view SourceBuffer::text() const {
+    return kind == Kind::Owned ? std::string_view(owned) : view;
+}
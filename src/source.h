@@ -0,0 +1,35 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <string>
+#include <string_view>
+
+// Read-only program text handed to the Lexer.
+// Files are memory-mapped and lexed in place, argv text is borrowed as is,
+// and only stdin input is copied into an owned buffer.
+class SourceBuffer {
+public:
+    static SourceBuffer fromFile(const std::string& path);
+    static SourceBuffer fromStdin();
+    static SourceBuffer fromArgument(const char* text);
+
+    SourceBuffer(SourceBuffer&& other) noexcept;
+    SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    ~SourceBuffer();
+
+    std::string_view text() const;
+
+private:
+    enum class Kind { Borrowed, Mapped, Owned };
+
+    SourceBuffer() = default;
+    void release();
+
+    Kind kind = Kind::Borrowed;
+    std::string_view view;   // Borrowed and Mapped
+    std::string owned;       // Owned
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "../src/constant_fold.h"
+#include "../src/lexer.h"
+#include "../src/parser.h"
+#include "../src/semantic.h"
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+
+static std::unique_ptr<ProgramNode> fold(const std::string& code) {
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    SemanticAnalyzer().analyze(program.get());
+    ConstantFolder(program->arena).fold(*program);
+    return program;
+}
+
+static ASTNode* printed(ProgramNode& program, size_t index) {
+    auto* print = node_cast<PrintNode>(program.statements[index].get());
+    assert(print);
+    return print->expr.get();
+}
+
+void test_propagation() {
+    auto program = fold("int a = 6; float f = 2; int c = 1; print(a * 7 + 1); print(f); c++; int b = c;");
+    auto* sum = node_cast<IntLiteral>(printed(*program, 3));
+    assert(sum && sum->value == 43);
+    assert(node_cast<FloatLiteral>(printed(*program, 4)));
+    // c is written twice, so its reads stay
+    auto* b = node_cast<VarDeclNode>(program->statements[6].get());
+    assert(b && node_cast<VarRefNode>(b->value.get()));
+}
+
+void test_divisor_keeps_trap() {
+    // 5 / 0 as a literal division would be folded to poison by IRBuilder;
+    // it has to stay a division by the variable so it traps at run time
+    auto program = fold("int q = 0; int r = 5 / q; print(r); print(7 % q); print(5 / (q * 1));");
+    auto* r = node_cast<VarDeclNode>(program->statements[1].get());
+    auto* divide = node_cast<BinaryOpNode>(r->value.get());
+    assert(divide && node_cast<VarRefNode>(divide->right.get()));
+    auto* modulo = node_cast<BinaryOpNode>(printed(*program, 3));
+    assert(modulo && node_cast<VarRefNode>(modulo->right.get()));
+    auto* nested = node_cast<BinaryOpNode>(printed(*program, 4));
+    assert(nested && !node_cast<IntLiteral>(nested->right.get()));
+
+    // -1 traps only under INT_MIN, which a variable dividend may hold
+    program = fold("int d = -1; print(6 / d); int x = 9; x /= d; print(x % d);");
+    auto* quotient = node_cast<IntLiteral>(printed(*program, 1));
+    assert(quotient && quotient->value == -6);
+    auto* compound = node_cast<CompoundAssignNode>(program->statements[3].get());
+    assert(compound && node_cast<VarRefNode>(compound->value.get()));
+    auto* remainder = node_cast<BinaryOpNode>(printed(*program, 4));
+    assert(remainder && node_cast<VarRefNode>(remainder->right.get()));
+
+    program = fold("int z = 0; int y = 4; y %= z; print(2 / 1);");
+    compound = node_cast<CompoundAssignNode>(program->statements[2].get());
+    assert(compound && node_cast<VarRefNode>(compound->value.get()));
+}
+
+void test_folded_concat_ownership() {
+    // only some stores fold: t keeps freeing the fresh buffers it gets
+    auto program = fold("string s = \"a\"; string t = concat(s, \"b\"); t = concat(t, \"c\"); print(t);");
+    auto* t = node_cast<VarDeclNode>(program->statements[1].get());
+    auto* literal = node_cast<StrLiteral>(t->value.get());
+    assert(literal && literal->value == "ab");
+    assert(t->ownsBuffer);
+    auto* assign = node_cast<AssignNode>(program->statements[2].get());
+    assert(node_cast<ConcatNode>(assign->value.get()));
+
+    // every store folds: nothing left to free
+    program = fold("string s = \"a\"; string t = concat(s, \"b\"); t = concat(s, \"c\"); print(t);");
+    t = node_cast<VarDeclNode>(program->statements[1].get());
+    assert(!t->ownsBuffer);
+}
+
+int main() {
+    test_propagation();
+    test_divisor_keeps_trap();
+    test_folded_concat_ownership();
+    std::cout << "Constant folding tests passed!\n";
+    return 0;
+}
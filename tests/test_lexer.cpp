@@ -1,20 +1,106 @@
 #include "../src/lexer.h"
 #include <cassert>
 #include <iostream>
+#include <stdexcept>
 
 void test_lexer() {
     std::string code = "int x = 42;";
     Lexer lexer(code);
     
     auto tokens = lexer.tokenize();
-    assert(tokens[0].type == TokenType::INT);
-    assert(tokens[1].type == TokenType::IDENTIFIER);
+    assert(tokens[0].type == Token::Int);
+    assert(tokens[1].type == Token::Ident);
     assert(tokens[1].lexeme == "x");
-    // ... more assertions
+    assert(tokens[3].type == Token::IntLiteral);
+    assert(tokens[3].lexeme == "42");
+    assert(tokens[4].type == Token::Semicolon);
+    assert(tokens[5].type == Token::Eof);
+    assert(tokens.size() == 6);
+}
+
+void test_token_buffer_layout() {
+    std::string code = "print(\"hi\");\n// done\nfoo += 1;";
+    Lexer lexer(code);
+
+    auto tokens = lexer.tokenize();
+    // keywords are located by where they start, literals by their lexeme
+    assert(tokens.types[0] == Token::Print);
+    assert(tokens.offsets[0] == 0 && tokens.lengths[0] == 0);
+    assert(tokens.types[2] == Token::StrLiteral);
+    assert(code.substr(tokens.offsets[2], tokens.lengths[2]) == "hi");
+    assert(tokens[5].lexeme == "foo");
+    // identifiers are interned: same spelling, same symbol
+    assert(tokens[5].symbol == Lexer("foo").tokenize()[0].symbol);
+    assert(tokens[5].symbol != Lexer("bar").tokenize()[0].symbol);
+    assert(globalInterner().name(tokens[5].symbol) == "foo");
+    SourceLocation loc = LineIndex(code).locate(tokens[5].offset);
+    assert(loc.line == 3 && loc.column == 1);
+    assert(LineIndex(code).locate(tokens.offsets[2]).column == 8);
+    // reading past the end keeps returning Eof
+    assert(tokens[tokens.size() + 10].type == Token::Eof);
+}
+
+void test_operators() {
+    std::string code = "a += -(b) -> c == d && e++ - -3 ^ 1.5";
+    Lexer lexer(code);
+
+    auto tokens = lexer.tokenize();
+    Token::Type expected[] = {
+        Token::Ident, Token::PlusEqual, Token::negLeftParen, Token::Ident, Token::RightParen,
+        Token::Arrow, Token::Ident, Token::EqualEqual, Token::Ident, Token::And, Token::Ident,
+        Token::PlusPlus, Token::Minus, Token::SignedIntLiteral, Token::Xor, Token::FloatLiteral,
+        Token::Eof,
+    };
+    assert(tokens.size() == sizeof(expected) / sizeof(expected[0]));
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        assert(tokens[i].type == expected[i]);
+    }
+    assert(tokens[13].lexeme == "-3");
+    assert(tokens[14].lexeme == "^" && tokens[14].offset == code.find('^'));
+}
+
+void test_parallel_tokenize() {
+    // strings and comments spanning lines must never be split
+    std::string code;
+    for (int i = 0; i < 200; ++i) {
+        code += "string sx" + std::to_string(i) + " = \"line one\nline two\";\n";
+        code += "/* block\n comment */ x += " + std::to_string(i) + "; // tail \" quote\n";
+    }
+    TokenBuffer serial = Lexer(code).tokenize();
+    for (unsigned threads : {2u, 3u, 7u}) {
+        TokenBuffer parallel = Lexer(code).tokenizeParallel(threads, 0);
+        assert(parallel.types == serial.types);
+        assert(parallel.offsets == serial.offsets);
+        assert(parallel.lengths == serial.lengths);
+    }
+}
+
+void test_number_values() {
+    std::string code = "[42, -7, +3, 2.5, 2147483647]";
+    auto tokens = Lexer(code).tokenize();
+    assert(tokens[1].type == Token::IntLiteral && tokens[1].intValue == 42);
+    assert(tokens[3].type == Token::SignedIntLiteral && tokens[3].intValue == -7);
+    assert(tokens[5].intValue == 3);
+    assert(tokens[7].type == Token::FloatLiteral && tokens[7].floatValue == 2.5f);
+    assert(tokens[9].intValue == 2147483647);
+
+    for (std::string bad : {"2147483648", "1.2.3"}) {
+        bool threw = false;
+        try {
+            Lexer(bad).tokenize();
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
 }
 
 int main() {
     test_lexer();
+    test_token_buffer_layout();
+    test_operators();
+    test_parallel_tokenize();
+    test_number_values();
     std::cout << "Lexer tests passed!\n";
     return 0;
-}
\ No newline at end of file
+}
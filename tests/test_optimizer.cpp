@@ -0,0 +1,401 @@
+#include "../src/lexer.h"
+#include "../src/optimizer.h"
+#include "../src/parser.h"
+#include "../src/semantic.h"
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Runs from src/, next to the compiler it drives; the makefile passes the
+// lli that comes with the LLVM it links.
+#ifndef LLI
+#define LLI "lli"
+#endif
+
+struct Optimized {
+    std::unique_ptr<ProgramNode> program;
+    Optimizer optimizer;
+};
+
+static std::unique_ptr<Optimized> optimize(const std::string& code) {
+    auto result = std::make_unique<Optimized>();
+    Lexer lexer(code);
+    Parser parser(lexer);
+    result->program = parser.parseProgram();
+    SemanticAnalyzer().analyze(result->program.get());
+    result->optimizer.optimize(*result->program);
+    return result;
+}
+
+// The output of command, given code as test_optimizer.src; it has to succeed.
+static std::string pipeCode(const std::string& code, const char* command) {
+    std::ofstream("test_optimizer.src") << code;
+    FILE* pipe = popen(command, "r");
+    assert(pipe);
+    std::string output;
+    char buffer[4096];
+    for (size_t n; (n = fread(buffer, 1, sizeof buffer, pipe)) > 0;) {
+        output.append(buffer, n);
+    }
+    int status = pclose(pipe);
+    assert(status == 0);
+    std::remove("test_optimizer.src");
+    return output;
+}
+
+// What the program prints when compiled by ./compiler and run under lli.
+static std::string run(const std::string& code) {
+    return pipeCode(code, "./compiler -f test_optimizer.src | " LLI " -");
+}
+
+// The LLVM IR ./compiler generates for the program.
+static std::string compile(const std::string& code) {
+    return pipeCode(code, "./compiler -f test_optimizer.src");
+}
+
+static bool containsLoop(ASTNode& node) {
+    if (node.kind == NodeKind::Loop) {
+        return true;
+    }
+    bool found = false;
+    forEachChild(node, [&](auto& child) { found = found || containsLoop(*child); });
+    return found;
+}
+
+static void findDecls(ASTNode& node, const std::string& name, std::vector<VarDeclNode*>& into) {
+    if (auto* decl = node_cast<VarDeclNode>(&node); decl && symbolName(decl->symbol) == name) {
+        into.push_back(decl);
+    }
+    forEachChild(node, [&](auto& child) { findDecls(*child, name, into); });
+}
+
+// The declarations of variables called name, temporaries included.
+static std::vector<VarDeclNode*> decls(ProgramNode& program, const std::string& name) {
+    std::vector<VarDeclNode*> found;
+    for (auto& stmt : program.statements) {
+        findDecls(*stmt, name, found);
+    }
+    return found;
+}
+
+static size_t countOps(ASTNode& node, BinaryOp op) {
+    auto* binary = node_cast<BinaryOpNode>(&node);
+    size_t count = binary && binary->op == op;
+    forEachChild(node, [&](auto& child) { count += countOps(*child, op); });
+    return count;
+}
+
+using Decision = Optimizer::UnrollDecision;
+
+void test_full_unroll() {
+    std::string code = "for (int i = 0; i < 4; i++) { print(i * 3); }";
+    auto result = optimize(code);
+    auto& report = result->optimizer.unrollReport;
+    assert(report.size() == 1 && report[0].kind == Decision::Full && report[0].trips == 4);
+    assert(!containsLoop(*result->program->statements[0]));
+    assert(run(code) == "0\n3\n6\n9\n");
+
+    // steps other than ++
+    code = "for (int i = 10; i > 0; i -= 3) { print(i); } for (int j = 2; j >= 0; j--) { print(j); }";
+    result = optimize(code);
+    assert(result->optimizer.unrollReport.size() == 2);
+    assert(result->optimizer.unrollReport[0].trips == 4 && result->optimizer.unrollReport[1].trips == 3);
+    assert(run(code) == "10\n7\n4\n1\n2\n1\n0\n");
+}
+
+void test_partial_unroll_remainder() {
+    std::string code = "int s = 0; for (int i = 0; i < 1003; i++) { s += i; } print(s);";
+    auto result = optimize(code);
+    auto& report = result->optimizer.unrollReport;
+    assert(report.size() == 1 && report[0].kind == Decision::Partial);
+    assert(report[0].trips == 1003 && report[0].factor == 8);
+    assert(run(code) == "502503\n");
+
+    // counting down, with the leftover iterations at the low end
+    code = "int s = 0; for (int i = 1002; i >= 0; i--) { s += i; } print(s);";
+    result = optimize(code);
+    assert(result->optimizer.unrollReport[0].kind == Decision::Partial);
+    assert(run(code) == "502503\n");
+
+    code = "int s = 0; for (int i = 3000; i > 0; i -= 3) { s += i; } print(s);";
+    result = optimize(code);
+    assert(result->optimizer.unrollReport[0].trips == 1000);
+    assert(run(code) == "1501500\n");
+}
+
+void test_exit_value() {
+    // A loop over an existing variable leaves it at the value that ended
+    // the loop. (This grammar takes no ';' after an assignment init.)
+    std::string code = "int i = 7; for (i = 0 i < 3; i++) { print(i); } print(i);";
+    auto result = optimize(code);
+    assert(result->optimizer.unrollReport[0].kind == Decision::Full);
+    assert(run(code) == "0\n1\n2\n3\n");
+
+    code = "int j = 0; int s = 0; for (j = 0 j < 1003; j++) { s += j; } print(j); print(s);";
+    result = optimize(code);
+    assert(result->optimizer.unrollReport[0].kind == Decision::Partial);
+    assert(run(code) == "1003\n502503\n");
+
+    code = "int k = 0; for (k = 20 k > 0; k -= 6) { print(k); } print(k);";
+    assert(run(code) == "20\n14\n8\n2\n-4\n");
+}
+
+void test_kept_loops() {
+    std::string code = "for (int i = 0; i < 10; i++) { print(i); i++; }";
+    auto result = optimize(code);
+    auto& report = result->optimizer.unrollReport;
+    assert(report.size() == 1 && report[0].kind == Decision::Kept);
+    assert(report[0].reason == "body writes the loop variable");
+    assert(containsLoop(*result->program->statements[0]));
+    assert(run(code) == "0\n2\n4\n6\n8\n");
+
+    // i would pass INT_MAX before reaching the bound; at run time it wraps
+    for (std::string overflow : {"for (int i = 2147483600; i < 2147483647; i += 50) { print(i); }",
+                                 "for (int i = 2147483640; i <= 2147483647; i++) { print(i); }",
+                                 "for (int i = -2147483600; i > -2147483647; i -= 100) { print(i); }"}) {
+        result = optimize(overflow);
+        assert(result->optimizer.unrollReport.size() == 1);
+        assert(result->optimizer.unrollReport[0].kind == Decision::Kept);
+        assert(result->optimizer.unrollReport[0].trips == -1);
+        assert(containsLoop(*result->program->statements[0]));
+    }
+
+    // counting away from the bound
+    result = optimize("for (int i = 0; i > 5; i++) { print(i); }");
+    assert(result->optimizer.unrollReport[0].kind == Decision::Kept);
+}
+
+void test_nested_unroll() {
+    std::string code = "int s = 0; for (int i = 0; i < 3; i++) { for (int j = 0; j < 2; j++) { s += j; print(i); } } print(s);";
+    auto result = optimize(code);
+    assert(result->optimizer.unrollReport.size() == 2);
+    assert(!containsLoop(*result->program->statements[1]));
+    assert(run(code) == "0\n0\n1\n1\n2\n2\n3\n");
+}
+
+void test_common_subexpressions() {
+    std::string code = "int x = 3; x++; int a = x * 5; int b = x * 5; x = 5; int c = x * 5; print(a); print(b); print(c);";
+    auto result = optimize(code);
+    assert(decls(*result->program, "common").size() == 1); // a and b, not c
+    assert(run(code) == "20\n20\n25\n");
+
+    code = "array a = [1, 2, 3]; int i = 1; i++; print(a[i] * 2); print(a[i] * 2);";
+    assert(decls(*optimize(code)->program, "common").size() == 1);
+    // b shares a's buffer, so b[i]++ changes a[i] too
+    code = "array a = [1, 2, 3]; array b = a; int i = 1; i++; print(a[i] * 2); b[i]++; print(a[i] * 2);";
+    assert(decls(*optimize(code)->program, "common").empty());
+    assert(run(code) == "6\n8\n");
+
+    // a nested block counts as a write of everything it changes
+    code = "int x = 1; x++; print(x * 3); if (x > 0) { x = 10; } print(x * 3);";
+    assert(decls(*optimize(code)->program, "common").empty());
+    assert(run(code) == "6\n30\n");
+}
+
+void test_stored_heap_values_not_shared() {
+    // t and u each own and free their buffer; only the printed concat is shared
+    std::string code = "string s = \"a\"; s = concat(s, \"b\"); string t = concat(s, \"c\"); "
+                       "string u = concat(s, \"c\"); print(t); print(u); print(concat(s, \"d\")); print(concat(s, \"d\"));";
+    auto result = optimize(code);
+    auto common = decls(*result->program, "common");
+    assert(common.size() == 1 && common[0]->ownsBuffer);
+    for (const char* name : {"t", "u"}) {
+        auto stored = decls(*result->program, name);
+        assert(stored.size() == 1 && stored[0]->ownsBuffer && node_cast<ConcatNode>(stored[0]->value.get()));
+    }
+    assert(run(code) == "abc\nabc\nabd\nabd\n");
+
+    code = "int n = 2; n++; array a = [1, 2]; for (int i = 0; i < n; i++) { array b = add(a, a); b[0]++; print(b); }";
+    result = optimize(code);
+    assert(decls(*result->program, "hoisted").empty()); // b changes its own buffer
+    assert(run(code) == "[3, 4]\n[3, 4]\n[3, 4]\n");
+
+    // arr2[0] keeps s's old buffer, so reassigning s must not free it
+    code = "string x = \"a\"; x = \"k\"; string s = concat(x, \"b\"); array arr2 = [s, \"z\"]; "
+           "s = concat(x, \"d\"); string w = concat(x, \"eeeeeeeeeeee\"); print(arr2);";
+    result = optimize(code);
+    assert(!decls(*result->program, "s")[0]->ownsBuffer);
+    assert(run(code) == "[kb, z]\n");
+    // the same with s and w read afterwards, so their stores are not dead
+    code = "string x = \"a\"; x = \"k\"; string s = concat(x, \"b\"); array arr2 = [s, \"z\"]; "
+           "s = concat(x, \"d\"); string w = concat(x, \"eeeeeeeeeeee\"); print(arr2); print(s); print(w);";
+    assert(run(code) == "[kb, z]\nkd\nkeeeeeeeeeeee\n");
+}
+
+void test_hoisted_buffers() {
+    // n is not constant, so the loops stay and their invariant concat and
+    // add move out; each temporary owns its buffer and frees it once,
+    // after the loop, in the block around it
+    std::string code = "string s = \"x\"; s = concat(s, \"y\"); int n = 3; n++; "
+                       "for (int i = 0; i < n; i++) { print(concat(s, \"!\")); } "
+                       "array a = [1, 2]; array b = [3, 4]; for (int j = 0; j < n; j++) { print(add(a, b)); }";
+    auto result = optimize(code);
+    auto hoisted = decls(*result->program, "hoisted");
+    assert(hoisted.size() == 2);
+    for (auto* decl : hoisted) {
+        assert(decl->ownsBuffer);
+    }
+    size_t wrapped = 0;
+    for (auto& stmt : result->program->statements) {
+        auto* block = node_cast<BlockNode>(stmt.get());
+        if (block && block->statements.size() == 2 && node_cast<VarDeclNode>(block->statements[0].get()) &&
+            node_cast<LoopNode>(block->statements[1].get())) {
+            ++wrapped;
+        }
+    }
+    assert(wrapped == 2);
+    assert(run(code) == "xy!\nxy!\nxy!\nxy!\n[4, 6]\n[4, 6]\n[4, 6]\n[4, 6]\n");
+}
+
+void test_dead_code() {
+    std::string code = "int d = 2; d++; int unused = 7 / d; int gone = d / 4; int dead = 3; dead = 4; "
+                       "array a = [1, 2]; a[0]++; print(a[0]);";
+    auto result = optimize(code);
+    auto& statements = result->program->statements;
+    assert(decls(*result->program, "dead").empty());
+    assert(decls(*result->program, "gone").empty()); // d / 4 cannot trap
+    size_t divisions = 0, increments = 0, prints = 0;
+    for (auto& stmt : statements) {
+        divisions += countOps(*stmt, BinaryOp::DIVIDE);
+        if (auto* unary = node_cast<UnaryOpNode>(stmt.get())) {
+            increments += unary->op == UnaryOp::INCREMENT && node_cast<BinaryOpNode>(unary->operand.get());
+        }
+        prints += stmt->kind == NodeKind::Print;
+    }
+    assert(divisions == 1); // 7 / d may divide by zero
+    assert(increments == 1 && prints == 1);
+    assert(run(code) == "2\n");
+
+    // division by a variable that is zero at run time has to stay
+    result = optimize("int z = 0; z++; z--; int r = 5 / z; print(1);");
+    divisions = 0;
+    for (auto& stmt : result->program->statements) {
+        divisions += countOps(*stmt, BinaryOp::DIVIDE);
+    }
+    assert(divisions == 1);
+}
+
+void test_induction_variables() {
+    // n is not constant, so none of these loops is unrolled
+    std::string code = "int n = 5; n++; for (int i = -7; i < n; i += 3) { print(i * 4); }";
+    auto result = optimize(code);
+    assert(decls(*result->program, "scaled").size() == 1);
+    assert(compile(code).find(" mul ") == std::string::npos);
+    assert(run(code) == "-28\n-16\n-4\n8\n20\n");
+
+    // sites in the condition and inside an if share one variable
+    code = "int n = 20; n++; n--; for (int i = 0; i * 3 < n; i++) { if (i * 3 > 4) { print(i * 3); } }";
+    result = optimize(code);
+    assert(decls(*result->program, "scaled").size() == 1);
+    assert(countOps(*result->program->statements.back(), BinaryOp::MULTIPLY) == 0);
+    assert(run(code) == "6\n9\n12\n15\n18\n");
+
+    // an invariant variable factor, on either side, counting down
+    code = "int n = 3; n++; int k = 3; k++; for (int i = 10; i > n; i -= 2) { print(i * k); print(k * i); }";
+    result = optimize(code);
+    assert(decls(*result->program, "scaled").size() == 1 && decls(*result->program, "stride").size() == 1);
+    assert(run(code) == "40\n40\n32\n32\n24\n24\n");
+
+    // a factor the loop changes is left alone
+    code = "int n = 3; n++; int k = 3; for (int i = 0; i < n; i++) { print(i * k); k++; }";
+    assert(decls(*optimize(code)->program, "scaled").empty());
+    assert(run(code) == "0\n4\n10\n18\n");
+
+    // products that overflow wrap the same way the additions do
+    code = "int n = 4; n++; for (int i = 0; i < n; i++) { print(i * 1073741824); }";
+    assert(run(code) == "0\n1073741824\n-2147483648\n-1073741824\n0\n");
+}
+
+void test_power_of_two_ops() {
+    // division rounds toward zero and the remainder takes the dividend's sign
+    std::string code = "int a = -7; a++; a--; print(a / 4); print(a % 4); print(a / 2); print(a % 8); print(a * 4); "
+                       "print(a / 1); print(a % 1); int p = 7; p++; p--; print(p / 4); print(p % 4); "
+                       "int b = -9; b++; b--; b /= 4; print(b); int c = -9; c++; c--; c %= 4; print(c); "
+                       "int m = -2147483647; m--; print(m / 2); print(m % 2); print(m / 1073741824); print(m % 1073741824);";
+    std::string ir = compile(code);
+    assert(ir.find("sdiv") == std::string::npos && ir.find("srem") == std::string::npos);
+    assert(run(code) == "-1\n-3\n-3\n-7\n-28\n-7\n0\n1\n3\n-2\n-1\n-1073741824\n0\n-2\n0\n");
+}
+
+// generatePow's result: wrapping multiplication, 1 for exp <= 0.
+static int32_t intPow(int32_t base, int32_t exp) {
+    uint32_t result = 1, power = uint32_t(base);
+    for (uint32_t bits = exp < 0 ? 0 : uint32_t(exp); bits; bits >>= 1, power *= power) {
+        if (bits & 1) result *= power;
+    }
+    return int32_t(result);
+}
+
+void test_pow_exponents() {
+    // x is not constant, so literal exponents go through the multiply chain
+    // and e through the loop
+    std::string code = "int x = 3; x++; x--; print(pow(x, 0)); print(pow(x, -2)); print(pow(x, 40)); "
+                       "print(pow(x, 2147483647)); int e = 40; e++; e--; print(pow(x, e)); e = -3; print(pow(x, e)); "
+                       "print(pow(3, 40));";
+    std::string expected;
+    for (int32_t value : {intPow(3, 0), intPow(3, -2), intPow(3, 40), intPow(3, 2147483647), intPow(3, 40),
+                          intPow(3, -3), intPow(3, 40)}) {
+        expected += std::to_string(value) + "\n";
+    }
+    assert(run(code) == expected);
+
+    code = "float f = 2.0; f = f * 1.0; print(pow(f, -2)); print(pow(f, 0)); print(pow(f, 100)); print(pow(f, 128));";
+    assert(run(code) == "0.25\n1\n1.26765e+30\ninf\n");
+}
+
+// The static length of an array is a hint: stores that disagree on it
+// leave it unknown, and CodeGen then carries the length at run time.
+void test_array_lengths() {
+    std::string code = "array a = [1, 2, 3]; a = [5, 6]; print(a); print(length(a));";
+    auto result = optimize(code);
+    assert(!decls(*result->program, "a")[0]->valueType.hasLength());
+    assert(run(code) == "[5, 6]\n2\n");
+
+    // the read in the loop comes before the store that changes the length
+    code = "array a = [1, 2, 3]; int k = 1; k++; for (int i = 0; i < k; i++) { print(a); print(max(a)); a = [7, 8]; } "
+           "print(length(a));";
+    assert(run(code) == "[1, 2, 3]\n3\n[7, 8]\n8\n2\n");
+    code = "array a = [1]; for (int i = 0; i < 2; i++) { if (i == 1) { print(a[2]); } a = [4, 5, 6]; }";
+    assert(run(code) == "6\n");
+
+    code = "int n = 1; n++; array t = n > 1 ? [1, 2, 3] : [4]; print(t); print(length(t)); print(min(t)); "
+           "foreach (x in t) { print(x); } print(add(t, t)); array u; u = t; print(u);";
+    assert(run(code) == "[1, 2, 3]\n3\n1\n1\n2\n3\n[2, 4, 6]\n[1, 2, 3]\n");
+
+    // lengths every store agrees on stay static
+    result = optimize("array b = [1, 2]; b = [3, 4]; print(b);");
+    assert(decls(*result->program, "b")[0]->valueType.length == 2);
+
+    for (const char* invalid : {"array a = [1, 2]; print(a[5]);", "print(add([1, 2], [1, 2, 3]));"}) {
+        bool rejected = false;
+        try {
+            optimize(invalid);
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+}
+
+int main() {
+    test_full_unroll();
+    test_partial_unroll_remainder();
+    test_exit_value();
+    test_kept_loops();
+    test_nested_unroll();
+    test_common_subexpressions();
+    test_stored_heap_values_not_shared();
+    test_hoisted_buffers();
+    test_dead_code();
+    test_induction_variables();
+    test_power_of_two_ops();
+    test_pow_exponents();
+    test_array_lengths();
+    std::cout << "Optimizer tests passed!\n";
+    return 0;
+}